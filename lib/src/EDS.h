@@ -29,6 +29,8 @@
 
 /** Utils **/
 #include <eds/utils/Utils.hpp>
+#include <eds/utils/Accumulate.hpp>
+#include <eds/utils/Interpolate.hpp>
 #include <eds/utils/Calib.hpp>
 #include <eds/utils/NumType.h>
 #include <eds/utils/globalFuncs.h>
@@ -37,19 +39,27 @@
 #include <eds/utils/ImageAndExposure.h>
 #include <eds/utils/FrameShell.h>
 #include <eds/utils/IndexThreadReduce.h>
+#include <eds/utils/Stats.hpp>
 
 /** I/O **/
 #include <eds/io/ImageRW.h>
 #include <eds/io/ImageConvert.h>
 #include <eds/io/OutputMaps.h>
+#include <eds/io/EventLog.h>
 
 /** Initialization **/
 #include <eds/init/CoarseInitializer.h>
 
 /** Event Tracker (EDS) **/
+#include <eds/tracking/EventBuffer.hpp>
+#include <eds/tracking/EventFilter.hpp>
 #include <eds/tracking/EventFrame.hpp>
 #include <eds/tracking/KeyFrame.hpp>
 #include <eds/tracking/Tracker.hpp>
+#include <eds/tracking/TimeSurface.hpp>
+#include <eds/tracking/TrackingCache.hpp>
+#include <eds/tracking/PointSelection.hpp>
+#include <eds/tracking/ImuPreintegration.hpp>
 
 /** Frame Tracker (DSO) **/
 #include <eds/tracking/Residuals.h>
@@ -0,0 +1,349 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "EventLog.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace eds
+{
+namespace io
+{
+
+static inline size_t align8(const size_t &n)
+{
+    return (n + 7) & ~size_t(7);
+}
+
+/** Size in bytes of a block with n events **/
+static inline size_t blockBytes(const size_t &n)
+{
+    return align8(sizeof(EventLogBlockHeader) + ((n + 63) / 64) * sizeof(uint64_t)
+                + n * sizeof(uint32_t) + 2 * n * sizeof(uint16_t));
+}
+
+EventLogWriter::EventLogWriter(const std::string &filename, const uint16_t &height, const uint16_t &width,
+                            const size_t &block_size)
+:height(height), width(width), block_size(std::max(block_size, size_t(1))), num_events(0),
+last_ts(std::numeric_limits<int64_t>::min())
+{
+    this->file = fopen(filename.c_str(), "wb");
+    if (!this->file)
+        throw std::runtime_error("[EVENT_LOG] cannot open " + filename + " for writing");
+
+    /** Header is written again with the final values in close() **/
+    EventLogFileHeader header;
+    memset(&header, 0, sizeof(header));
+    this->check(fwrite(&header, sizeof(header), 1, this->file) == 1, "write the header");
+    this->block.reserve(this->block_size);
+}
+
+EventLogWriter::~EventLogWriter()
+{
+    try
+    {
+        this->close();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr<<e.what()<<std::endl;
+    }
+}
+
+void EventLogWriter::check(const bool &success, const std::string &operation)
+{
+    if (success)
+        return;
+
+    fclose(this->file);
+    this->file = nullptr;
+    throw std::runtime_error("[EVENT_LOG] cannot " + operation + " (the log is incomplete)");
+}
+
+void EventLogWriter::write(const ::base::samples::EventArray &events)
+{
+    for (auto &ev : events.events)
+        this->write(ev.x, ev.y, ev.ts.toMicroseconds(), ev.polarity);
+}
+
+void EventLogWriter::write(const ::base::samples::EventBatch &events)
+{
+    for (size_t i=0; i<events.size(); ++i)
+        this->write(events.x[i], events.y[i], events.ts[i], events.getPolarity(i));
+}
+
+void EventLogWriter::write(const uint16_t &x, const uint16_t &y, const int64_t &ts, const bool &polarity)
+{
+    if (!this->file)
+        throw std::runtime_error("[EVENT_LOG] writing in a closed log");
+
+    /** Also across blocks: seek() relies on time ordered blocks **/
+    if (ts < this->last_ts)
+        throw std::runtime_error("[EVENT_LOG] events are not time ordered");
+
+    /** Start a new block when the increment does not fit in 32 bits **/
+    if (!this->block.empty() && ts - this->block.ts.back() > std::numeric_limits<uint32_t>::max())
+        this->flush();
+
+    this->block.push_back(x, y, ts, polarity);
+    this->last_ts = ts;
+    if (this->block.size() >= this->block_size)
+        this->flush();
+}
+
+void EventLogWriter::flush()
+{
+    const size_t n = this->block.size();
+    if (n == 0)
+        return;
+
+    EventLogBlockIndex idx;
+    idx.first_time = this->block.ts.front();
+    idx.last_time = this->block.ts.back();
+    const long offset = ftell(this->file);
+    this->check(offset >= 0, "get the block offset");
+    idx.offset = offset;
+    idx.num_events = n;
+
+    EventLogBlockHeader header;
+    header.t0 = idx.first_time;
+    header.num_events = n;
+    header.reserved = 0;
+    this->check(fwrite(&header, sizeof(header), 1, this->file) == 1, "write a block header");
+
+    /** Columns **/
+    const size_t n_words = this->block.polarity.size();
+    this->check(fwrite(this->block.polarity.data(), sizeof(uint64_t), n_words, this->file) == n_words, "write the polarities");
+    std::vector<uint32_t> dt(n);
+    int64_t prev = header.t0;
+    for (size_t i=0; i<n; ++i)
+    {
+        dt[i] = static_cast<uint32_t>(this->block.ts[i] - prev);
+        prev = this->block.ts[i];
+    }
+    this->check(fwrite(dt.data(), sizeof(uint32_t), n, this->file) == n, "write the time stamps");
+    this->check(fwrite(this->block.x.data(), sizeof(uint16_t), n, this->file) == n, "write the x coordinates");
+    this->check(fwrite(this->block.y.data(), sizeof(uint16_t), n, this->file) == n, "write the y coordinates");
+
+    /** Padding for the next block **/
+    const uint64_t zero = 0;
+    const size_t padding = blockBytes(n) - (sizeof(header) + n_words * sizeof(uint64_t) + n * (sizeof(uint32_t) + 2 * sizeof(uint16_t)));
+    this->check(fwrite(&zero, 1, padding, this->file) == padding, "write the block padding");
+
+    this->index.push_back(idx);
+    this->num_events += n;
+    this->block.clear();
+}
+
+void EventLogWriter::close()
+{
+    if (!this->file)
+        return;
+
+    this->flush();
+
+    EventLogFileHeader header;
+    memcpy(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic));
+    header.version = EVENT_LOG_VERSION;
+    header.height = this->height;
+    header.width = this->width;
+    header.num_events = this->num_events;
+    header.num_blocks = this->index.size();
+    const long index_offset = ftell(this->file);
+    this->check(index_offset >= 0, "get the index offset");
+    header.index_offset = index_offset;
+
+    this->check(fwrite(this->index.data(), sizeof(EventLogBlockIndex), this->index.size(), this->file) == this->index.size(), "write the index");
+    this->check(fseek(this->file, 0, SEEK_SET) == 0, "seek the header");
+    this->check(fwrite(&header, sizeof(header), 1, this->file) == 1, "write the header");
+
+    /** Buffered data is written at fclose **/
+    const int result = fclose(this->file);
+    this->file = nullptr;
+    if (result != 0)
+        throw std::runtime_error("[EVENT_LOG] cannot close the file (the log is incomplete)");
+}
+
+EventLogReader::EventLogReader(const std::string &filename)
+:data(nullptr), length(0)
+{
+    this->fd = open(filename.c_str(), O_RDONLY);
+    if (this->fd < 0)
+        throw std::runtime_error("[EVENT_LOG] cannot open " + filename);
+
+    struct stat st;
+    if (fstat(this->fd, &st) != 0)
+        this->fail("cannot stat " + filename);
+    this->length = st.st_size;
+    if (this->length < sizeof(EventLogFileHeader))
+        this->fail(filename + " is not an event log");
+
+    void *ptr = mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, this->fd, 0);
+    if (ptr == MAP_FAILED)
+        this->fail("cannot map " + filename);
+    this->data = static_cast<const uint8_t*>(ptr);
+
+    /** Playback reads the file front to back **/
+    madvise(ptr, this->length, MADV_SEQUENTIAL);
+
+    /** Index in the file (no overflow with a corrupted header) **/
+    this->header = reinterpret_cast<const EventLogFileHeader*>(this->data);
+    const uint64_t num_blocks = this->header->num_blocks, index_offset = this->header->index_offset;
+    if (memcmp(this->header->magic, EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC)) != 0 ||
+        this->header->version != EVENT_LOG_VERSION ||
+        index_offset < sizeof(EventLogFileHeader) || index_offset > this->length || (index_offset % 8) != 0 ||
+        num_blocks > (this->length - index_offset) / sizeof(EventLogBlockIndex))
+    {
+        this->fail(filename + " is not a valid event log");
+    }
+    this->index = reinterpret_cast<const EventLogBlockIndex*>(this->data + index_offset);
+
+    /** Blocks between the file header and the index, time ordered and
+     * with the number of events of the index **/
+    uint64_t num_events = 0;
+    for (size_t id=0; id<num_blocks; ++id)
+    {
+        const EventLogBlockIndex &idx = this->index[id];
+        bool valid = idx.offset >= sizeof(EventLogFileHeader) && (idx.offset % 8) == 0
+                && idx.offset <= index_offset - sizeof(EventLogBlockHeader)
+                && idx.num_events > 0 && idx.first_time <= idx.last_time
+                && (id == 0 || this->index[id-1].last_time <= idx.first_time);
+        if (valid)
+        {
+            const EventLogBlockHeader *bh = reinterpret_cast<const EventLogBlockHeader*>(this->data + idx.offset);
+            valid = bh->num_events == idx.num_events && bh->t0 == idx.first_time
+                && idx.num_events <= (index_offset - idx.offset) / (sizeof(uint32_t) + 2 * sizeof(uint16_t))
+                && blockBytes(idx.num_events) <= index_offset - idx.offset;
+        }
+        if (!valid)
+            this->fail(filename + " has a corrupted block " + std::to_string(id));
+        num_events += idx.num_events;
+    }
+    if (num_events != this->header->num_events)
+        this->fail(filename + " has a corrupted index");
+}
+
+void EventLogReader::fail(const std::string &message)
+{
+    if (this->data)
+        munmap(const_cast<uint8_t*>(this->data), this->length);
+    ::close(this->fd);
+    throw std::runtime_error("[EVENT_LOG] " + message);
+}
+
+EventLogReader::~EventLogReader()
+{
+    munmap(const_cast<uint8_t*>(this->data), this->length);
+    ::close(this->fd);
+}
+
+::base::Time EventLogReader::firstTime(const size_t &id) const
+{
+    return ::base::Time::fromMicroseconds(this->index[id].first_time);
+}
+
+::base::Time EventLogReader::lastTime(const size_t &id) const
+{
+    return ::base::Time::fromMicroseconds(this->index[id].last_time);
+}
+
+size_t EventLogReader::seek(const ::base::Time &t) const
+{
+    const int64_t t_us = t.toMicroseconds();
+    const EventLogBlockIndex *end = this->index + this->header->num_blocks;
+    const EventLogBlockIndex *it = std::lower_bound(this->index, end, t_us,
+            [](const EventLogBlockIndex &idx, const int64_t &value){return idx.last_time < value;});
+    return it - this->index;
+}
+
+EventSlice EventLogReader::block(const size_t &id)
+{
+    if (id >= this->header->num_blocks)
+        throw std::out_of_range("[EVENT_LOG] block id out of range");
+
+    const uint8_t *ptr = this->data + this->index[id].offset;
+    const EventLogBlockHeader *bh = reinterpret_cast<const EventLogBlockHeader*>(ptr);
+    const size_t n = bh->num_events;
+    ptr += sizeof(EventLogBlockHeader);
+
+    EventSlice slice;
+    slice.size = n;
+    slice.polarity = reinterpret_cast<const uint64_t*>(ptr);
+    ptr += ((n + 63) / 64) * sizeof(uint64_t);
+    const uint32_t *dt = reinterpret_cast<const uint32_t*>(ptr);
+    ptr += n * sizeof(uint32_t);
+    slice.x = reinterpret_cast<const uint16_t*>(ptr);
+    slice.y = slice.x + n;
+
+    /** Delta decoding of the time stamps **/
+    this->ts_buffer.resize(n);
+    int64_t t = bh->t0;
+    for (size_t i=0; i<n; ++i)
+    {
+        t += dt[i];
+        this->ts_buffer[i] = t;
+    }
+    slice.ts = this->ts_buffer.data();
+
+    return slice;
+}
+
+void EventLogReader::read(const size_t &id, ::base::samples::EventBatch &batch)
+{
+    EventSlice slice = this->block(id);
+    const size_t n_words = (slice.size + 63) / 64;
+
+    batch.time = ::base::Time::fromMicroseconds(slice.ts[slice.size-1]);
+    batch.height = this->height();
+    batch.width = this->width();
+    batch.x.assign(slice.x, slice.x + slice.size);
+    batch.y.assign(slice.y, slice.y + slice.size);
+    batch.ts.assign(slice.ts, slice.ts + slice.size);
+    batch.polarity.assign(slice.polarity, slice.polarity + n_words);
+}
+
+void EventLogReader::read(const size_t &id, ::base::samples::EventArray &array)
+{
+    EventSlice slice = this->block(id);
+
+    array.time = ::base::Time::fromMicroseconds(slice.ts[slice.size-1]);
+    array.height = this->height();
+    array.width = this->width();
+    array.events.resize(slice.size);
+    for (size_t i=0; i<slice.size; ++i)
+    {
+        ::base::samples::Event &ev = array.events[i];
+        ev.x = slice.x[i]; ev.y = slice.y[i];
+        ev.ts = ::base::Time::fromMicroseconds(slice.ts[i]);
+        ev.polarity = slice.getPolarity(i);
+    }
+}
+
+}
+}
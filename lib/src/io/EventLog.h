@@ -0,0 +1,187 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <stdint.h>
+
+/** Rock base types **/
+#include <base/Time.hpp>
+#include <base/samples/EventArray.hpp>
+#include <base/samples/EventBatch.hpp>
+
+namespace eds
+{
+namespace io
+{
+
+/** Binary event log (.evlog). All values are little endian.
+ *
+ *  [FileHeader]
+ *  [Block 0] ... [Block N-1]
+ *  [BlockIndex 0] ... [BlockIndex N-1]
+ *
+ *  Each block holds up to block_size events, time ordered, stored column wise:
+ *  [BlockHeader][polarity bits: uint64 x ceil(n/64)][dt: uint32 x n][x: uint16 x n][y: uint16 x n][pad to 8 bytes]
+ *  dt is the time increment in microseconds wrt the previous event (the
+ *  first one wrt BlockHeader::t0). Blocks start at 8 bytes boundaries so
+ *  the columns can be used in place from the memory mapped file.
+ **/
+static constexpr char EVENT_LOG_MAGIC[8] = {'E', 'D', 'S', 'E', 'V', 'L', 'O', 'G'};
+static constexpr uint32_t EVENT_LOG_VERSION = 1;
+
+struct EventLogFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint16_t height;
+    uint16_t width;
+    uint64_t num_events;
+    uint64_t num_blocks;
+    uint64_t index_offset;
+};
+
+struct EventLogBlockHeader
+{
+    int64_t t0; // [us]
+    uint32_t num_events;
+    uint32_t reserved;
+};
+
+struct EventLogBlockIndex
+{
+    int64_t first_time; // [us]
+    int64_t last_time; // [us]
+    uint64_t offset; // [bytes] from the beginning of the file
+    uint64_t num_events;
+};
+
+/** View of the events of one block. x, y and polarity point into the
+ * mapped file (no copy). The time stamps are decoded in a buffer owned
+ * by the reader and valid until the next call to EventLogReader::block **/
+struct EventSlice
+{
+    size_t size;
+    const uint16_t *x;
+    const uint16_t *y;
+    const uint64_t *polarity;
+    const int64_t *ts; // [us]
+
+    inline bool getPolarity(const size_t &i) const
+    {
+        return (polarity[i >> 6] >> (i & 63)) & 1u;
+    }
+};
+
+class EventLogWriter
+{
+    private:
+        FILE *file;
+        uint16_t height, width;
+        size_t block_size;
+        uint64_t num_events;
+        /** Time stamp of the last written event [us] (order across blocks) **/
+        int64_t last_ts;
+        std::vector<EventLogBlockIndex> index;
+        /** Events of the block being filled **/
+        ::base::samples::EventBatch block;
+
+        void flush();
+
+        /** @brief Close the file and throw when a file operation failed **/
+        void check(const bool &success, const std::string &operation);
+
+    public:
+        /** @brief Open a new log. Throws std::runtime_error on failure **/
+        EventLogWriter(const std::string &filename, const uint16_t &height, const uint16_t &width,
+                        const size_t &block_size = 4096);
+
+        /** The writer owns the file **/
+        EventLogWriter(const EventLogWriter&) = delete;
+        EventLogWriter& operator=(const EventLogWriter&) = delete;
+
+        ~EventLogWriter();
+
+        /** @brief Append events. They should be time ordered **/
+        void write(const ::base::samples::EventArray &events);
+
+        void write(const ::base::samples::EventBatch &events);
+
+        void write(const uint16_t &x, const uint16_t &y, const int64_t &ts, const bool &polarity);
+
+        /** @brief Write the last block, the index and close the file.
+         * Throws std::runtime_error when the file cannot be written **/
+        void close();
+};
+
+class EventLogReader
+{
+    private:
+        int fd;
+        const uint8_t *data;
+        size_t length;
+        const EventLogFileHeader *header;
+        const EventLogBlockIndex *index;
+        /** Decoded time stamps of the last block **/
+        std::vector<int64_t> ts_buffer;
+
+        /** @brief Unmap, close and throw (constructor failures) **/
+        void fail(const std::string &message);
+
+    public:
+        /** @brief Memory map an existing log. The index and the blocks are
+         * validated against the file size. Throws std::runtime_error on failure **/
+        EventLogReader(const std::string &filename);
+
+        /** The reader owns the mapping and the file descriptor **/
+        EventLogReader(const EventLogReader&) = delete;
+        EventLogReader& operator=(const EventLogReader&) = delete;
+
+        ~EventLogReader();
+
+        uint16_t height() const {return this->header->height;};
+
+        uint16_t width() const {return this->header->width;};
+
+        uint64_t numEvents() const {return this->header->num_events;};
+
+        uint64_t numBlocks() const {return this->header->num_blocks;};
+
+        /** @brief Time span of the block **/
+        ::base::Time firstTime(const size_t &id) const;
+
+        ::base::Time lastTime(const size_t &id) const;
+
+        /** @brief First block with events at time t or later (numBlocks() if none) **/
+        size_t seek(const ::base::Time &t) const;
+
+        /** @brief Zero copy view of the block events **/
+        EventSlice block(const size_t &id);
+
+        /** @brief Copy the block events in a sample (buffers are reused) **/
+        void read(const size_t &id, ::base::samples::EventBatch &batch);
+
+        void read(const size_t &id, ::base::samples::EventArray &array);
+};
+
+}
+}
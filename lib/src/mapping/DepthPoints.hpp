@@ -114,6 +114,11 @@ public:
     inline const_iterator cend() const noexcept {return this->data.cend();};
     inline iterator erase(const int &idx){return this->data.erase(this->data.begin()+idx);};
     inline iterator erase(DepthPoints::iterator &it) {return this->data.erase(it);};
+    inline void select(const std::vector<int> &indices)
+    {
+        for (size_t k=0; k<indices.size(); ++k) this->data[k] = this->data[indices[k]];
+        this->data.resize(indices.size());
+    };
 
     /** Visualize the points sigma in a given image **/
     cv::Mat sigmaViz(const cv::Mat &img, const std::vector<cv::Point2d> &coord, double &min_sigma, double &max_sigma);
@@ -23,12 +23,14 @@
 
 #include <yaml-cpp/yaml.h>
 #include <base/Time.hpp>
+#include <eds/utils/Interpolate.hpp>
 
 #include <vector>
 #include <string>
 #include <numeric>
 #include <stdint.h>
 #include <iostream>
+#include <stdexcept>
 #include <iomanip>  // std::setprecision()
 #include <fstream>
 
@@ -37,6 +39,14 @@ namespace eds { namespace tracking{
     enum LOSS_FUNCTION{NONE, HUBER, CAUCHY};
     enum LINEAR_SOLVER_TYPE{DENSE_QR, DENSE_SCHUR, SPARSE_SCHUR, SPARSE_NORMAL_CHOLESKY};
     enum BOOTSTRAP_TYPE{EIGHT_POINTS, MiDAS};
+    /** Event frame pyramid: same resolution dilate + erode levels or blurred and downsampled levels **/
+    enum PYRAMID_MODE{MORPHOLOGY, DOWNSAMPLE};
+    /** Jacobians of the photometric error: ceres autodiff or hand derived **/
+    enum JACOBIAN_TYPE{AUTODIFF, ANALYTIC};
+    /** Tracking points: all the keyframe points or a budget of the most informative ones **/
+    enum POINT_SELECTION{ALL_POINTS, INFORMATION};
+    /** Scalar of the event frame and of the photometric error data (the pose is always double) **/
+    enum SCALAR_TYPE{DOUBLE, FLOAT};
 
     struct SolverOptions
     {
@@ -45,6 +55,31 @@ namespace eds { namespace tracking{
         std::vector<int> max_num_iterations;
         double function_tolerance;
         bool minimizer_progress_to_stdout;
+        /** One residual block normalized with all the points, evaluated in
+         * chunks on a thread pool (deterministic for any number of threads) **/
+        bool global_norm;
+        /** Constant velocity prediction of the pose for every event frame **/
+        bool warm_start;
+        /** Finer levels are skipped when a level converges with a pose update below it (0 disables it) **/
+        double skip_threshold;
+        /** A level after a converged coarser level runs at most twice its iterations **/
+        bool adaptive_iterations;
+    };
+
+    struct PointSelectionConfig
+    {
+        POINT_SELECTION type;
+        int budget; // number of tracking points per keyframe
+        std::vector<int> grid; // spatial buckets [cols, rows]
+        bool rerank; // keep twice the budget and re-rank with the robust weights after the first solve
+    };
+
+    struct ImuConfig
+    {
+        bool enabled; // preintegrated gyroscope rotation as initial guess
+        double gyro_noise; // gyroscope noise density [rad/s/sqrt(Hz)]
+        std::vector<double> gyro_bias; // [rad/s]
+        double prior_weight; // weight of the rotation prior residual (0 disables it)
     };
 
     struct Config
@@ -55,6 +90,11 @@ namespace eds { namespace tracking{
         std::vector<double> loss_params;
         SolverOptions options;
         BOOTSTRAP_TYPE bootstrap; 
+        JACOBIAN_TYPE jacobian;
+        ::eds::utils::INTERPOLATOR_TYPE interpolator;
+        SCALAR_TYPE scalar;
+        PointSelectionConfig selection;
+        ImuConfig imu;
     };
 
     struct TrackerInfo
@@ -65,6 +105,35 @@ namespace eds { namespace tracking{
         int num_iterations;
         double time_seconds;
         uint8_t success;
+        uint16_t decimation; // event decimation factor of the event frame
+        uint8_t skipped_levels; // pyramid levels not solved
+        int saved_iterations; // max_num_iterations not run in all the levels
+        /** Stages of the optimization summed over the levels of the event frame [us] **/
+        double setup_time_us; // cost functions and problem setup
+        double solve_time_us; // solver iterations
+        double residuals_time_us; // keyframe residuals and loss parameters after the solve
+    };
+
+    struct EventFilterConfig
+    {
+        bool enabled;
+        /** Minimum time between two events of the same pixel **/
+        base::Time refractory_period;
+        /** Pixels firing above this rate are masked out [Hz] (0 disables it) **/
+        double hot_pixel_rate;
+        /** Period to update the hot pixel mask **/
+        base::Time hot_pixel_period;
+        /** Events without a neighbour event within this time are removed (0 disables it) **/
+        base::Time background_activity;
+    };
+
+    struct EventFilterInfo
+    {
+        uint64_t num_events; // input events
+        uint64_t num_hot_pixel; // removed by the hot pixel mask
+        uint64_t num_refractory; // removed by the refractory period
+        uint64_t num_background; // removed as background activity
+        uint32_t num_hot_pixels; // number of masked pixels
     };
 
     inline ::eds::tracking::LOSS_FUNCTION selectLoss(const std::string &loss_name)
@@ -77,6 +146,38 @@ namespace eds { namespace tracking{
             return eds::tracking::NONE;
     };
 
+    inline ::eds::tracking::PYRAMID_MODE selectPyramidMode(const std::string &mode_name)
+    {
+        if (mode_name.compare("downsample") == 0)
+            return eds::tracking::DOWNSAMPLE;
+        else
+            return eds::tracking::MORPHOLOGY;
+    };
+
+    inline ::eds::tracking::JACOBIAN_TYPE selectJacobian(const std::string &jacobian_name)
+    {
+        if (jacobian_name.compare("analytic") == 0)
+            return eds::tracking::ANALYTIC;
+        else
+            return eds::tracking::AUTODIFF;
+    };
+
+    inline ::eds::tracking::POINT_SELECTION selectPointSelection(const std::string &selection_name)
+    {
+        if (selection_name.compare("information") == 0)
+            return eds::tracking::INFORMATION;
+        else
+            return eds::tracking::ALL_POINTS;
+    };
+
+    inline ::eds::tracking::SCALAR_TYPE selectScalar(const std::string &scalar_name)
+    {
+        if (scalar_name.compare("float") == 0)
+            return eds::tracking::FLOAT;
+        else
+            return eds::tracking::DOUBLE;
+    };
+
     inline ::eds::tracking::LINEAR_SOLVER_TYPE selectSolver(const std::string &solver_name)
     {
         if (solver_name.compare("DENSE_QR") == 0)
@@ -95,7 +196,7 @@ namespace eds { namespace tracking{
 
         /** Number of points per frame **/
         tracker_config.percent_points = config["percent_points"].as<double>();
-        /** Config for tracker type (only ceres) **/
+        /** Config for tracker type (ceres or gauss_newton) **/
         tracker_config.type = config["type"].as<std::string>();
 
         if (config["bootstrapping"])
@@ -111,6 +212,29 @@ namespace eds { namespace tracking{
         else
             tracker_config.bootstrap = eds::tracking::EIGHT_POINTS;
 
+        /** Jacobians of the cost function (autodiff by default) **/
+        tracker_config.jacobian = (config["jacobian"])? eds::tracking::selectJacobian(config["jacobian"].as<std::string>()) : eds::tracking::AUTODIFF;
+        /** Event frame interpolation of the analytic cost function (ceres by default) **/
+        tracker_config.interpolator = (config["interpolator"])? eds::utils::selectInterpolator(config["interpolator"].as<std::string>()) : eds::utils::CERES_BICUBIC;
+        /** Event frame and tracking data in single or double precision (double by default) **/
+        tracker_config.scalar = (config["scalar"])? eds::tracking::selectScalar(config["scalar"].as<std::string>()) : eds::tracking::DOUBLE;
+
+        /** Tracking points selection (all the keyframe points by default) **/
+        YAML::Node tracker_selection = config["point_selection"];
+        tracker_config.selection.type = (tracker_selection)? eds::tracking::selectPointSelection(tracker_selection["type"].as<std::string>()) : eds::tracking::ALL_POINTS;
+        tracker_config.selection.budget = (tracker_selection && tracker_selection["budget"])? tracker_selection["budget"].as<int>() : 2000;
+        tracker_config.selection.grid = (tracker_selection && tracker_selection["grid"])? tracker_selection["grid"].as< std::vector<int> >() : std::vector<int>{8, 6};
+        if (tracker_config.selection.grid.size() != 2 || tracker_config.selection.grid[0] <= 0 || tracker_config.selection.grid[1] <= 0)
+            throw std::runtime_error("[TRACKER] point_selection grid should be two positive values [cols, rows]");
+        tracker_config.selection.rerank = (tracker_selection && tracker_selection["rerank"])? tracker_selection["rerank"].as<bool>() : false;
+
+        /** Inertial initial guess and prior (disabled by default) **/
+        YAML::Node tracker_imu = config["imu"];
+        tracker_config.imu.enabled = (tracker_imu && tracker_imu["enabled"])? tracker_imu["enabled"].as<bool>() : false;
+        tracker_config.imu.gyro_noise = (tracker_imu && tracker_imu["gyro_noise"])? tracker_imu["gyro_noise"].as<double>() : 1.7e-04;
+        tracker_config.imu.gyro_bias = (tracker_imu && tracker_imu["gyro_bias"])? tracker_imu["gyro_bias"].as< std::vector<double> >() : std::vector<double>{0.0, 0.0, 0.0};
+        tracker_config.imu.prior_weight = (tracker_imu && tracker_imu["prior_weight"])? tracker_imu["prior_weight"].as<double>() : 0.0;
+
         /** Config the loss **/
         YAML::Node tracker_loss = config["loss_function"];
         std::string loss_name = tracker_loss["type"].as<std::string>();
@@ -124,10 +248,33 @@ namespace eds { namespace tracking{
         tracker_config.options.max_num_iterations = tracker_options["max_num_iterations"].as< std::vector<int> > ();
         tracker_config.options.function_tolerance = tracker_options["function_tolerance"].as<double>();
         tracker_config.options.minimizer_progress_to_stdout = tracker_options["minimizer_progress_to_stdout"].as<bool>();
+        /** Global normalization of the model (per residual block by default) **/
+        tracker_config.options.global_norm = (tracker_options["global_norm"])? tracker_options["global_norm"].as<bool>() : false;
+        /** Pyramid schedule (static by default) **/
+        tracker_config.options.warm_start = (tracker_options["warm_start"])? tracker_options["warm_start"].as<bool>() : false;
+        tracker_config.options.skip_threshold = (tracker_options["skip_threshold"])? tracker_options["skip_threshold"].as<double>() : 0.0;
+        tracker_config.options.adaptive_iterations = (tracker_options["adaptive_iterations"])? tracker_options["adaptive_iterations"].as<bool>() : false;
 
         return tracker_config;
     };
 
+    inline ::eds::tracking::EventFilterConfig readEventFilterConfig(YAML::Node config)
+    {
+        ::eds::tracking::EventFilterConfig filter_config;
+
+        /** Disabled when there is no configuration **/
+        filter_config.enabled = (config)? (config["enabled"]? config["enabled"].as<bool>() : true) : false;
+        filter_config.refractory_period = base::Time::fromMicroseconds(
+                (config && config["refractory_period_us"])? config["refractory_period_us"].as<int64_t>() : 0);
+        filter_config.hot_pixel_rate = (config && config["hot_pixel_rate"])? config["hot_pixel_rate"].as<double>() : 0.0;
+        filter_config.hot_pixel_period = base::Time::fromMilliseconds(
+                (config && config["hot_pixel_period_ms"])? config["hot_pixel_period_ms"].as<int64_t>() : 1000);
+        filter_config.background_activity = base::Time::fromMicroseconds(
+                (config && config["background_activity_us"])? config["background_activity_us"].as<int64_t>() : 0);
+
+        return filter_config;
+    };
+
 } // tracking namespace
 } // end namespace
 
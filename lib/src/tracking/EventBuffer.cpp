@@ -0,0 +1,144 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EventBuffer.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <assert.h>
+#include <initializer_list>
+
+using namespace eds::tracking;
+
+EventBuffer::EventBuffer(const size_t &capacity)
+:head(0), count(0)
+{
+    this->x.resize(capacity); this->y.resize(capacity);
+    this->ts.resize(capacity);
+    this->polarity.resize((capacity + 63) / 64);
+}
+
+void EventBuffer::reserve(const size_t &capacity)
+{
+    if (capacity < this->count)
+        return;
+
+    /** Linearize the current events in the new columns **/
+    std::vector<uint16_t> new_x(capacity), new_y(capacity);
+    std::vector<int64_t> new_ts(capacity);
+    std::vector<uint64_t> new_polarity((capacity + 63) / 64, 0);
+    EventWindow w = this->window(this->count);
+    size_t i = 0;
+    for (const EventSpan *span : {&w.first, &w.second})
+    {
+        std::copy(span->x, span->x + span->size, new_x.begin() + i);
+        std::copy(span->y, span->y + span->size, new_y.begin() + i);
+        std::copy(span->ts, span->ts + span->size, new_ts.begin() + i);
+        for (size_t k=0; k<span->size; ++k, ++i)
+            new_polarity[i >> 6] |= uint64_t(span->getPolarity(k)) << (i & 63);
+    }
+
+    this->x.swap(new_x); this->y.swap(new_y);
+    this->ts.swap(new_ts); this->polarity.swap(new_polarity);
+    this->head = 0;
+}
+
+void EventBuffer::push(const std::vector<::base::samples::Event> &events)
+{
+    if (events.empty())
+        return;
+
+    /** Grow only when the events do not fit **/
+    this->grow(events.size());
+
+    /** Split the records in the columns **/
+    const size_t cap = this->capacity();
+    size_t tail = (this->head + this->count) % cap;
+    for (const ::base::samples::Event &ev : events)
+    {
+        this->x[tail] = ev.x; this->y[tail] = ev.y;
+        this->ts[tail] = ev.ts.toMicroseconds();
+        this->setPolarity(tail, ev.polarity);
+        if (++tail == cap) tail = 0;
+    }
+    this->count += events.size();
+}
+
+void EventBuffer::push(const ::base::samples::EventBatch &events)
+{
+    if (events.empty())
+        return;
+
+    /** Grow only when the events do not fit **/
+    this->grow(events.size());
+
+    /** Copy the columns in (at most) two spans: until the end of the storage and from the beginning **/
+    const size_t cap = this->capacity(), n = events.size();
+    const size_t tail = (this->head + this->count) % cap;
+    const size_t n_first = std::min(n, cap - tail);
+    std::copy(events.x.begin(), events.x.begin() + n_first, this->x.begin() + tail);
+    std::copy(events.x.begin() + n_first, events.x.end(), this->x.begin());
+    std::copy(events.y.begin(), events.y.begin() + n_first, this->y.begin() + tail);
+    std::copy(events.y.begin() + n_first, events.y.end(), this->y.begin());
+    std::copy(events.ts.begin(), events.ts.begin() + n_first, this->ts.begin() + tail);
+    std::copy(events.ts.begin() + n_first, events.ts.end(), this->ts.begin());
+    for (size_t i=0; i<n; ++i)
+        this->setPolarity((i < n_first)? tail + i : i - n_first, events.getPolarity(i));
+    this->count += n;
+}
+
+void EventBuffer::grow(const size_t &n)
+{
+    if (this->count + n <= this->capacity())
+        return;
+
+    size_t capacity = std::max(2 * this->capacity(), this->count + n);
+    #ifdef DEBUG_PRINTS
+    std::cout<<"[EVENT_BUFFER] growing capacity from "<<this->capacity()<<" to "<<capacity<<std::endl;
+    #endif
+    this->reserve(capacity);
+}
+
+EventWindow EventBuffer::window(const size_t &n) const
+{
+    assert(n <= this->count);
+    if (n == 0)
+        return EventWindow();
+
+    const size_t cap = this->capacity();
+    size_t n_first = std::min(n, cap - this->head);
+    return EventWindow(EventSpan(this->x.data() + this->head, this->y.data() + this->head, this->ts.data() + this->head,
+                                this->polarity.data(), this->head, n_first),
+                    EventSpan(this->x.data(), this->y.data(), this->ts.data(), this->polarity.data(), 0, n - n_first));
+}
+
+void EventBuffer::advance(const size_t &n)
+{
+    size_t m = std::min(n, this->count);
+    if (this->capacity() > 0)
+        this->head = (this->head + m) % this->capacity();
+    this->count -= m;
+}
+
+void EventBuffer::clear()
+{
+    this->head = 0;
+    this->count = 0;
+}
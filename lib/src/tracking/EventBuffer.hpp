@@ -0,0 +1,206 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EDS_EVENT_BUFFER_HPP_
+#define _EDS_EVENT_BUFFER_HPP_
+
+#include <base/samples/Event.hpp>
+#include <base/samples/EventBatch.hpp>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <stdint.h>
+
+namespace eds {
+namespace tracking {
+
+    /** Contiguous span of columnar events: coordinates, time stamps [us]
+     * and polarities packed in bits. The polarity of event i is the bit
+     * (offset + i) of the packed words **/
+    struct EventSpan
+    {
+        const uint16_t *x;
+        const uint16_t *y;
+        const int64_t *ts;
+        const uint64_t *polarity;
+        size_t offset;
+        size_t size;
+
+        EventSpan()
+        :x(nullptr), y(nullptr), ts(nullptr), polarity(nullptr), offset(0), size(0){};
+
+        EventSpan(const uint16_t *x, const uint16_t *y, const int64_t *ts, const uint64_t *polarity,
+                const size_t &offset, const size_t &size)
+        :x(x), y(y), ts(ts), polarity(polarity), offset(offset), size(size){};
+
+        inline bool getPolarity(const size_t &i) const
+        {
+            const size_t bit = this->offset + i;
+            return (this->polarity[bit >> 6] >> (bit & 63)) & 1u;
+        };
+    };
+
+    /** View of a window of columnar events. The window is stored in at
+     * most two contiguous spans (the second one is used when the window
+     * wraps around the end of the ring buffer). The event frames read
+     * only the columns they need (x, y and the polarity bit) **/
+    struct EventWindow
+    {
+        EventSpan first;
+        EventSpan second;
+
+        EventWindow(){};
+
+        EventWindow(const EventSpan &first, const EventSpan &second = EventSpan())
+        :first(first), second(second){};
+
+        /** Single span view of the events [begin, begin + n) of a batch (no copy) **/
+        EventWindow(const ::base::samples::EventBatch &batch, const size_t &begin = 0, const size_t &n = static_cast<size_t>(-1))
+        :first(batch.x.data() + begin, batch.y.data() + begin, batch.ts.data() + begin, batch.polarity.data(),
+                begin, std::min(n, batch.size() - std::min(begin, batch.size()))){};
+
+        inline size_t size() const {return this->first.size + this->second.size;};
+
+        inline bool empty() const {return this->size() == 0;};
+
+        inline uint16_t x(const size_t &i) const
+        {
+            return (i < this->first.size)? this->first.x[i] : this->second.x[i-this->first.size];
+        };
+
+        inline uint16_t y(const size_t &i) const
+        {
+            return (i < this->first.size)? this->first.y[i] : this->second.y[i-this->first.size];
+        };
+
+        /** Time stamp [us] of the event i **/
+        inline int64_t ts(const size_t &i) const
+        {
+            return (i < this->first.size)? this->first.ts[i] : this->second.ts[i-this->first.size];
+        };
+
+        inline bool getPolarity(const size_t &i) const
+        {
+            return (i < this->first.size)? this->first.getPolarity(i) : this->second.getPolarity(i-this->first.size);
+        };
+
+        inline ::base::Time getTime(const size_t &i) const {return ::base::Time::fromMicroseconds(this->ts(i));};
+
+        /** The event i as an Event record **/
+        inline ::base::samples::Event operator[](const size_t &i) const
+        {
+            return ::base::samples::Event(this->x(i), this->y(i), this->getTime(i), this->getPolarity(i));
+        };
+
+        inline ::base::samples::Event front() const {return (*this)[0];};
+
+        inline ::base::samples::Event back() const {return (*this)[this->size()-1];};
+
+        /** Number of events with time stamp before t (events are time
+         * ordered). Only the time stamps column is read **/
+        inline size_t lowerBound(const ::base::Time &t) const
+        {
+            const int64_t t_us = t.toMicroseconds();
+            if (this->second.size > 0 && this->second.ts[0] < t_us)
+                return this->first.size + (std::lower_bound(this->second.ts, this->second.ts + this->second.size, t_us) - this->second.ts);
+            return std::lower_bound(this->first.ts, this->first.ts + this->first.size, t_us) - this->first.ts;
+        };
+
+        /** Apply f(x, y, ts, polarity) to the events [begin, end) in order,
+         * one loop per span **/
+        template<typename F> inline void forEach(const size_t &begin, const size_t &end, F f) const
+        {
+            const size_t end_first = std::min(end, this->first.size);
+            for (size_t i=begin; i<end_first; ++i)
+                f(this->first.x[i], this->first.y[i], this->first.ts[i], this->first.getPolarity(i));
+            const size_t begin_second = std::max(begin, this->first.size) - this->first.size;
+            const size_t end_second = std::max(end, this->first.size) - this->first.size;
+            for (size_t i=begin_second; i<end_second; ++i)
+                f(this->second.x[i], this->second.y[i], this->second.ts[i], this->second.getPolarity(i));
+        };
+
+        template<typename F> inline void forEach(F f) const
+        {
+            this->forEach(0, this->size(), f);
+        };
+    };
+
+    /** Fixed-capacity ring buffer of events stored in columns (x, y,
+     * time stamps and packed polarities: 12.125 bytes per event instead
+     * of a 24 bytes Event record). Events are inserted at the tail and
+     * consumed from the head (read cursor). Consuming events only moves
+     * the read cursor, no data is moved or copied **/
+    class EventBuffer
+    {
+        private:
+            /** Columns of capacity elements **/
+            std::vector<uint16_t> x, y;
+            std::vector<int64_t> ts;
+            std::vector<uint64_t> polarity;
+            /** Index of the oldest event (read cursor) **/
+            size_t head;
+            /** Number of events in the buffer **/
+            size_t count;
+
+            /** @brief Make room for n more events **/
+            void grow(const size_t &n);
+
+            inline void setPolarity(const size_t &i, const bool &p)
+            {
+                const uint64_t mask = uint64_t(1) << (i & 63);
+                if (p) this->polarity[i >> 6] |= mask;
+                else this->polarity[i >> 6] &= ~mask;
+            };
+
+        public:
+            /** @brief Default constructor **/
+            EventBuffer(const size_t &capacity = 0);
+
+            /** @brief Allocate the storage. Events in the buffer are kept **/
+            void reserve(const size_t &capacity);
+
+            /** @brief Insert events at the tail. The buffer grows
+             * (only) when the events do not fit in the capacity **/
+            void push(const std::vector<::base::samples::Event> &events);
+
+            /** @brief Insert a columnar batch of events at the tail (column copies) **/
+            void push(const ::base::samples::EventBatch &events);
+
+            /** @brief View of the first n events from the read cursor **/
+            EventWindow window(const size_t &n) const;
+
+            /** @brief Move the read cursor n events forward **/
+            void advance(const size_t &n);
+
+            void clear();
+
+            inline size_t size() const {return this->count;};
+
+            inline bool empty() const {return this->count == 0;};
+
+            inline size_t capacity() const {return this->x.size();};
+
+            inline ::base::samples::Event front() const {return this->window(1).front();};
+    };
+
+} //tracking namespace
+} // end namespace
+
+#endif // _EDS_EVENT_BUFFER_HPP_
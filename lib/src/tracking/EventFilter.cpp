@@ -0,0 +1,178 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EventFilter.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <iostream>
+
+using namespace eds::tracking;
+
+/** Time stamp of pixels without events (far in the past, no overflow in differences) **/
+static constexpr int64_t NO_EVENT = std::numeric_limits<int64_t>::min() / 2;
+
+EventFilter::EventFilter(const EventFilterConfig &config, const uint16_t &height, const uint16_t &width)
+:config(config), height(height), width(width), stride(width + 2)
+{
+    this->reset();
+}
+
+void EventFilter::reset()
+{
+    const size_t size = (this->width + 2) * (this->height + 2);
+    this->last_ts.assign(size, NO_EVENT);
+    this->count.assign(size, 0);
+    this->hot.assign(size, 0);
+    this->period_start = NO_EVENT;
+    this->info = EventFilterInfo{0, 0, 0, 0, 0};
+}
+
+void EventFilter::updateHotPixels(const int64_t &ts)
+{
+    if (this->config.hot_pixel_rate <= 0.0)
+        return;
+
+    if (this->period_start == NO_EVENT)
+    {
+        this->period_start = ts;
+        return;
+    }
+
+    const int64_t period = ts - this->period_start;
+    if (period < this->config.hot_pixel_period.toMicroseconds())
+        return;
+
+    /** Pixels above the rate are masked for the next period **/
+    const uint32_t max_count = static_cast<uint32_t>(this->config.hot_pixel_rate * period * 1e-06);
+    uint32_t num_hot = 0;
+    for (size_t p=0; p<this->count.size(); ++p)
+    {
+        this->hot[p] = this->count[p] > max_count;
+        num_hot += this->hot[p];
+    }
+    std::fill(this->count.begin(), this->count.end(), 0);
+    this->period_start = ts;
+    this->info.num_hot_pixels = num_hot;
+}
+
+template<typename X, typename Y, typename T>
+void EventFilter::flags(const size_t &n, X x, Y y, T ts)
+{
+    const int64_t refractory = this->config.refractory_period.toMicroseconds();
+    const int64_t ba_time = this->config.background_activity.toMicroseconds();
+    const uint8_t use_ba = ba_time > 0;
+    const size_t stride = this->stride;
+    int64_t *last = this->last_ts.data();
+    uint32_t *cnt = this->count.data();
+    const uint8_t *hot = this->hot.data();
+
+    this->keep.resize(n);
+    uint8_t *keep = this->keep.data();
+    uint64_t n_hot = 0, n_refractory = 0, n_background = 0;
+
+    /** The flags are computed with arithmetic and selects (no branches).
+     * Events of the same pixel depend on each other through the time
+     * stamp map, so the loop is sequential **/
+    for (size_t i=0; i<n; ++i)
+    {
+        const uint16_t ex = x(i), ey = y(i);
+        const uint8_t valid = (ex < this->width) & (ey < this->height);
+        /** Events out of the image read (but do not update) the first pixel **/
+        const size_t p = valid? (ey + 1) * stride + ex + 1 : stride + 1;
+        const int64_t t = ts(i);
+
+        const uint8_t h = hot[p];
+        const uint8_t r = (t - last[p]) < refractory;
+
+        /** Newest event in the 8 neighbours **/
+        const int64_t *r0 = last + p - stride - 1, *r1 = last + p - 1, *r2 = last + p + stride - 1;
+        const int64_t newest = std::max(std::max(std::max(r0[0], r0[1]), std::max(r0[2], r1[0])),
+                                        std::max(std::max(r1[2], r2[0]), std::max(r2[1], r2[2])));
+        const uint8_t b = use_ba & ((t - newest) > ba_time);
+
+        /** Events out of the image are removed but not counted in a rule **/
+        keep[i] = valid & !(h | r | b);
+        n_hot += valid & h;
+        n_refractory += valid & (!h) & r;
+        n_background += valid & (!h) & (!r) & b;
+
+        /** Hot pixels do not update the map (they do not support neighbours) **/
+        cnt[p] += valid;
+        last[p] = (h | !valid)? last[p] : t;
+    }
+
+    this->info.num_events += n;
+    this->info.num_hot_pixel += n_hot;
+    this->info.num_refractory += n_refractory;
+    this->info.num_background += n_background;
+}
+
+size_t EventFilter::filter(std::vector<::base::samples::Event> &events)
+{
+    if (!this->config.enabled || events.empty())
+        return events.size();
+
+    this->updateHotPixels(events.front().ts.toMicroseconds());
+    this->flags(events.size(),
+            [&events](const size_t &i){return events[i].x;},
+            [&events](const size_t &i){return events[i].y;},
+            [&events](const size_t &i){return events[i].ts.toMicroseconds();});
+
+    /** Stream compaction: always write, advance only for the kept ones **/
+    size_t j = 0;
+    for (size_t i=0; i<events.size(); ++i)
+    {
+        events[j] = events[i];
+        j += this->keep[i];
+    }
+    events.resize(j);
+    return j;
+}
+
+size_t EventFilter::filter(::base::samples::EventBatch &events)
+{
+    if (!this->config.enabled || events.empty())
+        return events.size();
+
+    this->updateHotPixels(events.ts.front());
+    this->flags(events.size(),
+            [&events](const size_t &i){return events.x[i];},
+            [&events](const size_t &i){return events.y[i];},
+            [&events](const size_t &i){return events.ts[i];});
+
+    /** Stream compaction of the columns. Bit j (j <= i) is written after reading bit i **/
+    size_t j = 0;
+    for (size_t i=0; i<events.size(); ++i)
+    {
+        const uint64_t p = events.getPolarity(i);
+        events.x[j] = events.x[i];
+        events.y[j] = events.y[i];
+        events.ts[j] = events.ts[i];
+        uint64_t &word = events.polarity[j >> 6];
+        word = (word & ~(uint64_t(1) << (j & 63))) | (p << (j & 63));
+        j += this->keep[i];
+    }
+    events.x.resize(j); events.y.resize(j); events.ts.resize(j);
+    events.polarity.resize((j + 63) / 64);
+    if (j & 63)
+        events.polarity.back() &= (uint64_t(1) << (j & 63)) - 1;
+    return j;
+}
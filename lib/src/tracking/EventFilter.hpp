@@ -0,0 +1,80 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EDS_EVENT_FILTER_HPP_
+#define _EDS_EVENT_FILTER_HPP_
+
+#include <eds/tracking/Config.hpp>
+
+#include <base/samples/Event.hpp>
+#include <base/samples/EventBatch.hpp>
+
+#include <vector>
+
+namespace eds {
+namespace tracking {
+
+    /** Event pre-filter: hot pixel mask, refractory period and background
+     * activity suppression. The filter keeps per pixel state (last time
+     * stamp and event count) between calls. The maps are padded with a one
+     * pixel border so the neighbourhood test has no bound checks **/
+    class EventFilter
+    {
+        private:
+            EventFilterConfig config;
+            uint16_t height, width;
+            /** Padded width (width + 2) **/
+            size_t stride;
+            /** Last event time per pixel [us] (padded) **/
+            std::vector<int64_t> last_ts;
+            /** Events per pixel in the current hot pixel period (padded) **/
+            std::vector<uint32_t> count;
+            /** 1 for hot pixels (padded) **/
+            std::vector<uint8_t> hot;
+            /** Keep flag per event of the current call **/
+            std::vector<uint8_t> keep;
+            /** Start of the hot pixel period [us] **/
+            int64_t period_start;
+            EventFilterInfo info;
+
+            /** Compute the keep flags. x, y and ts are accessed with the functors **/
+            template<typename X, typename Y, typename T>
+            void flags(const size_t &n, X x, Y y, T ts);
+
+            void updateHotPixels(const int64_t &ts);
+
+        public:
+            /** @brief Default constructor **/
+            EventFilter(const EventFilterConfig &config, const uint16_t &height, const uint16_t &width);
+
+            /** @brief Filter in place. Returns the number of kept events **/
+            size_t filter(std::vector<::base::samples::Event> &events);
+
+            size_t filter(::base::samples::EventBatch &events);
+
+            void reset();
+
+            const EventFilterInfo& getInfo() const {return this->info;};
+    };
+
+} //tracking namespace
+} // end namespace
+
+#endif // _EDS_EVENT_FILTER_HPP_
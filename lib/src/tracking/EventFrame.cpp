@@ -24,6 +24,11 @@ using namespace eds::tracking;
 
 EventFrame::EventFrame(const ::eds::calib::Camera &cam, const ::eds::calib::Camera &newcam, const std::string &distortion_model)
 {
+    this->decimation = 1; this->num_threads = 1; this->level_threads = 1; this->first_event = 0;
+    this->incremental = false; this->num_slides = 0;
+    this->pyramid_mode = ::eds::tracking::MORPHOLOGY;
+    this->scalar = ::eds::tracking::DOUBLE;
+    this->level_sync = std::make_shared<LevelSync>();
     this->K = cam.K.clone();
     this->D = cam.D.clone();
     this->R_rect = newcam.R * cam.R.t();
@@ -68,6 +73,10 @@ EventFrame::EventFrame(const ::eds::calib::Camera &cam, const ::eds::calib::Came
         cv::fisheye::undistortPoints(coord, undist_coord, this->K, this->D, this->R_rect, this->K_ref);
     }
 
+    /** Packed look-up table (same order than the points: y * width + x) **/
+    this->undist_lut = undist_coord;
+    this->lut_width = newcam.size.width;
+
     /** Reshape to get the forward maps **/
     this->fwd_mapx = cv::Mat_<float>::eye(newcam.size.height, newcam.size.width);
     this->fwd_mapy = cv::Mat_<float>::eye(newcam.size.height, newcam.size.width);
@@ -111,55 +120,97 @@ EventFrame::EventFrame(const ::eds::calib::Camera &cam, const ::eds::calib::Came
     std::cout<<" forward mapy: "<<this->fwd_mapy.rows<<" x "<<this->fwd_mapy.cols<<std::endl;
 }
 
-EventFrame::EventFrame(const uint64_t &idx, const std::vector<base::samples::Event> &events,
-                    const ::eds::calib::CameraInfo &cam_info, const int &num_levels,
-                    const ::base::Affine3d &T,
-                    const cv::Size &out_size)
+EventFrame::~EventFrame()
 {
-    cv::Mat K, D, R_rect, P;
-    R_rect  = cv::Mat_<double>::eye(3, 3);
-    K = cv::Mat_<double>::eye(3, 3);
-    K.at<double>(0,0) = cam_info.intrinsics[0];
-    K.at<double>(1,1) = cam_info.intrinsics[1];
-    K.at<double>(0,2) = cam_info.intrinsics[2];
-    K.at<double>(1,2) = cam_info.intrinsics[3];
+    this->waitLevels();
+
+    /** Stop the level workers (they use this frame) **/
+    if (this->level_sync)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(this->level_sync->mutex);
+            this->level_sync->running = false;
+        }
+        this->level_sync->work.notify_all();
+        this->level_sync->workers.join_all();
+    }
+}
 
-    D = cv::Mat_<double>::zeros(4, 1);
-    for (size_t i=0; i<cam_info.D.size(); ++i)
+namespace
+{
+    /** Intrinsic matrix of the camera info **/
+    cv::Mat intrinsicMatrix(const ::eds::calib::CameraInfo &cam_info)
     {
-        D.at<double>(i, 0) = cam_info.D[i];
+        cv::Mat K = cv::Mat_<double>::eye(3, 3);
+        K.at<double>(0,0) = cam_info.intrinsics[0];
+        K.at<double>(1,1) = cam_info.intrinsics[1];
+        K.at<double>(0,2) = cam_info.intrinsics[2];
+        K.at<double>(1,2) = cam_info.intrinsics[3];
+        return K;
     }
 
-    if (cam_info.P.size() == 12)
+    /** Distortion coefficients of the camera info **/
+    cv::Mat distortionMatrix(const ::eds::calib::CameraInfo &cam_info)
     {
-        P = cv::Mat_<double>::zeros(4, 4);
-        for (auto row=0; row<P.rows; ++row)
+        cv::Mat D = cv::Mat_<double>::zeros(4, 1);
+        for (size_t i=0; i<cam_info.D.size() && i<4; ++i)
         {
-            for (auto col=0; col<P.cols; ++col)
+            D.at<double>(i, 0) = cam_info.D[i];
+        }
+        return D;
+    }
+
+    /** Rectification matrix of the camera info (identity when not given) **/
+    cv::Mat rectificationMatrix(const ::eds::calib::CameraInfo &cam_info)
+    {
+        cv::Mat R_rect = cv::Mat_<double>::eye(3, 3);
+        if (cam_info.R.size() == 9)
+        {
+            for (auto row=0; row<R_rect.rows; ++row)
             {
-                P.at<double>(row, col) = cam_info.P[(P.cols*row)+col];
+                for (auto col=0; col<R_rect.cols; ++col)
+                {
+                    R_rect.at<double>(row, col) = cam_info.R[(R_rect.cols*row)+col];
+                }
             }
         }
+        return R_rect;
     }
 
-    if (cam_info.R.size() == 9)
+    /** 3x4 projection matrix of the camera info (empty when not given) **/
+    cv::Mat projectionMatrix(const ::eds::calib::CameraInfo &cam_info)
     {
-        for (auto row=0; row<R_rect.rows; ++row)
+        cv::Mat P;
+        if (cam_info.P.size() == 12)
         {
-            for (auto col=0; col<R_rect.cols; ++col)
+            P = cv::Mat_<double>::zeros(3, 4);
+            for (auto row=0; row<P.rows; ++row)
             {
-                R_rect.at<double>(row, col) = cam_info.R[(R_rect.cols*row)+col];
+                for (auto col=0; col<P.cols; ++col)
+                {
+                    P.at<double>(row, col) = cam_info.P[(P.cols*row)+col];
+                }
             }
         }
+        return P;
     }
+}
 
-    (*this) = EventFrame(idx, events, cam_info.height, cam_info.width, K, D, R_rect, P, cam_info.distortion_model, num_levels, T, out_size);
+EventFrame::EventFrame(const uint64_t &idx, const std::vector<base::samples::Event> &events,
+                    const ::eds::calib::CameraInfo &cam_info, const int &num_levels,
+                    const ::base::Affine3d &T,
+                    const cv::Size &out_size)
+            :EventFrame(idx, events, cam_info.height, cam_info.width, intrinsicMatrix(cam_info), distortionMatrix(cam_info),
+                    rectificationMatrix(cam_info), projectionMatrix(cam_info), cam_info.distortion_model, num_levels, T, out_size)
+{
 }
 
 EventFrame::EventFrame(const uint64_t &idx, const std::vector<base::samples::Event> &events, const uint16_t height, const uint16_t width,
-            cv::Mat &K, cv::Mat &D, cv::Mat &R_rect, cv::Mat &P, const std::string distortion_model, const int &num_levels,
+            const cv::Mat &K, const cv::Mat &D, const cv::Mat &R_rect, const cv::Mat &P, const std::string distortion_model, const int &num_levels,
             const ::base::Affine3d &T, const cv::Size &out_size)
-            :idx(idx), height(height), width(width), distortion_model(distortion_model), T_w_ef(T)
+            :idx(idx), height(height), width(width), lut_width(0), first_event(0), distortion_model(distortion_model), T_w_ef(T), decimation(1), num_threads(1), level_threads(1), incremental(false), pyramid_mode(::eds::tracking::MORPHOLOGY),
+            scalar(::eds::tracking::DOUBLE), num_slides(0),
+            level_sync(std::make_shared<LevelSync>())
 {
 
     if (P.total()>0)
@@ -225,7 +276,7 @@ EventFrame::EventFrame(const uint64_t &idx, const std::vector<base::samples::Eve
     }
 
     /**  Compute brightness change event frame (undistorted) per pyramid level **/
-    cv::Mat event_img = eds::utils::drawValuesPoints(this->undist_coord, this->pol, height, width, "bilinear", 0.5, true);
+    cv::Mat event_img = eds::utils::drawValuesPoints(this->undist_coord, this->pol, this->height, this->width, "bilinear", 0.5, true);
     cv::Size size = event_img.size();
 
     /** Check if the input image should be rescale **/
@@ -284,7 +335,7 @@ EventFrame::EventFrame(const uint64_t &idx, const std::vector<base::samples::Eve
         this->event_frame.push_back(frame_item);
         ++id;
     }
-    std::cout<<"[EVENT_FRAME] Created ID["<<this->idx<<"] with: "<<events.size()
+    std::cout<<"[EVENT_FRAME] Created ID["<<this->idx<<"] with: "<<this->coord.size()
                 <<" events. start time "<<first_time.toMicroseconds()<<" end time "
                 <<last_time.toMicroseconds()<<std::endl;
     std::cout<<"[EVENT_FRAME] event frame ["<<std::addressof(this->event_frame)<<"] size:"<<this->event_frame.size()<<std::endl;
@@ -303,103 +354,466 @@ void EventFrame::create(const uint64_t &idx, const std::vector<base::samples::Ev
             const uint16_t height, const uint16_t width, const int &num_levels,
             const ::base::Affine3d &T, const cv::Size &out_size)
 {
-    /** Clean before inserting**/
-    this->clear();
+    /** Columnar copy of the records (the windows of the ring buffer are columnar) **/
+    ::base::samples::EventBatch batch;
+    batch.append(events);
+    return this->create(idx, ::eds::tracking::EventWindow(batch), height, width, num_levels, T, out_size);
+}
+
+void EventFrame::create(const uint64_t &idx, const ::eds::tracking::EventWindow &events,
+                    const ::eds::calib::CameraInfo &cam_info, const int &num_levels,
+                    const ::base::Affine3d &T,
+                    const cv::Size &out_size)
+{
+    return this->create(idx, events, cam_info.height, cam_info.width, num_levels, T, out_size);
+}
+
+void EventFrame::create(const uint64_t &idx, const ::eds::tracking::EventWindow &events,
+            const uint16_t height, const uint16_t width, const int &num_levels,
+            const ::base::Affine3d &T, const cv::Size &out_size)
+{
+    /** Nothing to create: the current frame is kept **/
+    if (events.empty())
+    {
+        std::cout<<"[EVENT_FRAME] No events to create ID["<<idx<<"]"<<std::endl;
+        return;
+    }
+
+    /** Clean before inserting (the capacity is kept) **/
+    this->coord.clear(); this->undist_coord.clear(); this->pol.clear();
+    this->first_event = 0;
 
     /** Input idx and size **/
     this->idx = idx; this->height = height; this->width = width; this->T_w_ef = T;
 
-    /** Get the coordinates, undistort coordinates, events and polarity **/
-    for (auto it=events.begin(); it!=events.end(); ++it)
+    /** Get the coordinates, undistort coordinates and polarity. Only the
+     * x, y and polarity columns are read. With decimation the kept events
+     * are weighted by the decimation factor **/
+    const size_t k = this->decimation;
+    const int8_t w = static_cast<int8_t>(k);
+    const size_t n = (events.size() + k - 1) / k;
+    this->coord.reserve(n); this->undist_coord.reserve(n); this->pol.reserve(n);
+    size_t i = 0;
+    events.forEach([this, &i, k, w](const uint16_t &x, const uint16_t &y, const int64_t &, const bool &p)
     {
-        this->coord.push_back(cv::Point2d(it->x, it->y));
-        this->undist_coord.push_back(cv::Point2d(this->fwd_mapx.at<float>(it->y, it->x),
-                                                 this->fwd_mapy.at<float>(it->y, it->x)));
-        this->pol.push_back((it->polarity)?1:-1);
-        if (it == events.begin())
-            this->first_time = it->ts;
-        else if ((it+1) == events.end())
-            this->last_time = it->ts;
+        if ((i++ % k) != 0) return;
+        const cv::Point2f &u = this->undist_lut[y * this->lut_width + x];
+        this->coord.push_back(cv::Point2d(x, y));
+        this->undist_coord.push_back(cv::Point2d(u.x, u.y));
+        this->pol.push_back((p)?w:-w);
+    });
+    this->first_time = events.getTime(0);
+    this->last_time = events.getTime(events.size()-1);
+
+    /** Frame time as the median event time **/
+    this->time = events.getTime(events.size()/2);
+
+    return this->createFrames(num_levels, out_size);
+}
+
+void EventFrame::create(const uint64_t &idx, const ::base::samples::EventBatch &events,
+                    const ::eds::calib::CameraInfo &cam_info, const int &num_levels,
+                    const ::base::Affine3d &T,
+                    const cv::Size &out_size)
+{
+    return this->create(idx, events, cam_info.height, cam_info.width, num_levels, T, out_size);
+}
+
+void EventFrame::create(const uint64_t &idx, const ::base::samples::EventBatch &events,
+            const uint16_t height, const uint16_t width, const int &num_levels,
+            const ::base::Affine3d &T, const cv::Size &out_size)
+{
+    return this->create(idx, ::eds::tracking::EventWindow(events), height, width, num_levels, T, out_size);
+}
+
+void EventFrame::slide(const uint64_t &idx, const ::eds::tracking::EventWindow &events, const size_t &num_removed,
+                    const ::eds::calib::CameraInfo &cam_info, const int &num_levels,
+                    const ::base::Affine3d &T,
+                    const cv::Size &out_size)
+{
+    return this->slide(idx, events, num_removed, cam_info.height, cam_info.width, num_levels, T, out_size);
+}
+
+void EventFrame::slide(const uint64_t &idx, const ::eds::tracking::EventWindow &events, const size_t &num_removed,
+            const uint16_t height, const uint16_t width, const int &num_levels,
+            const ::base::Affine3d &T, const cv::Size &out_size)
+{
+    /** Events of the current frame which are still in the window **/
+    const size_t num_events = this->pol.size() - this->first_event;
+    const size_t num_kept = (num_removed < num_events)? num_events - num_removed : 0;
+
+    /** Full rebuild when there is nothing to reuse. The accumulator of a
+     * decimated frame has other events and weights (num_slides is max_slides) **/
+    if (!this->incremental || this->decimation != 1 || num_kept == 0 || num_kept > events.size()
+        || this->accumulator.rows != height || this->accumulator.cols != width
+        || this->num_slides >= EventFrame::max_slides)
+    {
+        return this->create(idx, events, height, width, num_levels, T, out_size);
     }
 
+    /** Input idx and size **/
+    this->idx = idx; this->height = height; this->width = width; this->T_w_ef = T;
+
+    /** Remove the contribution of the events leaving the window **/
+    double *acc = this->accumulator.ptr<double>();
+    eds::utils::addPoints(this->undist_coord.data() + this->first_event, this->pol.data() + this->first_event, num_removed,
+                    height, width, eds::utils::BILINEAR, acc, this->accumulator.step1(), -1.0);
+    this->first_event += num_removed;
+
+    /** Compact once the removed events outnumber the kept ones: each event
+     * is moved at most once per window (amortized, no front erase per slide) **/
+    if (this->first_event > num_kept)
+    {
+        this->coord.erase(this->coord.begin(), this->coord.begin() + this->first_event);
+        this->undist_coord.erase(this->undist_coord.begin(), this->undist_coord.begin() + this->first_event);
+        this->pol.erase(this->pol.begin(), this->pol.begin() + this->first_event);
+        this->first_event = 0;
+    }
+
+    /** Undistort and add only the new events **/
+    events.forEach(num_kept, events.size(), [this](const uint16_t &x, const uint16_t &y, const int64_t &, const bool &p)
+    {
+        const cv::Point2f &u = this->undist_lut[y * this->lut_width + x];
+        this->coord.push_back(cv::Point2d(x, y));
+        this->undist_coord.push_back(cv::Point2d(u.x, u.y));
+        this->pol.push_back((p)?1:-1);
+    });
+    const size_t first_new = this->first_event + num_kept;
+    eds::utils::addPoints(this->undist_coord.data() + first_new, this->pol.data() + first_new, events.size() - num_kept,
+                    height, width, eds::utils::BILINEAR, acc, this->accumulator.step1());
+    this->num_slides++;
+
+    this->first_time = events.getTime(0);
+    this->last_time = events.getTime(events.size()-1);
+
+    /** Frame time as the median event time **/
+    this->time = events.getTime(events.size()/2);
+
+    return this->createLevels(num_levels, out_size);
+}
+
+void EventFrame::setTimeSurface(const ::base::Time &decay)
+{
+    /** Sensor size from the undistortion look-up table **/
+    if (decay.toMicroseconds() > 0 && this->lut_width > 0)
+        this->time_surface = ::eds::tracking::TimeSurface(this->undist_lut.size() / this->lut_width,
+                                                    this->lut_width, decay.toMicroseconds());
+    else
+        this->time_surface = ::eds::tracking::TimeSurface();
+}
+
+void EventFrame::insert(const ::eds::tracking::EventWindow &events, const size_t &begin, const size_t &end)
+{
+    events.forEach(begin, end, [this](const uint16_t &x, const uint16_t &y, const int64_t &ts, const bool &p)
+    {
+        const cv::Point2f &u = this->undist_lut[y * this->lut_width + x];
+        this->time_surface.add(u.x, u.y, (p)?1:-1, ts);
+    });
+}
+
+void EventFrame::createAt(const uint64_t &idx, const ::base::Time &time,
+                    const ::eds::calib::CameraInfo &cam_info, const int &num_levels,
+                    const ::base::Affine3d &T,
+                    const cv::Size &out_size)
+{
+    return this->createAt(idx, time, cam_info.height, cam_info.width, num_levels, T, out_size);
+}
+
+void EventFrame::createAt(const uint64_t &idx, const ::base::Time &time,
+            const uint16_t height, const uint16_t width, const int &num_levels,
+            const ::base::Affine3d &T, const cv::Size &out_size)
+{
+    /** Input idx and size **/
+    this->idx = idx; this->height = height; this->width = width; this->T_w_ef = T;
+
+    /** No window of events: the next slide() rebuilds the frame **/
+    this->coord.clear(); this->undist_coord.clear(); this->pol.clear();
+    this->first_event = 0;
+    this->num_slides = EventFrame::max_slides;
+
+    /** The accumulator is the decayed surface. The frame spans one time constant **/
+    this->time_surface.query(time.toMicroseconds(), this->accumulator);
+    this->time = this->last_time = time;
+    this->first_time = time - ::base::Time::fromMicroseconds(this->time_surface.getDecay());
+
+    return this->createLevels(num_levels, out_size);
+}
+
+void EventFrame::createFrames(const int &num_levels, const cv::Size &out_size)
+{
+    /**  Accumulate the brightness change (undistorted). The exponential
+     * time weights are only used when the frame is not incremental **/
+    eds::utils::drawValuesPoints(this->undist_coord, this->pol, this->height, this->width, "bilinear", 0.0, !this->incremental,
+                            this->accumulator, &(this->accumulate_buffers), this->num_threads);
+
+    /** Decimated events cannot be removed one by one: the next slide() rebuilds **/
+    this->num_slides = (this->decimation > 1)? EventFrame::max_slides : 0;
+
+    return this->createLevels(num_levels, out_size);
+}
+
+void EventFrame::createLevels(const int &num_levels, const cv::Size &out_size)
+{
     if (first_time.toMicroseconds() > last_time.toMicroseconds())
     {
         std::string error_message = std::string("[EVENT_FRAME] FATAL ERROR Event time[0] > event time [N-1] ");
         throw std::runtime_error(error_message);
     }
 
-    /** Frame time as the median event time **/
-    auto it = events.begin(); std::advance(it, events.size()/2);
-    this->time = it->ts;
-
     /** Delta time of this event frame **/
     this->delta_time = (last_time - first_time);
 
-    /**  Compute brightness change event frame (undistorted) per pyramid level **/
-    cv::Mat event_img = eds::utils::drawValuesPoints(this->undist_coord, this->pol, height, width, "bilinear", 0.5, true);
-    cv::Size size = event_img.size();
+    /**  Event frame per pyramid level from the accumulated events. Each
+     * level is stored once in event_frame[i] (event_frame_f[i] in single
+     * precision), frame[i] is a cv::Mat header on the same memory. The
+     * storage is kept between event frames **/
+    const bool scaled = (this->out_scale[0] != 1 || this->out_scale[1] != 1);
+    const bool downsample = (this->pyramid_mode == ::eds::tracking::DOWNSAMPLE);
+    cv::Size level_size = (scaled)? out_size : this->accumulator.size();
+
+    /** Levels of the previous frame still running **/
+    this->waitLevels();
+    const bool single = (this->scalar == ::eds::tracking::FLOAT);
+    this->frame.resize(num_levels);
+    this->event_frame.resize((single)? 0 : num_levels);
+    this->event_frame_f.resize((single)? num_levels : 0);
+    this->level_scale.resize(num_levels);
+    for (int i=0; i<num_levels; ++i)
+    {
+        if (single)
+        {
+            this->event_frame_f[i].resize(level_size.area());
+            this->frame[i] = cv::Mat(level_size, CV_32FC1, this->event_frame_f[i].data());
+        }
+        else
+        {
+            this->event_frame[i].resize(level_size.area());
+            this->frame[i] = cv::Mat(level_size, CV_64FC1, this->event_frame[i].data());
+        }
+        this->level_scale[i] = (downsample)? std::ldexp(1.0, -i) : 1.0;
+        /** cv::pyrDown size (pixel x of the level is pixel 2x of the previous one) **/
+        if (downsample)
+            level_size = cv::Size((level_size.width + 1)/2, (level_size.height + 1)/2);
+    }
 
-    if (this->out_scale[0] != 1 || this->out_scale[1] != 1)
+    /** Level 0 in double and converted to single precision once **/
+    cv::Mat &level_0 = (single)? this->level_img : this->frame[0];
+    if (scaled)
     {
+        eds::utils::blurValuesPoints(this->accumulator, this->event_img, 0.5);
         this->width /= this->out_scale[0]; this->height /= this->out_scale[1];
-        cv::resize(event_img, event_img, out_size, cv::INTER_CUBIC);
-        size = event_img.size();
+        cv::resize(this->event_img, level_0, out_size, cv::INTER_CUBIC);
     }
-
-    this->frame.push_back(event_img);
-    for (int i=1; i<num_levels; ++i)
+    else
     {
-        cv::Mat event_img_dilate, event_img_erode;
-        cv::Mat element = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2*i + 1, 2*i + 1), cv::Point(i, i));
-        cv::dilate(event_img, event_img_dilate, element);
-        cv::erode(event_img, event_img_erode, element);
-        this->frame.push_back(event_img_dilate + event_img_erode);
+        eds::utils::blurValuesPoints(this->accumulator, level_0, 0.5);
     }
+    if (single)
+        level_0.convertTo(this->frame[0], CV_32FC1);
 
-    /** Norm of the event frame **/
-    for (auto f=frame.begin(); f!=frame.end(); ++f)
+    this->norm.resize(num_levels);
+    if (downsample)
     {
-        double n_f = cv::norm (*f);
-        this->norm.push_back(n_f);
+        /** Gaussian blur and downsample of the previous level (each level
+         * needs the previous one, at a quarter of the cost) **/
+        for (int i=1; i<num_levels; ++i)
+            cv::pyrDown(this->frame[i-1], this->frame[i], this->frame[i].size());
+        for (int i=0; i<num_levels; ++i)
+            this->normalizeLevel(i);
     }
-
-    /** Normalized event frame **/
-    int id = 0; this->event_frame.clear();
-    for (auto &it : this->frame)
+    else
     {
-        std::vector<double> frame_item;
-        for (int row=0; row<it.rows; row++)
+        if (this->morph_elements.size() != (size_t)num_levels)
         {
-            for (int col=0; col<it.cols;col++)
+            this->morph_elements.resize(num_levels);
+            for (int i=1; i<num_levels; ++i)
+                this->morph_elements[i] = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2*i + 1, 2*i + 1), cv::Point(i, i));
+        }
+
+        /** Level 0 is normalized once the other levels are built from it **/
+        if (this->level_threads > 1 && num_levels > 1)
+        {
+            /** Up to level_threads persistent workers. The tracker waits only for
+             * the level it solves (coarse first) while the others are still built.
+             * The workers are idle here: their erode images can be reallocated **/
+            LevelSync &sync = *(this->level_sync);
+            const size_t num_workers = std::min<size_t>(this->level_threads, num_levels - 1);
+            if (this->img_erode.size() < num_workers)
+                this->img_erode.resize(num_workers);
+            while (sync.workers.size() < num_workers)
+                sync.workers.create_thread(boost::bind(&EventFrame::levelWorker, this, sync.workers.size()));
             {
-                /** When using PhotometricError cost function  **/
-                frame_item.push_back(it.at<double>(row,col)/this->norm[id]);
-                /** When using PhotometricErrorNC cost function **/
-                //frame_item.push_back(it.at<double>(row,col));
+                boost::lock_guard<boost::mutex> lock(sync.mutex);
+                sync.ready.assign(num_levels, 0);
+                sync.todo.clear();
+                for (int i=1; i<num_levels; ++i)
+                    sync.todo.push_back(i);
+                sync.remaining = num_levels - 1;
+                sync.pending = true;
             }
+            sync.work.notify_all();
+        }
+        else
+        {
+            this->img_erode.resize(std::max<size_t>(this->img_erode.size(), 1));
+            for (int i=1; i<num_levels; ++i)
+                this->buildLevel(i);
+            this->normalizeLevel(0);
         }
-        this->event_frame.push_back(frame_item);
-        ++id;
     }
-    std::cout<<"[EVENT_FRAME] Created ID["<<this->idx<<"] with: "<<events.size()
+    assert(this->frame[0].data == ((single)? reinterpret_cast<uchar*>(this->event_frame_f[0].data())
+                                        : reinterpret_cast<uchar*>(this->event_frame[0].data())));
+    std::cout<<"[EVENT_FRAME] Created ID["<<this->idx<<"] with: "<<this->coord.size() - this->first_event
                 <<" events. start time "<<first_time.toMicroseconds()<<" end time "
                 <<last_time.toMicroseconds()<<std::endl;
-    std::cout<<"[EVENT_FRAME] event frame ["<<std::addressof(this->event_frame)<<"] size:"<<this->event_frame.size()<<" image size[0]: "<<this->event_frame[0].size()<<std::endl;
+    std::cout<<"[EVENT_FRAME] event frame ["<<((single)? "float" : "double")<<"] size:"<<this->frame.size()<<" image size[0]: "<<this->frame[0].total()<<std::endl;
 
 }
 
+void EventFrame::buildLevel(const int &id, const size_t &worker)
+{
+    /** Dilate in the level storage and add the erode **/
+    cv::Mat &img_erode = this->img_erode[worker];
+    cv::dilate(this->frame[0], this->frame[id], this->morph_elements[id]);
+    cv::erode(this->frame[0], img_erode, this->morph_elements[id]);
+    this->frame[id] += img_erode;
+
+    this->normalizeLevel(id);
+}
+
+void EventFrame::levelWorker(const size_t worker)
+{
+    LevelSync &sync = *(this->level_sync);
+    boost::unique_lock<boost::mutex> lock(sync.mutex);
+    while (true)
+    {
+        while (sync.running && sync.todo.empty())
+            sync.work.wait(lock);
+        if (!sync.running)
+            return;
+
+        /** Coarse levels first **/
+        const int id = sync.todo.back();
+        sync.todo.pop_back();
+        lock.unlock();
+        this->buildLevel(id, worker);
+        lock.lock();
+
+        sync.ready[id] = 1;
+        sync.remaining--;
+        sync.signal.notify_all();
+    }
+}
+
+void EventFrame::normalizeLevel(const int &id)
+{
+    this->norm[id] = cv::norm(this->frame[id]);
+
+    /** When using PhotometricError cost function (PhotometricErrorNC uses the unnormalized frame) **/
+    const double norm_id = this->norm[id];
+    if (this->scalar == ::eds::tracking::FLOAT)
+    {
+        const float inv_norm = static_cast<float>(1.0/norm_id);
+        for (float &value : this->event_frame_f[id])
+            value *= inv_norm;
+    }
+    else
+    {
+        for (double &value : this->event_frame[id])
+            value /= norm_id;
+    }
+}
+
+void EventFrame::waitLevel(const int &id)
+{
+    LevelSync &sync = *(this->level_sync);
+    if (id == 0)
+        return this->waitLevels();
+
+    boost::unique_lock<boost::mutex> lock(sync.mutex);
+    while (sync.pending && !sync.ready[id])
+        sync.signal.wait(lock);
+}
+
+void EventFrame::waitLevels()
+{
+    if (!this->level_sync)
+        return;
+
+    LevelSync &sync = *(this->level_sync);
+    if (!sync.pending)
+        return;
+
+    {
+        boost::unique_lock<boost::mutex> lock(sync.mutex);
+        while (sync.remaining > 0)
+            sync.signal.wait(lock);
+    }
+
+    /** Level 0 is not read by the other levels anymore **/
+    sync.pending = false;
+    this->normalizeLevel(0);
+}
+
+void EventFrame::reserve(const size_t &num_events)
+{
+    this->coord.reserve(2 * num_events);
+    this->undist_coord.reserve(2 * num_events);
+    this->pol.reserve(2 * num_events);
+}
+
+void EventFrame::setDecimation(const uint16_t &decimation)
+{
+    /** Polarity weights are int8 **/
+    this->decimation = std::min(std::max(decimation, (uint16_t)1), (uint16_t)127);
+}
+
+void EventFrame::setNumThreads(const uint16_t &num_threads)
+{
+    this->num_threads = std::max(num_threads, (uint16_t)1);
+}
+
+void EventFrame::setLevelThreads(const uint16_t &level_threads)
+{
+    /** Workers already created are kept (idle when not needed) **/
+    this->level_threads = std::max(level_threads, (uint16_t)1);
+}
+
+void EventFrame::setPyramidMode(const ::eds::tracking::PYRAMID_MODE &mode)
+{
+    this->pyramid_mode = mode;
+}
+
+void EventFrame::setScalar(const ::eds::tracking::SCALAR_TYPE &scalar)
+{
+    /** The level storage is resized by the next frame **/
+    this->waitLevels();
+    this->scalar = scalar;
+}
+
+void EventFrame::setIncremental(const bool &incremental)
+{
+    /** The next slide() rebuilds the frame with the new weights **/
+    this->incremental = incremental;
+    this->num_slides = EventFrame::max_slides;
+}
+
 void EventFrame::clear()
 {
+    this->waitLevels();
     this->coord.clear();
     this->undist_coord.clear();
     this->pol.clear();
+    this->first_event = 0;
     this->frame.clear();
     this->event_frame.clear();
+    this->event_frame_f.clear();
     this->norm.clear();
 }
 
 cv::Mat EventFrame::viz(size_t id, bool color)
 {
+    this->waitLevels();
     assert(id < this->frame.size());
     cv::Mat events_viz;
     double min, max;
@@ -419,12 +833,9 @@ cv::Mat EventFrame::viz(size_t id, bool color)
 
 cv::Mat EventFrame::getEventFrame(const size_t &id)
 {
-    /* get the image from the std vector **/
-    cv::Mat event_mat = cv::Mat(this->height, this->width, CV_64FC1);
-
-    std::memcpy(event_mat.data, this->event_frame[id].data(), this->event_frame[id].size()*sizeof(double));
-
-    return event_mat;
+    /* header on the normalized event frame (no copy, valid until the next frame) **/
+    this->waitLevels();
+    return this->frame[id];
 }
 
 cv::Mat EventFrame::getEventFrameViz(const size_t &id, bool color)
@@ -490,13 +901,17 @@ cv::Mat EventFrame::epilinesViz (const std::vector<cv::Point2d> &coord, const cv
 
 cv::Mat EventFrame::pyramidViz(const bool &color)
 {
+    this->waitLevels();
     size_t n = this->frame.size();
     cv::Mat img = cv::Mat(n * this->height, this->width, CV_64FC1, cv::Scalar(0));
 
+    /** Levels one below the other (downsampled levels are smaller) **/
+    int row = 0;
     for (size_t i=0; i<n; ++i)
     {
         cv::Size size = this->frame[i].size();
-        this->frame[i].copyTo(img(cv::Rect(0, i*size.height, size.width, size.height)));
+        this->frame[i].convertTo(img(cv::Rect(0, row, size.width, size.height)), CV_64FC1);
+        row += size.height;
     }
 
     return ::eds::utils::viz(img);
@@ -25,6 +25,13 @@
 #include <eds/utils/Colormap.hpp>
 
 #include <eds/tracking/Config.hpp>
+#include <eds/tracking/EventBuffer.hpp>
+#include <eds/tracking/TimeSurface.hpp>
+
+#include <base/samples/EventBatch.hpp>
+
+#include <boost/thread.hpp>
+#include <memory>
 
 namespace eds {
 namespace tracking {
@@ -32,6 +39,8 @@ namespace tracking {
     {
         public:
             static constexpr float log_eps = 1e-06;
+            /** Incremental updates before a full rebuild (bounds the rounding drift) **/
+            static constexpr uint32_t max_slides = 64;
         public:
             /* unique id **/
             uint64_t idx;
@@ -41,29 +50,96 @@ namespace tracking {
             base::Time first_time, last_time, time, delta_time;
             /** Undistortion Maps (inverse and forward mapping) **/
             cv::Mat mapx, fwd_mapx, mapy, fwd_mapy;
+            /** Forward undistortion look-up table indexed by y * lut_width + x **/
+            std::vector<cv::Point2f> undist_lut;
+            uint16_t lut_width;
             /** Rescale out img order: (W x H) like in cv::Size**/
             std::array<double, 2> out_scale;
             /** Events Coordinates and normalize coord **/
             std::vector<cv::Point2d> coord, undist_coord;
             /** Events polarities **/
             std::vector<int8_t> pol;
+            /** The events of the frame are [first_event, size) of coord, undist_coord
+             * and pol: slide() moves the offset instead of erasing the front **/
+            size_t first_event;
             /** Distortion model information **/
             std::string distortion_model;
             /** Intrisic and rectification matrices **/
             cv::Mat K, D, K_ref, R_rect;
             /** Event Frame pose **/
             ::base::Affine3d T_w_ef;
-            /** Event frame (integration of events) no normalized **/
+            /** Event frame (integration of events). After create() these are
+             * headers on event_frame (normalized, no own storage) **/
             std::vector<cv::Mat> frame;
-            /** Normalized event frame in std vector for optimization **/
+            /** Normalized event frame in std vector for optimization (and frame storage) **/
             std::vector< std::vector<double> > event_frame; // event_frame = frame / norm
+            /** Same storage in single precision (scalar FLOAT, event_frame is then empty) **/
+            std::vector< std::vector<float> > event_frame_f;
             /** Norm of the event frame **/
             std::vector<double> norm;
+            /** Event decimation: one of every decimation events is used (weighted by decimation) **/
+            uint16_t decimation;
+            /** Threads of the event accumulation **/
+            uint16_t num_threads;
+            /** Threads building the pyramid levels (1: built in the calling thread) **/
+            uint16_t level_threads;
+            /** Incremental event frame for overlapping windows (uniform time weights) **/
+            bool incremental;
+            /** How the pyramid levels are built **/
+            ::eds::tracking::PYRAMID_MODE pyramid_mode;
+            /** Scalar of the event frame levels (frame headers are CV_64FC1 or CV_32FC1) **/
+            ::eds::tracking::SCALAR_TYPE scalar;
+            /** Scale of each level w.r.t. level 0 (scale of the intrinsics) **/
+            std::vector<double> level_scale;
+
+        protected:
+            /** Working images reused between event frames **/
+            cv::Mat event_img, level_img;
+            /** Erode image per level worker (one in the calling thread) **/
+            std::vector<cv::Mat> img_erode;
+            /** Accumulated events before the blur (kept for the incremental updates) **/
+            cv::Mat accumulator;
+            /** Incremental updates since the last full rebuild (max_slides
+             * forces a rebuild, e.g. after a decimated frame) **/
+            uint32_t num_slides;
+            /** Exponentially decayed accumulation of the events **/
+            ::eds::tracking::TimeSurface time_surface;
+
+            /** Pyramid levels built in background threads. The worker
+             * threads are created once and kept for the next frames **/
+            struct LevelSync
+            {
+                boost::mutex mutex;
+                /** A level is ready (signal) or there are levels to build (work) **/
+                boost::condition_variable signal, work;
+                /** 1 when the level is built and normalized **/
+                std::vector<uint8_t> ready;
+                /** Levels to build (taken from the back) and levels not yet built **/
+                std::vector<int> todo;
+                int remaining = 0;
+                /** Level 0 is normalized once the other levels do not read it **/
+                bool pending = false;
+                bool running = true;
+                boost::thread_group workers;
+            };
+            std::shared_ptr<LevelSync> level_sync;
+            /** Structuring elements per pyramid level **/
+            std::vector<cv::Mat> morph_elements;
+            /** Scratch memory of the event accumulation **/
+            ::eds::utils::AccumulateBuffers<double> accumulate_buffers;
 
         public:
             /** @brief Default constructor **/
             EventFrame(const ::eds::calib::Camera &cam, const ::eds::calib::Camera &newcam,  const std::string &distortion_model="radtan");
 
+            /** @brief Destructor (waits for the level threads) **/
+            ~EventFrame();
+
+            /** @brief Not copyable: frame[i] are headers on the storage of
+             * this frame and the level threads are bound to this object **/
+            EventFrame(const EventFrame &) = delete;
+            EventFrame& operator=(const EventFrame &) = delete;
+
             EventFrame(const uint64_t &idx, const std::vector<base::samples::Event> &events,
                     const ::eds::calib::CameraInfo &cam_info, const int &num_levels = 1,
                     const ::base::Affine3d &T=::base::Affine3d::Identity(),
@@ -71,7 +147,7 @@ namespace tracking {
 
             /** @brief Default constructor **/
             EventFrame(const uint64_t &idx, const std::vector<base::samples::Event> &events, const uint16_t height, const uint16_t width,
-                        cv::Mat &K, cv::Mat &D, cv::Mat &R_rect, cv::Mat &P, const std::string distortion_model="radtan", const int &num_levels = 1,
+                        const cv::Mat &K, const cv::Mat &D, const cv::Mat &R_rect, const cv::Mat &P, const std::string distortion_model="radtan", const int &num_levels = 1,
                         const ::base::Affine3d &T=::base::Affine3d::Identity(), const cv::Size &out_size = cv::Size(0, 0));
 
             /** @brief Insert new Eventframe **/
@@ -84,6 +160,99 @@ namespace tracking {
                         const uint16_t height, const uint16_t width, const int &num_levels = 1,
                         const ::base::Affine3d &T=::base::Affine3d::Identity(), const cv::Size &out_size = cv::Size(0, 0));
 
+            /** @brief Insert new Eventframe from a (ring buffer) window of events **/
+            void create(const uint64_t &idx, const ::eds::tracking::EventWindow &events,
+                    const ::eds::calib::CameraInfo &cam_info, const int &num_levels = 1,
+                    const ::base::Affine3d &T=::base::Affine3d::Identity(),
+                    const cv::Size &out_size = cv::Size(0, 0));
+
+            void create(const uint64_t &idx, const ::eds::tracking::EventWindow &events,
+                        const uint16_t height, const uint16_t width, const int &num_levels = 1,
+                        const ::base::Affine3d &T=::base::Affine3d::Identity(), const cv::Size &out_size = cv::Size(0, 0));
+
+            /** @brief Insert new Eventframe from a columnar batch of events **/
+            void create(const uint64_t &idx, const ::base::samples::EventBatch &events,
+                    const ::eds::calib::CameraInfo &cam_info, const int &num_levels = 1,
+                    const ::base::Affine3d &T=::base::Affine3d::Identity(),
+                    const cv::Size &out_size = cv::Size(0, 0));
+
+            void create(const uint64_t &idx, const ::base::samples::EventBatch &events,
+                        const uint16_t height, const uint16_t width, const int &num_levels = 1,
+                        const ::base::Affine3d &T=::base::Affine3d::Identity(), const cv::Size &out_size = cv::Size(0, 0));
+
+            /** @brief Incremental Eventframe: remove the num_removed oldest events
+             * of the current frame and insert the events at the end of the window
+             * which are not yet in the frame. It falls back to create() when the
+             * windows do not overlap, with decimation or when the frame is not incremental **/
+            void slide(const uint64_t &idx, const ::eds::tracking::EventWindow &events, const size_t &num_removed,
+                    const ::eds::calib::CameraInfo &cam_info, const int &num_levels = 1,
+                    const ::base::Affine3d &T=::base::Affine3d::Identity(),
+                    const cv::Size &out_size = cv::Size(0, 0));
+
+            void slide(const uint64_t &idx, const ::eds::tracking::EventWindow &events, const size_t &num_removed,
+                        const uint16_t height, const uint16_t width, const int &num_levels = 1,
+                        const ::base::Affine3d &T=::base::Affine3d::Identity(), const cv::Size &out_size = cv::Size(0, 0));
+
+            /** @brief Time surface with decay time constant (zero disables it) **/
+            void setTimeSurface(const ::base::Time &decay);
+
+            /** @brief Insert the events [begin, end) of the window in the time surface (O(1) per event) **/
+            void insert(const ::eds::tracking::EventWindow &events, const size_t &begin, const size_t &end);
+
+            /** @brief Eventframe from the time surface queried at time (no events are reprocessed) **/
+            void createAt(const uint64_t &idx, const ::base::Time &time,
+                    const ::eds::calib::CameraInfo &cam_info, const int &num_levels = 1,
+                    const ::base::Affine3d &T=::base::Affine3d::Identity(),
+                    const cv::Size &out_size = cv::Size(0, 0));
+
+            void createAt(const uint64_t &idx, const ::base::Time &time,
+                        const uint16_t height, const uint16_t width, const int &num_levels = 1,
+                        const ::base::Affine3d &T=::base::Affine3d::Identity(), const cv::Size &out_size = cv::Size(0, 0));
+
+            /** @brief Event frame pyramid from the already inserted
+             * undistorted coordinates, polarities and time stamps **/
+            void createFrames(const int &num_levels, const cv::Size &out_size);
+
+            /** @brief Allocate the storage for windows of up to num_events events
+             * (twice for the events slide() keeps before compacting) **/
+            void reserve(const size_t &num_events);
+
+            /** @brief Decimation of the events for the next created frames **/
+            void setDecimation(const uint16_t &decimation);
+
+            /** @brief Number of threads of the event accumulation **/
+            void setNumThreads(const uint16_t &num_threads);
+
+            /** @brief Number of threads building the pyramid levels **/
+            void setLevelThreads(const uint16_t &level_threads);
+
+            /** @brief Pyramid levels: MORPHOLOGY (same size) or DOWNSAMPLE (half size per level) **/
+            void setPyramidMode(const ::eds::tracking::PYRAMID_MODE &mode);
+
+            /** @brief Scalar of the next created frames: DOUBLE (event_frame)
+             * or FLOAT (event_frame_f). The accumulation is always double **/
+            void setScalar(const ::eds::tracking::SCALAR_TYPE &scalar);
+
+            /** @brief Normalized level id in the storage of the scalar T **/
+            template <typename T>
+            const std::vector<T>& level(const int &id) const;
+
+            /** @brief Number of levels of the current frame **/
+            size_t numLevels() const { return this->frame.size(); }
+
+            /** @brief Incremental mode for slide(). The events of all the frames
+             * have uniform time weights instead of the exponential ones of the
+             * non incremental frames (exponential weights change with the window) **/
+            void setIncremental(const bool &incremental);
+
+            /** @brief Wait until the level id is ready. The levels are
+             * built in parallel (level_threads > 1) and the coarse ones can be
+             * used while the others are still running **/
+            void waitLevel(const int &id);
+
+            /** @brief Wait until all the levels are ready **/
+            void waitLevels();
+
             void clear();
 
             cv::Mat viz(size_t id=0, bool color = false);
@@ -104,8 +273,35 @@ namespace tracking {
 
             cv::Mat pyramidViz(const bool &color = false);
 
+        protected:
+            /** @brief Blurred frame, pyramid levels and normalized frames from the accumulator **/
+            void createLevels(const int &num_levels, const cv::Size &out_size);
+
+            /** @brief Morphology level id from the unnormalized level 0, its norm and
+             * normalization. worker selects the erode scratch image **/
+            void buildLevel(const int &id, const size_t &worker = 0);
+
+            void normalizeLevel(const int &id);
+
+            /** @brief Worker thread: builds the levels of level_sync until the destructor **/
+            void levelWorker(const size_t worker);
+
     };
 
+    template <>
+    inline const std::vector<double>& EventFrame::level<double>(const int &id) const
+    {
+        assert(this->scalar == ::eds::tracking::DOUBLE);
+        return this->event_frame[id];
+    }
+
+    template <>
+    inline const std::vector<float>& EventFrame::level<float>(const int &id) const
+    {
+        assert(this->scalar == ::eds::tracking::FLOAT);
+        return this->event_frame_f[id];
+    }
+
 } //tracking namespace
 } // end namespace
 
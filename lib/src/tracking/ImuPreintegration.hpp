@@ -0,0 +1,219 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EDS_TRACKING_IMU_PREINTEGRATION_HPP_
+#define _EDS_TRACKING_IMU_PREINTEGRATION_HPP_
+
+#include <base/Time.hpp>
+#include <base/Eigen.hpp>
+#include <base/samples/IMUSensors.hpp>
+
+#include <ceres/ceres.h>
+#include <Eigen/Geometry>
+#include <cmath>
+
+namespace eds { namespace tracking {
+
+    /** On-manifold preintegration of the gyroscope and the accelerometer
+     * between two event frames (Forster et al. TRO 2017):
+     *
+     * dR_k+1 = dR_k * Exp(w_k * dt)
+     * dv_k+1 = dv_k + dR_k * a_k * dt
+     * dp_k+1 = dp_k + dv_k * dt + 0.5 * dR_k * a_k * dt^2
+     *
+     * with bias corrected mid point measurements. The rotation covariance
+     * is propagated with the gyroscope noise density. dv and dp are in the
+     * IMU frame at the start and include gravity **/
+    class ImuPreintegration
+    {
+        public:
+            /** Rotation of the extrinsics p_cam = T_cam_imu * p_imu **/
+            Eigen::Matrix3d R_cam_imu;
+            /** Gyroscope and accelerometer biases **/
+            Eigen::Vector3d gyro_bias, acc_bias;
+            /** Gyroscope noise density [rad/s/sqrt(Hz)] **/
+            double gyro_noise;
+
+            /** Start and end of the integration **/
+            base::Time start_time, end_time;
+            /** Preintegrated rotation, velocity and position **/
+            Eigen::Matrix3d delta_R;
+            Eigen::Vector3d delta_v, delta_p;
+            /** Covariance of the rotation (tangent space) **/
+            Eigen::Matrix3d cov_R;
+
+        private:
+            /** Last measurement (kept between integrations) **/
+            base::samples::IMUSensors last_sample;
+            bool has_sample;
+
+        public:
+            ImuPreintegration(const Eigen::Matrix3d &R_cam_imu = Eigen::Matrix3d::Identity(),
+                            const double &gyro_noise = 1.7e-04)
+            :R_cam_imu(R_cam_imu), gyro_bias(Eigen::Vector3d::Zero()), acc_bias(Eigen::Vector3d::Zero()),
+            gyro_noise(gyro_noise), has_sample(false)
+            {
+                this->reset(base::Time());
+            }
+
+            /** @brief Start a new integration at time **/
+            void reset(const base::Time &time)
+            {
+                this->start_time = this->end_time = time;
+                this->delta_R.setIdentity();
+                this->delta_v.setZero(); this->delta_p.setZero();
+                this->cov_R.setZero();
+            }
+
+            /** @brief Integrate the measurement from the end of the integration (or the last sample) to its time **/
+            void integrate(const base::samples::IMUSensors &sample)
+            {
+                if (this->has_sample && sample.time > this->end_time)
+                {
+                    /** Mid point of the last and the new measurement **/
+                    const Eigen::Vector3d gyro = 0.5 * (this->last_sample.gyro + sample.gyro);
+                    const Eigen::Vector3d acc = 0.5 * (this->last_sample.acc + sample.acc);
+                    this->step(gyro, acc, (sample.time - this->end_time).toSeconds());
+                }
+                /** First measurement after a reset without time **/
+                if (this->start_time.isNull())
+                    this->start_time = sample.time;
+                if (sample.time > this->end_time)
+                    this->end_time = sample.time;
+                this->last_sample = sample;
+                this->has_sample = true;
+            }
+
+            /** @brief Hold the last measurement until time **/
+            void integrateUntil(const base::Time &time)
+            {
+                if (!this->has_sample || time <= this->end_time)
+                    return;
+                this->step(this->last_sample.gyro, this->last_sample.acc, (time - this->end_time).toSeconds());
+                this->end_time = time;
+            }
+
+            /** @brief Integration time [s] **/
+            double dt() const { return (this->end_time - this->start_time).toSeconds(); }
+
+            /** @brief Rotation of the camera at the end in the camera at the start (R_ci_cj) **/
+            Eigen::Quaterniond deltaRotationCam() const
+            {
+                return Eigen::Quaterniond(this->R_cam_imu * this->delta_R * this->R_cam_imu.transpose()).normalized();
+            }
+
+            /** @brief Mean angular velocity in the camera frame [rad/s] **/
+            Eigen::Vector3d angularVelocityCam() const
+            {
+                const double t = this->dt();
+                if (t <= 0.0)
+                    return Eigen::Vector3d::Zero();
+                const Eigen::AngleAxisd aa(this->delta_R);
+                return this->R_cam_imu * (aa.angle() * aa.axis()) / t;
+            }
+
+            /** @brief Rotation covariance in the camera frame **/
+            Eigen::Matrix3d covarianceCam() const
+            {
+                return this->R_cam_imu * this->cov_R * this->R_cam_imu.transpose();
+            }
+
+            static Eigen::Matrix3d skew(const Eigen::Vector3d &v)
+            {
+                Eigen::Matrix3d m;
+                m << 0.0, -v[2], v[1],
+                     v[2], 0.0, -v[0],
+                    -v[1], v[0], 0.0;
+                return m;
+            }
+
+            /** @brief SO(3) exponential map **/
+            static Eigen::Matrix3d expSO3(const Eigen::Vector3d &phi)
+            {
+                const double theta = phi.norm();
+                if (theta < 1e-10)
+                    return Eigen::Matrix3d::Identity() + skew(phi);
+                return Eigen::AngleAxisd(theta, phi/theta).toRotationMatrix();
+            }
+
+            /** @brief SO(3) right Jacobian **/
+            static Eigen::Matrix3d rightJacobianSO3(const Eigen::Vector3d &phi)
+            {
+                const double theta = phi.norm();
+                const Eigen::Matrix3d W = skew(phi);
+                if (theta < 1e-05)
+                    return Eigen::Matrix3d::Identity() - 0.5 * W;
+                const double theta2 = theta * theta;
+                return Eigen::Matrix3d::Identity() - ((1.0 - std::cos(theta))/theta2) * W
+                        + ((theta - std::sin(theta))/(theta2 * theta)) * W * W;
+            }
+
+        private:
+            void step(const Eigen::Vector3d &gyro, const Eigen::Vector3d &acc, const double &dt)
+            {
+                if (dt <= 0.0)
+                    return;
+                const Eigen::Vector3d w = gyro - this->gyro_bias;
+                const Eigen::Vector3d a = acc - this->acc_bias;
+                const Eigen::Vector3d phi = w * dt;
+                const Eigen::Matrix3d dR = expSO3(phi);
+
+                this->delta_p += this->delta_v * dt + 0.5 * this->delta_R * a * dt * dt;
+                this->delta_v += this->delta_R * a * dt;
+                this->delta_R = this->delta_R * dR;
+
+                /** Rotation covariance: A * cov * A^T + B * Q * B^T **/
+                const Eigen::Matrix3d Jr = rightJacobianSO3(phi) * dt;
+                const double q = this->gyro_noise * this->gyro_noise / dt;
+                this->cov_R = dR.transpose() * this->cov_R * dR + q * Jr * Jr.transpose();
+            }
+    };
+
+    /** Prior of the tracker rotation qx (x, y, z, w) with the IMU prediction:
+     * residual = sqrt_information * 2 * vec(qx * q_prior^-1) **/
+    struct RotationPrior
+    {
+        RotationPrior(const Eigen::Quaterniond &q_prior, const Eigen::Matrix3d &sqrt_information)
+        :q_prior(q_prior), sqrt_information(sqrt_information){}
+
+        template <typename T>
+        bool operator()(const T* const q, T* residual) const
+        {
+            Eigen::Map<const Eigen::Quaternion<T>> q_x(q);
+            const Eigen::Quaternion<T> q_err = q_x * this->q_prior.conjugate().template cast<T>();
+            const T sign = (q_err.w() < T(0))? T(-1.0) : T(1.0);
+            Eigen::Map<Eigen::Matrix<T, 3, 1>> r(residual);
+            r = this->sqrt_information.template cast<T>() * (T(2.0) * sign * q_err.vec());
+            return true;
+        }
+
+        static ceres::CostFunction* Create(const Eigen::Quaterniond &q_prior, const Eigen::Matrix3d &sqrt_information)
+        {
+            return new ceres::AutoDiffCostFunction<RotationPrior, 3, 4>(new RotationPrior(q_prior, sqrt_information));
+        }
+
+        Eigen::Quaterniond q_prior;
+        Eigen::Matrix3d sqrt_information;
+    };
+
+} // tracking namespace
+} // end namespace
+
+#endif // _EDS_TRACKING_IMU_PREINTEGRATION_HPP_
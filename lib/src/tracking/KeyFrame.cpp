@@ -1105,6 +1105,33 @@ eds::tracking::KFPointIterators KeyFrame::erasePoint(const int &idx)
     return its;
 }
 
+void KeyFrame::selectPoints(const std::vector<int> &indices)
+{
+    /** It is very important to keep consistency size **/
+    assert(this->coord.size() == this->norm_coord.size());
+    assert(this->norm_coord.size() == this->grad.size());
+    assert(this->grad.size() == this->patches.size());
+    assert(this->patches.size() == this->bundle_patches.size());
+    assert(this->bundle_patches.size() == this->residuals.size());
+    assert(this->residuals.size() == this->weights.size());
+    assert(this->weights.size() == this->tracks.size());
+    assert(this->tracks.size() == this->flow.size());
+    assert(this->flow.size() == this->inv_depth.size());
+
+    auto keep = [&indices](auto &v)
+    {
+        for (size_t k=0; k<indices.size(); ++k)
+            if (k != (size_t)indices[k]) v[k] = std::move(v[indices[k]]);
+        v.resize(indices.size());
+    };
+
+    keep(this->coord); keep(this->norm_coord); keep(this->grad);
+    keep(this->patches); keep(this->bundle_patches);
+    keep(this->residuals); keep(this->weights);
+    keep(this->tracks); keep(this->flow);
+    this->inv_depth.select(indices);
+}
+
 cv::Mat KeyFrame::viz(const cv::Mat &img, bool color)
 {
     double min, max;
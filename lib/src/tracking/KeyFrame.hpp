@@ -153,6 +153,9 @@ namespace tracking{
              * return: iterators to the next element **/
             KFPointIterators erasePoint (const int &idx);
 
+            /** Keep only the points of the indices (ascending) **/
+            void selectPoints (const std::vector<int> &indices);
+
             cv::Mat viz(const cv::Mat &img, bool color=false);
 
             void setDepthMap(::eds::mapping::IDepthMap2d &depthmap, const ::eds::mapping::Config &map_info);
@@ -22,6 +22,7 @@
 #define _EDS_PHOTOMETRIC_ERROR_HPP_
 
 #include <eds/mapping/Types.hpp>
+#include <eds/tracking/TrackingCache.hpp>
 #include <ceres/ceres.h>
 #include <ceres/rotation.h>
 #include <ceres/cubic_interpolation.h>
@@ -53,72 +54,56 @@ struct UnitNormVectorAddition
     }
 };
  
-struct PhotometricError
+/** Photometric error with ceres autodiff. The event frame is stored in
+ * Scalar (double or float), the Jets are computed in double **/
+template <typename Scalar>
+struct PhotometricErrorT
 {
-    PhotometricError(const std::vector<cv::Point2d> *grad,
+    PhotometricErrorT(const ::eds::tracking::TrackingCache *cache,
+                     const std::vector<Scalar> *event_frame,
+                     const int &height, const int &width,
+                     const double &fx, const double &fy,
+                     const double &cx, const double &cy,
+                     const int &start_element, const int &num_elements)
+    :height(height), width(width), fx(fx), fy(fy), cx(cx), cy(cy)
+    {
+        this->init(cache, event_frame, start_element, num_elements);
+    }
+
+    PhotometricErrorT(const std::vector<cv::Point2d> *grad,
                      const std::vector<cv::Point2d> *norm_coord,
                      const std::vector<double> *idp,
                      const std::vector<double> *weights,
-                     const std::vector<double> *event_frame,
+                     const std::vector<Scalar> *event_frame,
                      const int &height, const int &width,
                      const double &fx, const double &fy,
                      const double &cx, const double &cy,
                      const int &start_element, const int &num_elements)
     :height(height), width(width), fx(fx), fy(fy), cx(cx), cy(cy)
+    {
+        /** Cache of the points of this block only **/
+        this->own_cache = std::make_shared<::eds::tracking::TrackingCache>();
+        this->own_cache->build(*grad, *norm_coord, *idp, *weights, start_element, num_elements);
+        this->init(this->own_cache.get(), event_frame, 0, num_elements);
+    }
+
+    void init(const ::eds::tracking::TrackingCache *cache, const std::vector<Scalar> *event_frame,
+            const int &start_element, const int &num_elements)
     {
         /** Sanity checks **/
-        assert(grad->size() == norm_coord->size());
-        assert(norm_coord->size() == idp->size());
-        assert(idp->size() == weights->size());
+        assert(cache->size() >= (size_t)(start_element + num_elements));
         assert(event_frame->size() == (size_t)(height * width));
 
         this->start = start_element;
         this->n_points = num_elements;
 
         /** Get the parameters **/
-        this->grad = grad;
-        this->norm_coord = norm_coord;
-        this->idp = idp;
-        this->weights = weights;
+        this->cache = cache;
         this->event_frame = event_frame;
 
-        //std::cout<<"[PHOTO_ERROR] height: "<<height<<" width: "<<width<<std::endl;
-        //std::cout<<"[PHOTO_ERROR] fx: "<<fx<<" fy: "<<fy<<" cx: "<<cx<<" cy: "<<cy<<std::endl;
-        //std::cout<<"[PHOTO_ERROR] num points: "<<this->n_points<<std::endl;
-        //std::cout<<"[PHOTO_ERROR] grad ["<<std::addressof(*(this->grad))<<"] size:"<<this->grad->size()<<std::endl;
-        //std::cout<<"[PHOTO_ERROR] norm_coord ["<<std::addressof(*(this->norm_coord))<<"] size:"<<this->norm_coord->size()<<std::endl;
-        //std::cout<<"[PHOTO_ERROR] idp ["<<std::addressof(*(this->idp))<<"] size: "<<this->idp->size()<<std::endl;
-        //std::cout<<"[PHOTO_ERROR] argument event_frame ["<<std::addressof(*(event_frame))<<"] size: "<<event_frame->size()<<std::endl;
-        //std::cout<<"[PHOTO_ERROR] event_frame ["<<std::addressof(*(this->event_frame))<<"] size: "<<this->event_frame->size()<<std::endl;
-
-        /** Generate the 3D points **/
-        kp.clear();
-        int idx = this->start;
-        for (int i=0; i<n_points; ++i)
-        {
-            ::eds::mapping::Point3d p;
-            p[2] = 1.0/((*idp)[idx]+this->eps);
-            p[0] = (*norm_coord)[idx].x*p[2];
-            p[1] = (*norm_coord)[idx].y*p[2];
-
-            kp.push_back(p);
-            idx++;
-        }
-        assert(kp.size() == n_points);
-
         /** Create the grid for the event frame interpolate **/
-        event_grid.reset(new ceres::Grid2D<double, 1> (this->event_frame->data(), 0, height, 0, width));
-        event_grid_interp.reset(new ceres::BiCubicInterpolator< ceres::Grid2D<double, 1> > (*event_grid));
-    }
-
-    template <typename T> inline
-    void compute_flow(const T &xp, const T &yp, const T* vx, const T &idp, T *result) const
-    {
-        result[0] = (-idp*vx[0]) + (xp*idp*vx[2])
-                        + (xp*yp*vx[3]) - (T(1.0)+ceres::pow(xp, 2))*vx[4] + (yp*vx[5]);
-
-        result[1] = (-idp*vx[1]) + (yp*idp*vx[2])
-                        + (T(1.0)+ceres::pow(yp, 2))*vx[3] - (xp*yp*vx[4]) - (xp*vx[5]);
+        event_grid.reset(new ceres::Grid2D<Scalar, 1> (this->event_frame->data(), 0, height, 0, width));
+        event_grid_interp.reset(new ceres::BiCubicInterpolator< ceres::Grid2D<Scalar, 1> > (*event_grid));
     }
 
     template <typename T>
@@ -127,21 +112,15 @@ struct PhotometricError
         /** Get current pose and quaternion **/
         Eigen::Map<const Eigen::Matrix<T, 3, 1>> p_x(px);
         Eigen::Map<const Eigen::Quaternion<T>> q_x(qx);
+        const ::eds::tracking::TrackingCache &kc = *(this->cache);
 
-        /** Compute the model for the active points **/
+        /** Compute the model for the active points: -grad^T * flow(v) **/
         T model_norm_sq(1e-03);
         int idx = this->start;
         for (int i=0; i<this->n_points; i++)
         {
-            /** Flow in the key frame **/
-            Eigen::Matrix<T, 2, 1> flow; compute_flow<T>(T((*norm_coord)[idx].x), T((*norm_coord)[idx].y), vx, T((*idp)[idx]), flow.data()); // 2 x 1 flow
-            //flow[2] = T(0.0);
-
-            /** Contra rotate the flow: flow in keyframe **/
-            //flow = q_x.toRotationMatrix().transpose() * flow;
-
-            /** Model **/
-            residual[i] = -((*grad)[idx].x * flow[0] + (*grad)[idx].y * flow[1]);
+            residual[i] = T(kc.coeff[0][idx]) * vx[0] + T(kc.coeff[1][idx]) * vx[1] + T(kc.coeff[2][idx]) * vx[2]
+                        + T(kc.coeff[3][idx]) * vx[3] + T(kc.coeff[4][idx]) * vx[4] + T(kc.coeff[5][idx]) * vx[5];
 
             /** Get the normalization for later **/
             model_norm_sq += ceres::pow(residual[i], 2);
@@ -155,13 +134,11 @@ struct PhotometricError
         {
             /** Get the point in the keyframe **/
             Eigen::Matrix<T, 3, 1> point;
-            point[0] = T(kp[i][0]); point[1] = T(kp[i][1]); point[2] = T(kp[i][2]);
-            //std::cout<<"["<<i<<"] point: "<<point[0]<<" "<<point[1]<<" "<<point[2]<<std::endl;
+            point[0] = T(kc.x[idx]); point[1] = T(kc.y[idx]); point[2] = T(kc.z[idx]);
 
             /** Rotate and translate the point **/
             Eigen::Matrix<T, 3, 1> p;
             p = q_x.toRotationMatrix() * point + p_x;
-            //std::cout<<"p: "<<p[0]<<" "<<p[1]<<" "<<p[2]<<std::endl;
 
             /** Project the point into the event frame **/
             T xp = T(fx) * (p[0]/p[2]) + T(cx);
@@ -170,49 +147,56 @@ struct PhotometricError
             /** Brightness change from the events **/
             T event_brightness;
             event_grid_interp->Evaluate(yp, xp, &event_brightness);
-            residual[i] = T((*weights)[idx]) * ((residual[i]/model_norm) - event_brightness);
-            //std::cout<<"["<<i<<"]"<<residual[i]<<std::endl;
+            residual[i] = T(kc.weights[idx]) * ((residual[i]/model_norm) - event_brightness);
             idx++;
         }
 
-        //std::cout << "[CERES] Press Enter to Continue";
-        //std::cin.ignore();
-        //std::cout<<"*****"<<std::endl;
         return true;
     }
 
     // Factory to hide the construction of the CostFunction object from
     // the client code.
+    static ceres::CostFunction* Create(const ::eds::tracking::TrackingCache *cache,
+                                       const std::vector<Scalar> *event_frame,
+                                       const int &height, const int &width,
+                                       const double &fx, const double &fy,
+                                       const double &cx, const double &cy,
+                                       const int &start_element, const int &num_elements)
+    {
+        PhotometricErrorT* functor = new PhotometricErrorT(cache, event_frame, height, width, fx, fy, cx, cy, start_element, num_elements);
+        return new ceres::AutoDiffCostFunction<PhotometricErrorT, ceres::DYNAMIC, 3, 4, 6>(functor, num_elements);
+    }
+
     static ceres::CostFunction* Create(const std::vector<cv::Point2d> *grad,
                                        const std::vector<cv::Point2d> *norm_coord,
                                        const std::vector<double> *idp,
                                        const std::vector<double> *weights,
-                                       const std::vector<double> *event_frame,
+                                       const std::vector<Scalar> *event_frame,
                                        const int &height, const int &width,
                                        const double &fx, const double &fy,
                                        const double &cx, const double &cy,
                                        const int &start_element, const int &num_elements)
     {
-        PhotometricError* functor = new PhotometricError(grad, norm_coord, idp, weights, event_frame, height, width, fx, fy, cx, cy, start_element, num_elements); 
-        return new ceres::AutoDiffCostFunction<PhotometricError, ceres::DYNAMIC, 3, 4, 6>(functor, num_elements);
+        PhotometricErrorT* functor = new PhotometricErrorT(grad, norm_coord, idp, weights, event_frame, height, width, fx, fy, cx, cy, start_element, num_elements); 
+        return new ceres::AutoDiffCostFunction<PhotometricErrorT, ceres::DYNAMIC, 3, 4, 6>(functor, num_elements);
     }
  
-    static constexpr double eps = 1e-05;
+    static constexpr double eps = ::eds::tracking::TrackingCache::eps;
 
     int start; // start of points
     int n_points; // number of active points
     int height, width; // height and width of the image
     double fx, fy, cx, cy; // intrinsics
-    std::vector< ::eds::mapping::Point3d > kp; // 3D points [x, y , z]
-    const std::vector<cv::Point2d> *grad; // N x 2 img gradient [\Nabla x, \Nabla y]
-    const std::vector<cv::Point2d> *norm_coord; // N x 2 normalized keyframe coord [X, Y]
-    const std::vector<double> *idp; // N x 1 inverse depth
-    const std::vector<double> *weights; // N x 1 weight points
-    const std::vector<double> *event_frame; // H x W event frame with the brightness change
-    std::unique_ptr< ceres::Grid2D<double, 1> > event_grid;
-    std::unique_ptr< ceres::BiCubicInterpolator< ceres::Grid2D<double, 1> > > event_grid_interp;
+    const ::eds::tracking::TrackingCache *cache; // keyframe points, model coefficients and weights
+    std::shared_ptr<::eds::tracking::TrackingCache> own_cache; // cache when built from the point vectors
+    const std::vector<Scalar> *event_frame; // H x W event frame with the brightness change
+    std::unique_ptr< ceres::Grid2D<Scalar, 1> > event_grid;
+    std::unique_ptr< ceres::BiCubicInterpolator< ceres::Grid2D<Scalar, 1> > > event_grid_interp;
 };
 
+typedef PhotometricErrorT<double> PhotometricError;
+typedef PhotometricErrorT<float> PhotometricErrorf;
+
 } //tracking namespace
 } // end namespace
 
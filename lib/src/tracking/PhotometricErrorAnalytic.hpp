@@ -0,0 +1,345 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EDS_PHOTOMETRIC_ERROR_ANALYTIC_HPP_
+#define _EDS_PHOTOMETRIC_ERROR_ANALYTIC_HPP_
+
+#include <eds/tracking/PhotometricError.hpp>
+#include <eds/utils/Interpolate.hpp>
+#include <eds/utils/NumType.h>
+#include <eds/utils/IndexThreadReduce.h>
+
+namespace eds { namespace tracking {
+
+/** Same model as PhotometricError with hand derived Jacobians.
+ *
+ * residual_i = w_i * (m_i / |m| - E(pi(R(q) * X_i + p)))
+ *
+ * The model m_i = c_i^T * v is linear in the velocity (c_i only depends on
+ * the keyframe gradient, coordinates and inverse depth) and it is read
+ * from the keyframe TrackingCache. The normalization |m| couples all the
+ * residuals of the block with the velocity:
+ *
+ * d(m_i/|m|)/dv = (c_i - (m_i/|m|^2) * sum_j m_j c_j) / |m|
+ *
+ * The rotation derivative is the one of Eigen::Quaternion::toRotationMatrix
+ * with respect to the (x, y, z, w) coefficients, as in the autodiff version.
+ * The event frame is sampled for a chunk of points at once, with the ceres
+ * interpolator or with the BicubicSampler (FAST_BICUBIC). The chunks run in
+ * a thread pool and their partial model norms are reduced in chunk order,
+ * the result does not depend on the number of threads. The event frame is
+ * stored in Scalar (double or float), the arithmetic is in double **/
+template <typename Scalar>
+class PhotometricErrorAnalyticT : public ceres::CostFunction
+{
+    public:
+    /** Points per chunk of the evaluation (fit in the L2 with their scratch) **/
+    static constexpr int CHUNK_SIZE = 1024;
+
+    PhotometricErrorAnalyticT(const ::eds::tracking::TrackingCache *cache,
+                     const std::vector<Scalar> *event_frame,
+                     const int &height, const int &width,
+                     const double &fx, const double &fy,
+                     const double &cx, const double &cy,
+                     const int &start_element, const int &num_elements,
+                     const ::eds::utils::INTERPOLATOR_TYPE &interpolator = ::eds::utils::CERES_BICUBIC,
+                     ::dso::IndexThreadReduce<double> *thread_reduce = nullptr)
+    :height(height), width(width), fx(fx), fy(fy), cx(cx), cy(cy), thread_reduce(thread_reduce)
+    {
+        this->init(cache, event_frame, start_element, num_elements);
+        if (interpolator == ::eds::utils::FAST_BICUBIC)
+            this->sampler.reset(new ::eds::utils::BicubicSampler<Scalar>(this->event_frame->data(), height, width));
+    }
+
+    PhotometricErrorAnalyticT(const std::vector<cv::Point2d> *grad,
+                     const std::vector<cv::Point2d> *norm_coord,
+                     const std::vector<double> *idp,
+                     const std::vector<double> *weights,
+                     const std::vector<Scalar> *event_frame,
+                     const int &height, const int &width,
+                     const double &fx, const double &fy,
+                     const double &cx, const double &cy,
+                     const int &start_element, const int &num_elements)
+    :height(height), width(width), fx(fx), fy(fy), cx(cx), cy(cy), thread_reduce(nullptr)
+    {
+        /** Cache of the points of this block only **/
+        this->own_cache = std::make_shared<::eds::tracking::TrackingCache>();
+        this->own_cache->build(*grad, *norm_coord, *idp, *weights, start_element, num_elements);
+        this->init(this->own_cache.get(), event_frame, 0, num_elements);
+    }
+
+    void init(const ::eds::tracking::TrackingCache *cache, const std::vector<Scalar> *event_frame,
+            const int &start_element, const int &num_elements)
+    {
+        /** Sanity checks **/
+        assert(cache->size() >= (size_t)(start_element + num_elements));
+        assert(event_frame->size() == (size_t)(height * width));
+
+        this->start = start_element;
+        this->n_points = num_elements;
+        this->cache = cache;
+        this->event_frame = event_frame;
+
+        /** Residuals and parameter blocks: px[3], qx[4], vx[6] **/
+        this->set_num_residuals(num_elements);
+        this->mutable_parameter_block_sizes()->push_back(3);
+        this->mutable_parameter_block_sizes()->push_back(4);
+        this->mutable_parameter_block_sizes()->push_back(6);
+
+        /** Create the grid for the event frame interpolate **/
+        event_grid.reset(new ceres::Grid2D<Scalar, 1> (this->event_frame->data(), 0, height, 0, width));
+        event_grid_interp.reset(new ceres::BiCubicInterpolator< ceres::Grid2D<Scalar, 1> > (*event_grid));
+        this->scratch.resize(8 * num_elements);
+    }
+
+    bool Evaluate(double const* const* parameters, double* residuals, double** jacobians) const override
+    {
+        const double *px = parameters[0], *qx = parameters[1], *vx = parameters[2];
+        const bool jacobian_v = (jacobians != nullptr && jacobians[2] != nullptr);
+
+        /** First pass: model per point and partial sums per chunk
+         * [|m|^2, sum_j m_j c_j (6)] **/
+        const int num_chunks = (this->n_points + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        this->partials.assign(7 * num_chunks, 0.0);
+        this->forEachChunk(num_chunks, [&](const int &k)
+        {
+            this->modelChunk(k, vx, residuals, jacobian_v);
+        });
+
+        /** Chunks are reduced in order: same result for any number of threads **/
+        double model_norm_sq = 1e-03;
+        double s[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        for (int k=0; k<num_chunks; ++k)
+        {
+            const double *partial = &(this->partials[7*k]);
+            model_norm_sq += partial[0];
+            for (int j=0; j<6; ++j)
+                s[j] += partial[1+j];
+        }
+        const double inv_norm = 1.0/std::sqrt(model_norm_sq);
+
+        /** Second pass: residuals and Jacobians **/
+        this->forEachChunk(num_chunks, [&](const int &k)
+        {
+            this->residualChunk(k, px, qx, inv_norm, s, residuals, jacobians);
+        });
+
+        return true;
+    }
+
+    /** @brief Run f(k) for the chunks in the thread pool (or in this thread) **/
+    template <typename F>
+    void forEachChunk(const int &num_chunks, F f) const
+    {
+        if (this->thread_reduce != nullptr && num_chunks > 1)
+        {
+            this->thread_reduce->reduce([&f](int first, int end, double*, int)
+            {
+                for (int k=first; k<end; ++k)
+                    f(k);
+            }, 0, num_chunks, 1);
+        }
+        else
+        {
+            for (int k=0; k<num_chunks; ++k)
+                f(k);
+        }
+    }
+
+    void modelChunk(const int &k, const double *vx, double *residuals, const bool &jacobian_v) const
+    {
+        const ::eds::tracking::TrackingCache &kc = *(this->cache);
+        const int begin = k * CHUNK_SIZE, end = std::min(begin + CHUNK_SIZE, this->n_points);
+        const float *c0 = kc.coeff[0].data() + start, *c1 = kc.coeff[1].data() + start, *c2 = kc.coeff[2].data() + start;
+        const float *c3 = kc.coeff[3].data() + start, *c4 = kc.coeff[4].data() + start, *c5 = kc.coeff[5].data() + start;
+
+        double norm_sq = 0.0;
+        for (int i=begin; i<end; i++)
+        {
+            residuals[i] = double(c0[i])*vx[0] + double(c1[i])*vx[1] + double(c2[i])*vx[2]
+                        + double(c3[i])*vx[3] + double(c4[i])*vx[4] + double(c5[i])*vx[5];
+            norm_sq += residuals[i] * residuals[i];
+        }
+
+        /** Sum of m_j c_j for the normalization Jacobian **/
+        double *partial = &(this->partials[7*k]);
+        partial[0] = norm_sq;
+        if (jacobian_v)
+        {
+            for (int i=begin; i<end; i++)
+            {
+                partial[1] += residuals[i] * c0[i]; partial[2] += residuals[i] * c1[i]; partial[3] += residuals[i] * c2[i];
+                partial[4] += residuals[i] * c3[i]; partial[5] += residuals[i] * c4[i]; partial[6] += residuals[i] * c5[i];
+            }
+        }
+    }
+
+    void residualChunk(const int &k, const double *px, const double *qx, const double &inv_norm, const double *s,
+                    double *residuals, double **jacobians) const
+    {
+        const ::eds::tracking::TrackingCache &kc = *(this->cache);
+        const int begin = k * CHUNK_SIZE, end = std::min(begin + CHUNK_SIZE, this->n_points);
+        const float *c0 = kc.coeff[0].data() + start, *c1 = kc.coeff[1].data() + start, *c2 = kc.coeff[2].data() + start;
+        const float *c3 = kc.coeff[3].data() + start, *c4 = kc.coeff[4].data() + start, *c5 = kc.coeff[5].data() + start;
+        const float *kx = kc.x.data() + start, *ky = kc.y.data() + start, *kz = kc.z.data() + start;
+        const float *kw = kc.weights.data() + start;
+        const double qx_x = qx[0], qx_y = qx[1], qx_z = qx[2], qx_w = qx[3];
+
+        /** Rotation matrix as Eigen::Quaternion::toRotationMatrix **/
+        const double tx = 2.0*qx_x, ty = 2.0*qx_y, tz = 2.0*qx_z;
+        const double twx = tx*qx_w, twy = ty*qx_w, twz = tz*qx_w;
+        const double txx = tx*qx_x, txy = ty*qx_x, txz = tz*qx_x;
+        const double tyy = ty*qx_y, tyz = tz*qx_y, tzz = tz*qx_z;
+        const double R[9] = {1.0-(tyy+tzz), txy-twz, txz+twy,
+                             txy+twz, 1.0-(txx+tzz), tyz-twx,
+                             txz-twy, tyz+twx, 1.0-(txx+tyy)};
+
+        /** Points in the event frame and their projection (scratch of this chunk) **/
+        const int n = end - begin;
+        double *P = this->scratch.data() + 8*begin, *img_r = P + 3*n, *img_c = img_r + n;
+        double *E = img_c + n, *dE_dr = E + n, *dE_dc = dE_dr + n;
+        for (int i=0; i<n; i++)
+        {
+            const double a = kx[begin+i], b = ky[begin+i], c = kz[begin+i];
+            const double p0 = R[0]*a + R[1]*b + R[2]*c + px[0];
+            const double p1 = R[3]*a + R[4]*b + R[5]*c + px[1];
+            const double p2 = R[6]*a + R[7]*b + R[8]*c + px[2];
+            P[3*i] = p0; P[3*i+1] = p1; P[3*i+2] = p2;
+            img_c[i] = fx * (p0/p2) + cx;
+            img_r[i] = fy * (p1/p2) + cy;
+        }
+
+        /** Brightness change from the events and its image gradient (batch) **/
+        if (this->sampler)
+        {
+            this->sampler->evaluate(n, img_r, img_c, E, dE_dr, dE_dc);
+        }
+        else
+        {
+            for (int i=0; i<n; i++)
+                event_grid_interp->Evaluate(img_r[i], img_c[i], &(E[i]), &(dE_dr[i]), &(dE_dc[i]));
+        }
+
+        for (int l=0; l<n; l++)
+        {
+            const int i = begin + l;
+            const double a = kx[i], b = ky[i], c = kz[i];
+            const double w = kw[i];
+            const double p0 = P[3*l], p1 = P[3*l+1];
+            const double inv_z = 1.0/P[3*l+2];
+            const double event_brightness = E[l], de_dy = dE_dr[l], de_dx = dE_dc[l];
+
+            const double model = residuals[i];
+            residuals[i] = w * ((model*inv_norm) - event_brightness);
+
+            if (jacobians == nullptr)
+                continue;
+
+            /** d(residual)/d(point): -w * dE/d(xp, yp) * d(xp, yp)/d(point) **/
+            const double gx = -w * de_dx * fx * inv_z;
+            const double gy = -w * de_dy * fy * inv_z;
+            const double gz = -(gx * p0 + gy * p1) * inv_z;
+
+            if (jacobians[0] != nullptr)
+            {
+                double *j = jacobians[0] + 3*i;
+                j[0] = gx; j[1] = gy; j[2] = gz;
+            }
+
+            if (jacobians[1] != nullptr)
+            {
+                /** Derivative of R(q) * X w.r.t. the (x, y, z, w) coefficients **/
+                const double x = qx_x, y = qx_y, z = qx_z, qw = qx_w;
+                double *j = jacobians[1] + 4*i;
+                j[0] = gx * (2.0*y*b + 2.0*z*c)
+                     + gy * (2.0*y*a - 4.0*x*b - 2.0*qw*c)
+                     + gz * (2.0*z*a + 2.0*qw*b - 4.0*x*c);
+                j[1] = gx * (-4.0*y*a + 2.0*x*b + 2.0*qw*c)
+                     + gy * (2.0*x*a + 2.0*z*c)
+                     + gz * (-2.0*qw*a + 2.0*z*b - 4.0*y*c);
+                j[2] = gx * (-4.0*z*a - 2.0*qw*b + 2.0*x*c)
+                     + gy * (2.0*qw*a - 4.0*z*b + 2.0*y*c)
+                     + gz * (2.0*x*a + 2.0*y*b);
+                j[3] = gx * (-2.0*z*b + 2.0*y*c)
+                     + gy * (2.0*z*a - 2.0*x*c)
+                     + gz * (-2.0*y*a + 2.0*x*b);
+            }
+
+            if (jacobians[2] != nullptr)
+            {
+                const double cf[6] = {c0[i], c1[i], c2[i], c3[i], c4[i], c5[i]};
+                const double m_norm_sq = model * inv_norm * inv_norm;
+                double *j = jacobians[2] + 6*i;
+                for (int m=0; m<6; ++m)
+                    j[m] = w * (cf[m] - m_norm_sq * s[m]) * inv_norm;
+            }
+        }
+    }
+
+    // Factory to hide the construction of the CostFunction object from
+    // the client code.
+    static ceres::CostFunction* Create(const ::eds::tracking::TrackingCache *cache,
+                                       const std::vector<Scalar> *event_frame,
+                                       const int &height, const int &width,
+                                       const double &fx, const double &fy,
+                                       const double &cx, const double &cy,
+                                       const int &start_element, const int &num_elements,
+                                       const ::eds::utils::INTERPOLATOR_TYPE &interpolator = ::eds::utils::CERES_BICUBIC,
+                                       ::dso::IndexThreadReduce<double> *thread_reduce = nullptr)
+    {
+        return new PhotometricErrorAnalyticT(cache, event_frame, height, width, fx, fy, cx, cy, start_element, num_elements,
+                                            interpolator, thread_reduce);
+    }
+
+    static ceres::CostFunction* Create(const std::vector<cv::Point2d> *grad,
+                                       const std::vector<cv::Point2d> *norm_coord,
+                                       const std::vector<double> *idp,
+                                       const std::vector<double> *weights,
+                                       const std::vector<Scalar> *event_frame,
+                                       const int &height, const int &width,
+                                       const double &fx, const double &fy,
+                                       const double &cx, const double &cy,
+                                       const int &start_element, const int &num_elements)
+    {
+        return new PhotometricErrorAnalyticT(grad, norm_coord, idp, weights, event_frame, height, width, fx, fy, cx, cy, start_element, num_elements);
+    }
+
+    int start; // start of points
+    int n_points; // number of active points
+    int height, width; // height and width of the image
+    double fx, fy, cx, cy; // intrinsics
+    const ::eds::tracking::TrackingCache *cache; // keyframe points, model coefficients and weights
+    std::shared_ptr<::eds::tracking::TrackingCache> own_cache; // cache when built from the point vectors
+    const std::vector<Scalar> *event_frame; // H x W event frame with the brightness change
+    std::unique_ptr< ceres::Grid2D<Scalar, 1> > event_grid;
+    std::unique_ptr< ceres::BiCubicInterpolator< ceres::Grid2D<Scalar, 1> > > event_grid_interp;
+    std::unique_ptr< ::eds::utils::BicubicSampler<Scalar> > sampler; // FAST_BICUBIC interpolator
+    ::dso::IndexThreadReduce<double> *thread_reduce; // thread pool of the chunks (nullptr: this thread)
+    mutable std::vector<double> scratch; // per point projections and samples (one evaluation at a time per block)
+    mutable std::vector<double> partials; // per chunk partial sums of the model
+};
+
+typedef PhotometricErrorAnalyticT<double> PhotometricErrorAnalytic;
+typedef PhotometricErrorAnalyticT<float> PhotometricErrorAnalyticf;
+
+} //tracking namespace
+} // end namespace
+
+#endif // _EDS_PHOTOMETRIC_ERROR_ANALYTIC_HPP_
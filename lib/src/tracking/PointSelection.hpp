@@ -0,0 +1,133 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EDS_TRACKING_POINT_SELECTION_HPP_
+#define _EDS_TRACKING_POINT_SELECTION_HPP_
+
+#include <eds/tracking/TrackingCache.hpp>
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+
+#include <tuple>
+#include <vector>
+#include <algorithm>
+
+namespace eds { namespace tracking {
+
+    /** @brief Information score of the points in the cache.
+     *
+     * The row of the point in the Jacobian of the tracking residuals is
+     * J_i = w_i * c_i (image gradient times the flow basis of the six
+     * velocity components, the same basis linearizes the pose). The score
+     * is the leverage s_i = J_i^T H^-1 J_i with H = sum_j J_j J_j^T: points
+     * in the weak directions of H score high, the scores add up to six.
+     * robust_weights (optional) scales w_i^2 per point (IRLS weights) **/
+    inline std::vector<double> informationScores(const ::eds::tracking::TrackingCache &cache,
+                                            const std::vector<double> *robust_weights = nullptr)
+    {
+        typedef Eigen::Matrix<double, 6, 1> Vector6d;
+        typedef Eigen::Matrix<double, 6, 6> Matrix6d;
+        const size_t n = cache.size();
+        assert(robust_weights == nullptr || robust_weights->size() == n);
+
+        auto jacobian = [&cache](const size_t &i) -> Vector6d
+        {
+            Vector6d j;
+            for (int k=0; k<6; ++k)
+                j[k] = cache.weights[i] * cache.coeff[k][i];
+            return j;
+        };
+
+        Matrix6d H = Matrix6d::Zero();
+        for (size_t i=0; i<n; ++i)
+        {
+            const Vector6d j = jacobian(i);
+            const double rw = (robust_weights)? (*robust_weights)[i] : 1.0;
+            H.noalias() += rw * j * j.transpose();
+        }
+
+        /** Small damping for the unobservable directions **/
+        H.diagonal().array() += 1e-09 * (H.trace() + 1e-09);
+        const Eigen::LDLT<Matrix6d> H_ldlt(H);
+
+        std::vector<double> scores(n);
+        for (size_t i=0; i<n; ++i)
+        {
+            const Vector6d j = jacobian(i);
+            const double rw = (robust_weights)? (*robust_weights)[i] : 1.0;
+            scores[i] = rw * j.dot(H_ldlt.solve(j));
+        }
+        return scores;
+    };
+
+    /** @brief Indices (ascending) of the best budget points with spatial
+     * bucketing: the image is split in grid_cols x grid_rows buckets and
+     * the buckets give their points by rounds (the best point of every
+     * bucket, then the second best, ...). In a round the points are taken
+     * by score. All the points are kept when there are less than budget **/
+    inline std::vector<int> selectPoints(const std::vector<double> &scores, const std::vector<cv::Point2d> &coord,
+                                    const cv::Size &img_size, const size_t &budget,
+                                    const int &grid_cols = 8, const int &grid_rows = 6)
+    {
+        assert(scores.size() == coord.size());
+        const size_t n = coord.size();
+        std::vector<int> indices;
+        if (n <= budget)
+        {
+            indices.resize(n);
+            for (size_t i=0; i<n; ++i) indices[i] = i;
+            return indices;
+        }
+
+        /** Bucket of every point and the points of every bucket by score **/
+        const int num_buckets = grid_cols * grid_rows;
+        std::vector< std::vector<int> > buckets(num_buckets);
+        for (size_t i=0; i<n; ++i)
+        {
+            const int col = std::min(std::max(static_cast<int>(coord[i].x * grid_cols / img_size.width), 0), grid_cols - 1);
+            const int row = std::min(std::max(static_cast<int>(coord[i].y * grid_rows / img_size.height), 0), grid_rows - 1);
+            buckets[row * grid_cols + col].push_back(i);
+        }
+
+        /** Order: (round, -score, index) **/
+        std::vector< std::tuple<int, double, int> > order; order.reserve(n);
+        for (auto &bucket : buckets)
+        {
+            std::sort(bucket.begin(), bucket.end(), [&scores](const int &a, const int &b)
+            {
+                return (scores[a] > scores[b]) || (scores[a] == scores[b] && a < b);
+            });
+            for (size_t k=0; k<bucket.size(); ++k)
+                order.emplace_back(static_cast<int>(k), -scores[bucket[k]], bucket[k]);
+        }
+        std::nth_element(order.begin(), order.begin() + budget, order.end());
+
+        indices.reserve(budget);
+        for (size_t k=0; k<budget; ++k)
+            indices.push_back(std::get<2>(order[k]));
+        std::sort(indices.begin(), indices.end());
+        return indices;
+    };
+
+} // tracking namespace
+} // end namespace
+
+#endif // _EDS_TRACKING_POINT_SELECTION_HPP_
@@ -0,0 +1,64 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TimeSurface.hpp"
+
+#include <algorithm>
+
+using namespace eds::tracking;
+
+TimeSurface::TimeSurface()
+:height(0), width(0), decay(1.0), t_ref(0), initialized(false)
+{
+}
+
+TimeSurface::TimeSurface(const uint16_t &height, const uint16_t &width, const double &decay_us)
+:height(height), width(width), decay(std::max(decay_us, 1.0)), t_ref(0), initialized(false)
+{
+    this->surface.assign(height * width, 0.0);
+}
+
+void TimeSurface::reset()
+{
+    std::fill(this->surface.begin(), this->surface.end(), 0.0);
+    this->t_ref = 0;
+    this->initialized = false;
+}
+
+void TimeSurface::rebase(const int64_t &ts)
+{
+    const double scale = std::exp(-(ts - this->t_ref) / this->decay);
+    for (double &value : this->surface)
+        value *= scale;
+    this->t_ref = ts;
+}
+
+void TimeSurface::query(const int64_t &ts, cv::Mat &img) const
+{
+    img.create(this->height, this->width, CV_64FC1);
+    const double scale = (this->initialized)? std::exp(-(ts - this->t_ref) / this->decay) : 0.0;
+    for (int row=0; row<this->height; ++row)
+    {
+        const double *src = this->surface.data() + row * this->width;
+        double *dst = img.ptr<double>(row);
+        for (int col=0; col<this->width; ++col)
+            dst[col] = scale * src[col];
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EDS_TIME_SURFACE_HPP_
+#define _EDS_TIME_SURFACE_HPP_
+
+#include <eds/utils/Accumulate.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+
+namespace eds {
+namespace tracking {
+
+    /** Exponentially decayed event accumulator (time surface). The value
+     * of a pixel at time t is sum(p_k * exp(-(t - t_k)/decay)) over its
+     * events k. The surface stores the values scaled by exp((t - t_ref)/decay)
+     * so inserting an event is one exp and a bilinear vote (O(1)), and the
+     * query at any time is one scale of the image. The reference time moves
+     * forward before the scale overflows **/
+    class TimeSurface
+    {
+        public:
+            /** Largest exponent before moving the reference time **/
+            static constexpr double max_exponent = 30.0;
+
+        private:
+            uint16_t height, width;
+            /** Decay time constant [us] **/
+            double decay;
+            /** Reference time of the scaled values [us] **/
+            int64_t t_ref;
+            bool initialized;
+            /** H x W scaled values **/
+            std::vector<double> surface;
+
+            /** Scale all the values to a new reference time **/
+            void rebase(const int64_t &ts);
+
+        public:
+            /** @brief Default constructor **/
+            TimeSurface();
+
+            TimeSurface(const uint16_t &height, const uint16_t &width, const double &decay_us);
+
+            void reset();
+
+            /** @brief Insert an event at the (undistorted) coordinates x, y. Time in [us] **/
+            inline void add(const double &x, const double &y, const int8_t &value, const int64_t &ts)
+            {
+                if (!this->initialized)
+                {
+                    this->t_ref = ts;
+                    this->initialized = true;
+                }
+
+                double exponent = (ts - this->t_ref) / this->decay;
+                if (exponent > TimeSurface::max_exponent)
+                {
+                    this->rebase(ts);
+                    exponent = 0.0;
+                }
+                ::eds::utils::accumulatePoint<::eds::utils::BILINEAR>(this->surface.data(), this->width,
+                                this->height, this->width, x, y, std::exp(exponent), value);
+            };
+
+            /** @brief Decayed surface at time ts [us] (CV_64FC1 H x W) **/
+            void query(const int64_t &ts, cv::Mat &img) const;
+
+            bool empty() const {return !this->initialized;};
+
+            double getDecay() const {return this->decay;};
+    };
+
+} //tracking namespace
+} // end namespace
+
+#endif // _EDS_TIME_SURFACE_HPP_
@@ -23,13 +23,36 @@
 #include <eds/utils/Transforms.hpp>
 
 #include <eds/tracking/PhotometricError.hpp>
+#include <eds/tracking/PhotometricErrorAnalytic.hpp>
+#include <eds/tracking/PointSelection.hpp>
+#include <eds/tracking/ImuPreintegration.hpp>
 /*uncoment this and comment the other in case of testting */
 //#include <eds/tracking/PhotometricErrorNC.hpp>
 
 #include <iostream>
+#include <limits>
+#include <cmath>
 
 using namespace eds::tracking;
 
+/** Photometric error of the points [start, start + num) with the configured Jacobians
+ * and interpolator (autodiff always uses the ceres interpolator and this thread) **/
+template <typename Scalar>
+static ceres::CostFunction* createPhotometricError(const eds::tracking::Config &config, const eds::tracking::TrackingCache *cache,
+                                    const std::vector<Scalar> *event_frame,
+                                    const cv::Size &frame_size, const double &fx, const double &fy,
+                                    const double &cx, const double &cy, const int &start, const int &num,
+                                    ::dso::IndexThreadReduce<double> *thread_reduce)
+{
+    if (config.jacobian == ANALYTIC)
+        return PhotometricErrorAnalyticT<Scalar>::Create(cache, event_frame,
+                                            frame_size.height, frame_size.width, fx, fy, cx, cy, start, num, config.interpolator,
+                                            thread_reduce);
+    else
+        return PhotometricErrorT<Scalar>::Create(cache, event_frame,
+                                            frame_size.height, frame_size.width, fx, fy, cx, cy, start, num);
+}
+
 Tracker::Tracker(std::shared_ptr<eds::tracking::KeyFrame> kf, const eds::tracking::Config &config)
 {
     (*this) = Tracker(config);
@@ -44,6 +67,21 @@ Tracker::Tracker(const eds::tracking::Config &config)
     this->qx = Eigen::Quaterniond::Identity();
     this->vx<<0.001, 0.001, 0.001, 0.001, 0.001, 0.001;
     this->vx.normalize();
+    this->info.decimation = 1;
+    this->info.skipped_levels = 0;
+    this->info.saved_iterations = 0;
+    this->info.setup_time_us = this->info.solve_time_us = this->info.residuals_time_us = 0.0;
+    this->reranked = false;
+    this->motion_dt = 0.0;
+    this->has_imu_prior = false;
+    this->level_update = 0.0;
+    this->level_iterations = -1;
+    this->level_converged = false;
+
+    /** Own pool for the chunks of the global residual block (the task pool
+     * is used by the mapping) **/
+    if (config.options.global_norm && config.options.num_threads > 1)
+        this->thread_reduce = std::make_shared< ::dso::IndexThreadReduce<double> >(config.options.num_threads);
 }
 
 void Tracker::reset(std::shared_ptr<eds::tracking::KeyFrame> kf, const Eigen::Vector3d &px, const Eigen::Quaterniond &qx, const bool &keep_velo)
@@ -59,6 +97,9 @@ void Tracker::reset(std::shared_ptr<eds::tracking::KeyFrame> kf, const Eigen::Ve
         this->vx<<0.001, 0.001, 0.001, 0.001, 0.001, 0.001;
         this->vx.normalize();
     }
+    this->updateCache();
+    this->initialSelection();
+    this->resetMotion();
     std::cout<<"[TRACKER] New KF at address: "<<std::addressof(*(this->kf))<<std::endl;
 }
 
@@ -69,6 +110,184 @@ void Tracker::reset(std::shared_ptr<eds::tracking::KeyFrame> kf, const Eigen::Ve
     this->qx = qx;
     this->vx = velo;
     this->poses.clear();
+    this->updateCache();
+    this->initialSelection();
+    this->resetMotion();
+}
+
+void Tracker::updateCache()
+{
+    /** Keyframe points, depths, gradients and weights used by all the
+     * residual blocks and pyramid levels until the next keyframe **/
+    std::vector<double> idp; this->kf->inv_depth.getIDepth(idp);
+    this->cache.build(this->kf->grad, this->kf->norm_coord, idp, this->kf->weights);
+}
+
+void Tracker::resetMotion()
+{
+    /** The reset pose is the one at the keyframe time. The last motion
+     * (between two event frames) is kept **/
+    this->last_pose = eds::SE3(this->qx, this->px);
+    this->last_time = this->kf->time;
+    this->frame_time = this->kf->time;
+}
+
+void Tracker::predict(const ::base::Time &time)
+{
+    this->info.skipped_levels = 0;
+    this->info.saved_iterations = 0;
+    this->info.setup_time_us = this->info.solve_time_us = this->info.residuals_time_us = 0.0;
+    this->level_iterations = -1;
+    this->has_imu_prior = false;
+
+    /** The current pose is the solution of the last event frame **/
+    const eds::SE3 current(this->qx, this->px);
+    if (this->frame_time > this->last_time)
+    {
+        if (!this->last_time.isNull())
+        {
+            this->motion = current * this->last_pose.inverse();
+            this->motion_dt = (this->frame_time - this->last_time).toSeconds();
+        }
+        this->last_pose = current;
+        this->last_time = this->frame_time;
+    }
+    this->frame_time = time;
+
+    if (!this->config.options.warm_start || this->motion_dt <= 0.0)
+        return;
+
+    /** Constant velocity: the last motion scaled to the time of the event frame **/
+    const double alpha = std::min(std::max((time - this->last_time).toSeconds()/this->motion_dt, 0.0), 3.0);
+    const eds::SE3 prediction = eds::SE3::exp(alpha * this->motion.log()) * current;
+    this->px = prediction.translation();
+    this->qx = prediction.unit_quaternion();
+    std::cout<<"[TRACKER] predicted px ["<<px[0]<<","<<px[1]<<","<<px[2]<<"] qx ["<<qx.x()<<","<<qx.y()<<","<<qx.z()<<","<<qx.w()<<"] alpha: "<<alpha<<std::endl;
+}
+
+int Tracker::levelIterations(const int &id)
+{
+    int max_num_iterations = this->config.options.max_num_iterations[id];
+
+    /** The coarser level converged: this level starts close to the solution **/
+    if (this->config.options.adaptive_iterations && this->level_iterations >= 0 && this->level_converged)
+        max_num_iterations = std::min(max_num_iterations, std::max(2 * this->level_iterations, 2));
+
+    return max_num_iterations;
+}
+
+void Tracker::endLevel(const int &id, const eds::SE3 &level_start, const int &num_iterations, const bool &converged)
+{
+    /** Pose update of the level (translation and rotation angle) **/
+    const eds::SE3 delta = eds::SE3(this->qx, this->px) * level_start.inverse();
+    this->level_update = std::sqrt(delta.translation().squaredNorm() + delta.so3().log().squaredNorm());
+    this->level_iterations = (this->info.success)? num_iterations : -1;
+    this->level_converged = converged;
+    this->info.saved_iterations += std::max(this->config.options.max_num_iterations[id] - num_iterations, 0);
+}
+
+bool Tracker::skipFinerLevels(const int &id)
+{
+    /** Only a converged level with a small update: a level stopped by the
+     * iteration limit (or a failure) may still be far from the solution **/
+    if (this->config.options.skip_threshold <= 0.0 || this->level_iterations < 0
+        || !this->level_converged || this->level_update >= this->config.options.skip_threshold)
+        return false;
+
+    for (int i=0; i<id; ++i)
+    {
+        this->info.skipped_levels++;
+        this->info.saved_iterations += this->config.options.max_num_iterations[i];
+    }
+    std::cout<<"[TRACKER] LEVEL "<<id<<" update "<<this->level_update<<" skipping "<<id<<" finer levels"<<std::endl;
+    return true;
+}
+
+void Tracker::imuPrior(const Eigen::Quaterniond &delta_q, const Eigen::Vector3d &angular_velocity,
+                    const Eigen::Matrix3d &covariance)
+{
+    /** Rotation of T_ef_kf: R_ef_kf = R_ci_cj^T * R_ef_kf (last solved event frame) **/
+    this->q_prior = (delta_q.conjugate() * this->last_pose.unit_quaternion()).normalized();
+    this->qx = this->q_prior;
+
+    /** Camera velocity: translation of the motion model and the gyroscope rate **/
+    if (this->motion_dt > 0.0)
+    {
+        Eigen::Matrix<double, 6, 1> velo;
+        velo << this->motion.inverse().translation()/this->motion_dt, angular_velocity;
+        if (velo.norm() > 0.0)
+            this->vx = velo.normalized();
+    }
+
+    /** Square root information of the prior weighted with prior_weight **/
+    const Eigen::Matrix3d information = (covariance + 1e-12 * Eigen::Matrix3d::Identity()).inverse();
+    this->prior_sqrt_information = this->config.imu.prior_weight * Eigen::Matrix3d(information.llt().matrixL().transpose());
+    this->has_imu_prior = true;
+    std::cout<<"[TRACKER] IMU prior qx ["<<qx.x()<<","<<qx.y()<<","<<qx.z()<<","<<qx.w()<<"] w ["<<angular_velocity.transpose()<<"]"<<std::endl;
+}
+
+void Tracker::initialSelection()
+{
+    this->reranked = false;
+    if (this->config.selection.type != INFORMATION)
+        return;
+
+    /** Twice the budget when the points are re-ranked after the first solve **/
+    const size_t budget = (this->config.selection.rerank? 2 : 1) * this->config.selection.budget;
+    this->selectPoints(eds::tracking::informationScores(this->cache), budget);
+}
+
+void Tracker::rerankPoints()
+{
+    if (this->config.selection.type != INFORMATION || !this->config.selection.rerank || this->reranked)
+        return;
+    this->reranked = true;
+
+    /** IRLS weights of the residuals at the solution (outliers lose their information) **/
+    std::unique_ptr<ceres::LossFunction> loss_function;
+    switch (config.loss_type)
+    {
+    case HUBER:
+        loss_function.reset(new ceres::HuberLoss(config.loss_params[0]));
+        break;
+    case CAUCHY:
+        loss_function.reset(new ceres::CauchyLoss(config.loss_params[0]));
+        break;
+    default:
+        break;
+    }
+    std::vector<double> robust_weights(this->kf->residuals.size(), 1.0);
+    for (size_t i=0; i<robust_weights.size() && loss_function; ++i)
+    {
+        const double r = this->kf->residuals[i];
+        double rho[3];
+        loss_function->Evaluate(r*r, rho);
+        robust_weights[i] = rho[1];
+    }
+    this->selectPoints(eds::tracking::informationScores(this->cache, &robust_weights), this->config.selection.budget);
+}
+
+void Tracker::selectPoints(const std::vector<double> &scores, const size_t &budget)
+{
+    const size_t num_points = this->kf->norm_coord.size();
+    const std::vector<int> &grid = this->config.selection.grid;
+    if (grid.size() != 2 || grid[0] <= 0 || grid[1] <= 0)
+        throw std::runtime_error("[TRACKER] point selection grid should be two positive values [cols, rows]");
+    std::vector<int> indices = eds::tracking::selectPoints(scores, this->kf->coord, this->kf->img.size(), budget,
+                                                        grid[0], grid[1]);
+    if (indices.size() == num_points)
+        return;
+
+    this->kf->selectPoints(indices);
+    this->cache.select(indices);
+    std::cout<<"[TRACKER] selected points: "<<indices.size()<<" of "<<num_points<<std::endl;
+}
+
+eds::tracking::KFPointIterators Tracker::erasePoint(const int &idx)
+{
+    if ((size_t)idx < this->cache.size())
+        this->cache.erase(idx);
+    return this->kf->erasePoint(idx);
 }
 
 void Tracker::set(const base::Transform3d &T_kf_ef)
@@ -78,7 +297,8 @@ void Tracker::set(const base::Transform3d &T_kf_ef)
     this->qx = Eigen::Quaterniond(T_kf_ef.inverse().rotation());
 }
 
-void Tracker::optimize(const int &id, const std::vector<double> *event_frame, ::base::Transform3d &T_kf_ef,
+template <typename Scalar>
+void Tracker::optimize(const int &id, const std::vector<Scalar> *event_frame, ::base::Transform3d &T_kf_ef,
                         const Eigen::Vector3d &px, const Eigen::Quaterniond &qx, 
                         const eds::tracking::LOSS_PARAM_METHOD loss_param_method)
 {
@@ -90,7 +310,8 @@ void Tracker::optimize(const int &id, const std::vector<double> *event_frame, ::
     this->optimize(id, event_frame, T_kf_ef, loss_param_method);
 }
 
-void Tracker::optimize(const int &id, const std::vector<double> *event_frame, ::base::Transform3d &T_kf_ef, 
+template <typename Scalar>
+void Tracker::optimize(const int &id, const std::vector<Scalar> *event_frame, ::base::Transform3d &T_kf_ef, 
                         const Eigen::Matrix<double, 6, 1> &vx, 
                         const eds::tracking::LOSS_PARAM_METHOD loss_param_method)
 {
@@ -101,9 +322,24 @@ void Tracker::optimize(const int &id, const std::vector<double> *event_frame, ::
     this->optimize(id, event_frame, T_kf_ef, loss_param_method);
 }
 
-bool Tracker::optimize(const int &id, const std::vector<double> *event_frame, ::base::Transform3d &T_kf_ef,
+template <typename Scalar>
+bool Tracker::optimize(const int &id, const std::vector<Scalar> *event_frame, ::base::Transform3d &T_kf_ef,
                         const eds::tracking::LOSS_PARAM_METHOD loss_param_method)
 {
+    return this->optimize(id, event_frame, this->kf->img.size(), 1.0, T_kf_ef, loss_param_method);
+}
+
+template <typename Scalar>
+bool Tracker::optimize(const int &id, const std::vector<Scalar> *event_frame, const cv::Size &frame_size,
+                        const double &scale, ::base::Transform3d &T_kf_ef,
+                        const eds::tracking::LOSS_PARAM_METHOD loss_param_method)
+{
+    /** Dense solver without the ceres problem setup **/
+    if (config.type.compare("gauss_newton") == 0)
+        return this->optimizeGaussNewton(id, event_frame, frame_size, scale, T_kf_ef, loss_param_method);
+
+    auto setup_start = std::chrono::high_resolution_clock::now();
+
     /* Ceres problem **/
     ceres::Problem problem;
     ceres::Solver::Options options;
@@ -136,7 +372,7 @@ bool Tracker::optimize(const int &id, const std::vector<double> *event_frame, ::
     std::cout<<"[TRACKER] LEVEL "<<id<<std::endl;
 
     options.num_threads = config.options.num_threads;
-    options.max_num_iterations = config.options.max_num_iterations[id];
+    options.max_num_iterations = this->levelIterations(id);
     options.function_tolerance = config.options.function_tolerance;
     options.minimizer_progress_to_stdout = config.options.minimizer_progress_to_stdout;
     options.gradient_tolerance = 1e-08;
@@ -160,44 +396,58 @@ bool Tracker::optimize(const int &id, const std::vector<double> *event_frame, ::
         break;
     }
 
-    /** Variables for the cost function **/
+    /** Variables for the cost function (intrinsics of the pyramid level).
+     * The keyframe gradients are not scaled: the model is normalized **/
     double fx, fy, cx, cy;
-    fx = kf->K_ref.at<double>(0,0); fy = kf->K_ref.at<double>(1,1);
-    cx = kf->K_ref.at<double>(0,2); cy = kf->K_ref.at<double>(1,2);
-    std::vector<double> idp; kf->inv_depth.getIDepth(idp);
+    fx = scale * kf->K_ref.at<double>(0,0); fy = scale * kf->K_ref.at<double>(1,1);
+    cx = scale * kf->K_ref.at<double>(0,2); cy = scale * kf->K_ref.at<double>(1,2);
     std::vector< std::pair<ceres::ResidualBlockId, ceres::CostFunction*> > residual_blocks;
 
+    /** Points removed outside the tracker **/
+    if (this->cache.size() != kf->norm_coord.size())
+        this->updateCache();
+
     std::cout<<"[TRACKER] fx: "<<fx<<" fy: "<<fy<<" cx: "<<cx<<" cy: "<<cy<<std::endl;
     std::cout<<"[TRACKER] grad ["<<std::addressof(kf->grad)<<"] size: "<<kf->grad.size()<<std::endl;
     std::cout<<"[TRACKER] norm_coord ["<<std::addressof(kf->norm_coord)<<"] size: "<<kf->norm_coord.size()<<std::endl;
-    std::cout<<"[TRACKER] idp ["<<std::addressof(idp)<<"] size: "<<idp.size()<<std::endl;
+    std::cout<<"[TRACKER] cache ["<<std::addressof(this->cache)<<"] size: "<<this->cache.size()<<std::endl;
     std::cout<<"[TRACKER] event_frame ["<<std::addressof(*event_frame)<<"] size "<<event_frame->size()<<std::endl;
     std::cout<<"[TRACKER] init px ["<<px[0]<<","<<px[1]<<","<<px[2]<<"] qx ["<<qx.x()<<","<<qx.y()<<","<<qx.z()<<","<<qx.w()<<"]\n";
     std::cout<<"[TRACKER] init vx ["<<vx[0]<<","<<vx[1]<<","<<vx[2]<<"] wx ["<<vx[3]<<","<<vx[4]<<","<<vx[5]<<"]\n";
 
-    int num_elements = kf->norm_coord.size()/options.num_threads;
-    for (int i=0; i<options.num_threads; ++i)
+    /** One residual block per thread (model normalized per block) or a
+     * single block with all the points (global_norm) **/
+    const int num_blocks = (config.options.global_norm)? 1 : options.num_threads;
+    int num_elements = kf->norm_coord.size()/num_blocks;
+    for (int i=0; i<num_blocks; ++i)
     {
         int extra_elements = 0;
-        if (i+1 == options.num_threads)
+        if (i+1 == num_blocks)
         {
             extra_elements = kf->norm_coord.size() - (i+1) * num_elements;
         }
 
         int s_point = i * num_elements;
         std::cout<<"\tRESIDUAL["<<i<<"]: start point: "<<s_point<<" end point: "<<s_point+num_elements+extra_elements<<std::endl;
-        ceres::CostFunction* cost_function =
-                        PhotometricError::Create(&(kf->grad), &(kf->norm_coord), &(idp), &(kf->weights), event_frame,
-                                            kf->img.rows, kf->img.cols, fx, fy, cx, cy, s_point, num_elements+extra_elements);
+        ceres::CostFunction* cost_function = createPhotometricError(this->config, &(this->cache), event_frame,
+                                            frame_size, fx, fy, cx, cy, s_point, num_elements+extra_elements,
+                                            this->thread_reduce.get());
         ::ceres::ResidualBlockId b_id = problem.AddResidualBlock(cost_function, loss_function,
                     this->px.data(), this->qx.coeffs().data(), this->vx.data());
         residual_blocks.push_back(std::make_pair(b_id, cost_function));
     }
 
+    /** IMU rotation prior **/
+    const bool imu_prior = this->has_imu_prior && config.imu.prior_weight > 0.0;
+    if (imu_prior)
+        problem.AddResidualBlock(RotationPrior::Create(this->q_prior, this->prior_sqrt_information), nullptr,
+                    this->qx.coeffs().data());
+
     problem.SetParameterization(this->qx.coeffs().data(), quaternion_local_parameterization);
     problem.SetParameterization(this->vx.data(), velocity_local_parameterization);
 
     ceres::Solver::Summary summary;
+    const eds::SE3 level_start(this->qx, this->px);
     auto start = std::chrono::high_resolution_clock::now();
     ceres::Solve(options, &problem, &summary);
     auto stop = std::chrono::high_resolution_clock::now();
@@ -207,10 +457,14 @@ bool Tracker::optimize(const int &id, const std::vector<double> *event_frame, ::
 
     /** Save status information **/
     this->info.meas_time_us = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
-    this->info.num_points = summary.num_residuals;
+    this->info.setup_time_us += std::chrono::duration<double, std::micro>(start - setup_start).count();
+    this->info.solve_time_us += std::chrono::duration<double, std::micro>(stop - start).count();
+    this->info.num_points = summary.num_residuals - (imu_prior? 3 : 0);
     this->info.num_iterations = summary.num_successful_steps + summary.num_unsuccessful_steps;
     this->info.time_seconds = summary.total_time_in_seconds; 
     this->info.success = summary.IsSolutionUsable(); 
+    this->endLevel(id, level_start, this->info.num_iterations,
+                summary.IsSolutionUsable() && summary.termination_type == ceres::CONVERGENCE);
 
     /** Valid numerical solution, converge or no-coverger
      * depending on the number of max iterations **/
@@ -223,7 +477,7 @@ bool Tracker::optimize(const int &id, const std::vector<double> *event_frame, ::
         this->kf->residuals.resize(kf->norm_coord.size());
         std::vector<double*> params;
         params.push_back(this->px.data()); params.push_back(this->qx.coeffs().data()); params.push_back(this->vx.data());
-        for (int i=0; i<options.num_threads; ++i)
+        for (int i=0; i<num_blocks; ++i)
         {
             ceres::CostFunction *cost_function = residual_blocks[i].second; 
             cost_function->Evaluate(&(params[0]), &(this->kf->residuals[i*num_elements]), nullptr);
@@ -231,6 +485,10 @@ bool Tracker::optimize(const int &id, const std::vector<double> *event_frame, ::
 
         /** Compute the Loss parameter based on the points residuals **/
         this->config.loss_params = this->getLossParams(loss_param_method);
+        this->info.residuals_time_us += std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - stop).count();
+
+        /** First solve of the keyframe at the finest level **/
+        if (id == 0) this->rerankPoints();
 
         return true;
     }
@@ -240,6 +498,237 @@ bool Tracker::optimize(const int &id, const std::vector<double> *event_frame, ::
     }
 }
 
+template <typename Scalar>
+bool Tracker::optimizeGaussNewton(const int &id, const std::vector<Scalar> *event_frame, const cv::Size &frame_size,
+                        const double &scale, ::base::Transform3d &T_kf_ef,
+                        const eds::tracking::LOSS_PARAM_METHOD loss_param_method)
+{
+    typedef Eigen::Matrix<double, 12, 12> Matrix12d;
+    typedef Eigen::Matrix<double, 12, 1> Vector12d;
+
+    std::cout<<"[TRACKER] LEVEL "<<id<<" (gauss_newton)"<<std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    /** Same loss functions as the ceres problem (used as IRLS weights) **/
+    std::unique_ptr<ceres::LossFunction> loss_function;
+    switch (config.loss_type)
+    {
+    case HUBER:
+        loss_function.reset(new ceres::HuberLoss(config.loss_params[0]));
+        break;
+    case CAUCHY:
+        loss_function.reset(new ceres::CauchyLoss(config.loss_params[0]));
+        break;
+    default:
+        break;
+    }
+
+    /** Variables for the cost function (intrinsics of the pyramid level) **/
+    double fx, fy, cx, cy;
+    fx = scale * kf->K_ref.at<double>(0,0); fy = scale * kf->K_ref.at<double>(1,1);
+    cx = scale * kf->K_ref.at<double>(0,2); cy = scale * kf->K_ref.at<double>(1,2);
+    if (this->cache.size() != kf->norm_coord.size())
+        this->updateCache();
+
+    /** Same residual blocks as the ceres problem (the model is normalized per block) **/
+    const int num_blocks = (config.options.global_norm)? 1 : std::max(config.options.num_threads, 1);
+    const int num_points = kf->norm_coord.size();
+    const int num_elements = num_points/num_blocks;
+    std::vector< std::unique_ptr<ceres::CostFunction> > cost_functions;
+    std::vector<int> block_start;
+    for (int i=0; i<num_blocks; ++i)
+    {
+        int num = (i+1 == num_blocks)? num_points - i * num_elements : num_elements;
+        block_start.push_back(i * num_elements);
+        cost_functions.emplace_back(createPhotometricError(this->config, &(this->cache), event_frame,
+                                            frame_size, fx, fy, cx, cy, i * num_elements, num, this->thread_reduce.get()));
+    }
+    auto solve_start = std::chrono::high_resolution_clock::now();
+
+    /** Evaluate the cost 0.5 * sum rho(r^2) and the normal equations in the
+     * local parameters [dp(3), dq(3), dv(6)] **/
+    std::vector<double> &residuals = this->gn_residuals, &jac_p = this->gn_jac_p;
+    std::vector<double> &jac_q = this->gn_jac_q, &jac_v = this->gn_jac_v;
+    residuals.resize(num_points); jac_p.resize(3 * num_points);
+    jac_q.resize(4 * num_points); jac_v.resize(6 * num_points);
+    auto evaluate = [&](const Eigen::Vector3d &p, const Eigen::Quaterniond &q, const Eigen::Matrix<double, 6, 1> &v,
+                        Matrix12d &H, Vector12d &g) -> double
+    {
+        const double *params[3] = {p.data(), q.coeffs().data(), v.data()};
+        for (size_t b=0; b<cost_functions.size(); ++b)
+        {
+            const int s = block_start[b];
+            double *jacobians[3] = {&(jac_p[3*s]), &(jac_q[4*s]), &(jac_v[6*s])};
+            if (!cost_functions[b]->Evaluate(params, &(residuals[s]), jacobians))
+                return std::numeric_limits<double>::infinity();
+        }
+
+        /** Local parameterizations: q <- [dq, 0] * q (as EigenQuaternionParameterization)
+         * and v <- (v + dv)/|v + dv| (as UnitNormVectorAddition) **/
+        Eigen::Matrix<double, 4, 3> P_q;
+        for (int k=0; k<3; ++k)
+        {
+            Eigen::Quaterniond e(0.0, 0.0, 0.0, 0.0); e.vec()[k] = 1.0;
+            P_q.col(k) = (e * q).coeffs();
+        }
+        const double v_norm = v.norm();
+        const Eigen::Matrix<double, 6, 6> P_v = (Eigen::Matrix<double, 6, 6>::Identity()
+                                                - (v * v.transpose())/(v_norm * v_norm)) / v_norm;
+
+        double cost = 0.0;
+        H.setZero(); g.setZero();
+        for (int i=0; i<num_points; ++i)
+        {
+            const double r = residuals[i];
+            double rho[3] = {r*r, 1.0, 0.0};
+            if (loss_function)
+                loss_function->Evaluate(r*r, rho);
+            cost += 0.5 * rho[0];
+
+            Vector12d j;
+            j.segment<3>(0) = Eigen::Map<const Eigen::Vector3d>(&(jac_p[3*i]));
+            j.segment<3>(3) = P_q.transpose() * Eigen::Map<const Eigen::Vector4d>(&(jac_q[4*i]));
+            j.segment<6>(6) = P_v.transpose() * Eigen::Map<const Eigen::Matrix<double, 6, 1>>(&(jac_v[6*i]));
+
+            /** IRLS: the robust loss weights the point **/
+            H.noalias() += rho[1] * j * j.transpose();
+            g.noalias() += (rho[1] * r) * j;
+        }
+
+        /** IMU rotation prior: r = S * 2 * vec(q * q_prior^-1) is linear in q **/
+        if (this->has_imu_prior && config.imu.prior_weight > 0.0)
+        {
+            const Eigen::Quaterniond q_inv = this->q_prior.conjugate();
+            const Eigen::Quaterniond q_err = q * q_inv;
+            const double sign = (q_err.w() < 0.0)? -1.0 : 1.0;
+            Eigen::Matrix<double, 3, 4> M;
+            for (int k=0; k<4; ++k)
+            {
+                Eigen::Quaterniond e(0.0, 0.0, 0.0, 0.0); e.coeffs()[k] = 1.0;
+                M.col(k) = (e * q_inv).vec();
+            }
+            const Eigen::Vector3d r_prior = this->prior_sqrt_information * (2.0 * sign * q_err.vec());
+            const Eigen::Matrix3d J_prior = this->prior_sqrt_information * (2.0 * sign * M) * P_q;
+            cost += 0.5 * r_prior.squaredNorm();
+            H.block<3, 3>(3, 3).noalias() += J_prior.transpose() * J_prior;
+            g.segment<3>(3).noalias() += J_prior.transpose() * r_prior;
+        }
+        return cost;
+    };
+
+    /** Levenberg-Marquardt with the ceres initial damping and tolerances.
+     * The termination follows ceres: CONVERGENCE (a tolerance is met),
+     * NO_CONVERGENCE (iteration limit or no acceptable step) or FAILURE **/
+    const eds::SE3 level_start(this->qx, this->px);
+    const int max_num_iterations = this->levelIterations(id);
+    Matrix12d H, H_new; Vector12d g, g_new;
+    double cost = evaluate(this->px, this->qx, this->vx, H, g);
+    const double initial_cost = cost;
+    double lambda = 1e-04;
+    int num_successful = 0, num_unsuccessful = 0;
+    const double parameter_tolerance = 1e-06, gradient_tolerance = 1e-08;
+    ceres::TerminationType termination = (std::isfinite(cost))? ceres::NO_CONVERGENCE : ceres::FAILURE;
+    while (termination == ceres::NO_CONVERGENCE && num_successful + num_unsuccessful < max_num_iterations)
+    {
+        if (g.lpNorm<Eigen::Infinity>() <= gradient_tolerance)
+        {
+            termination = ceres::CONVERGENCE;
+            break;
+        }
+
+        /** Damped normal equations (diagonal clamped as in ceres) **/
+        Matrix12d A = H;
+        A.diagonal() += lambda * H.diagonal().cwiseMax(1e-06).cwiseMin(1e32);
+        const Vector12d delta = A.ldlt().solve(-g);
+
+        /** Step on the manifold **/
+        const Eigen::Vector3d dq = delta.segment<3>(3);
+        const double dq_norm = dq.norm();
+        Eigen::Quaterniond q_delta = Eigen::Quaterniond::Identity();
+        if (dq_norm > 0.0)
+        {
+            q_delta.w() = std::cos(dq_norm);
+            q_delta.vec() = (std::sin(dq_norm)/dq_norm) * dq;
+        }
+        const Eigen::Vector3d p_new = this->px + delta.segment<3>(0);
+        const Eigen::Quaterniond q_new = q_delta * this->qx;
+        const Eigen::Matrix<double, 6, 1> v_new = (this->vx + delta.segment<6>(6)).normalized();
+
+        const double x_norm = std::sqrt(this->px.squaredNorm() + this->qx.coeffs().squaredNorm() + this->vx.squaredNorm());
+        if (delta.norm() <= parameter_tolerance * (x_norm + parameter_tolerance))
+        {
+            termination = ceres::CONVERGENCE;
+            break;
+        }
+
+        const double new_cost = evaluate(p_new, q_new, v_new, H_new, g_new);
+        if (std::isfinite(new_cost) && new_cost < cost)
+        {
+            this->px = p_new; this->qx = q_new; this->vx = v_new;
+            H = H_new; g = g_new;
+            const double cost_change = cost - new_cost;
+            cost = new_cost;
+            lambda = std::max(lambda / 3.0, 1e-16);
+            num_successful++;
+            if (config.options.minimizer_progress_to_stdout)
+                std::cout<<"[TRACKER] iter "<<num_successful + num_unsuccessful<<" cost "<<cost<<" lambda "<<lambda<<std::endl;
+            if (cost_change <= config.options.function_tolerance * (cost + cost_change))
+            {
+                termination = ceres::CONVERGENCE;
+                break;
+            }
+        }
+        else
+        {
+            /** No acceptable step with any damping: the pose is the last
+             * accepted one, but it is not a converged solution **/
+            lambda *= 2.0 * (num_unsuccessful + 1);
+            num_unsuccessful++;
+            if (lambda > 1e32)
+                break;
+        }
+    }
+
+    /** Residuals at the solution (the last evaluation could be a rejected step) **/
+    Matrix12d H_end; Vector12d g_end;
+    cost = evaluate(this->px, this->qx, this->vx, H_end, g_end);
+    if (!std::isfinite(cost))
+        termination = ceres::FAILURE;
+    const bool usable = (termination != ceres::FAILURE);
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::cout << "[TRACKER] gauss_newton cost "<<initial_cost<<" -> "<<cost<<" iterations "<<num_successful + num_unsuccessful
+            <<" termination "<<ceres::TerminationTypeToString(termination)<<"\n";
+    std::cout << "[TRACKER] px ["<<px[0]<<","<<px[1]<<","<<px[2]<<"] qx ["<<qx.x()<<","<<qx.y()<<","<<qx.z()<<","<<qx.w()<<"]\n";
+    std::cout << "[TRACKER] vx ["<<vx[0]<<","<<vx[1]<<","<<vx[2]<<"] wx ["<<vx[3]<<","<<vx[4]<<","<<vx[5]<<"]\n";
+
+    /** Save status information **/
+    this->info.meas_time_us = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+    this->info.num_points = num_points;
+    this->info.num_iterations = num_successful + num_unsuccessful;
+    this->info.time_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(stop - start).count();
+    this->info.setup_time_us += std::chrono::duration<double, std::micro>(solve_start - start).count();
+    this->info.solve_time_us += std::chrono::duration<double, std::micro>(stop - solve_start).count();
+    this->info.success = usable;
+    this->endLevel(id, level_start, this->info.num_iterations, termination == ceres::CONVERGENCE);
+
+    if (!usable)
+        return false;
+
+    /** Return the inverse **/
+    T_kf_ef = this->getTransform().inverse();
+
+    /** Residuals into the Keyframe and the Loss parameter **/
+    this->kf->residuals = residuals;
+    this->config.loss_params = this->getLossParams(loss_param_method);
+    this->info.residuals_time_us += std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - stop).count();
+
+    /** First solve of the keyframe at the finest level **/
+    if (id == 0) this->rerankPoints();
+
+    return true;
+}
+
 ::base::Transform3d Tracker::getTransform()
 {
     ::eds::SE3 se3(this->qx, this->px);
@@ -330,17 +819,17 @@ std::vector<cv::Point2d> Tracker::getCoord(const bool &delete_out_point)
     /** Reset squared nom flow **/
     this->squared_norm_flow = 0;
 
-    /** Iterators **/
-    int idx = 0;
-    int num_removed_points = 0;
-    auto it_c = this->kf->norm_coord.begin();
+    /** Points kept in the keyframe (all of them without delete_out_point) **/
+    const size_t num_points = this->kf->norm_coord.size();
+    std::vector<int> indices;
+    indices.reserve(num_points);
     auto it_i = this->kf->inv_depth.begin();
-    for (; it_c != this->kf->norm_coord.end() && it_i != this->kf->inv_depth.end();)
+    for (size_t idx=0; idx<num_points; ++idx, ++it_i)
     {
         Eigen::Vector3d p;
         p[2] = 1.0/::eds::mapping::mu(*it_i);
-        p[0] = (*it_c).x * p[2];
-        p[1] = (*it_c).y * p[2];
+        p[0] = this->kf->norm_coord[idx].x * p[2];
+        p[1] = this->kf->norm_coord[idx].y * p[2];
         p = R * p + this->px; // point in the event frame
 
         /** Project the point into the event frame **/
@@ -350,25 +839,29 @@ std::vector<cv::Point2d> Tracker::getCoord(const bool &delete_out_point)
         /** Check whether the point is out of the frame **/
         bool outlier = ((xp<0.0 || xp>this->kf->img.cols) || (yp<0.0 || yp>this->kf->img.rows));
         if (delete_out_point & outlier)
-        {
-            //std::cout<<"GOING TO DELETE POINT: "<<idx<<" xp: "<<xp<<" yp: "<<yp<<std::endl;
-            auto its = this->kf->erasePoint(idx);
-            it_c = its.norm_coord; it_i = its.inv_depth; // next elements
-            num_removed_points++;
-        }
+            continue;
+
+        coord.push_back(cv::Point2d(xp, yp));
+        cv::Point2d track =  cv::Point2d(xp, yp) - this->kf->coord[idx]; //new point - old point
+        this->kf->tracks[idx] = Eigen::Vector2d(track.x, track.y);//flow in tracks
+        this->squared_norm_flow += this->kf->tracks[idx].squaredNorm();
+        indices.push_back(idx);
+    }
+
+    /** Delete the points out of the frame at once, O(n) instead of one
+     * erase per point (a cache of other points is rebuilt by the next solve) **/
+    const size_t num_removed_points = num_points - indices.size();
+    if (num_removed_points > 0)
+    {
+        if (this->cache.size() == num_points)
+            this->cache.select(indices);
         else
-        {
-            coord.push_back(cv::Point2d(xp, yp));
-            cv::Point2d track =  cv::Point2d(xp, yp) - this->kf->coord[idx]; //new point - old point
-            this->kf->tracks[idx] = Eigen::Vector2d(track.x, track.y);//flow in tracks
-            this->squared_norm_flow += this->kf->tracks[idx].squaredNorm();
-            ++it_c; ++it_i; //next_elements
-            idx++;
-        }
+            this->cache.clear();
+        this->kf->selectPoints(indices);
     }
 
     /** Mean of the squared norm flow **/
-    this->squared_norm_flow /= idx;
+    this->squared_norm_flow /= indices.size();
 
     std::cout<<"[TRACKER] GET_COORD REMOVED "<<num_removed_points<<" POINTS"<<std::endl;
 
@@ -417,7 +910,7 @@ void Tracker::trackPoints(const cv::Mat &event_frame, const uint16_t &patch_radi
         bool oulier = false; //f.norm() > 1.0; 
         if (oulier)
         {
-            this->kf->erasePoint(idx);
+            this->erasePoint(idx);
             it_c = coord.erase(coord.begin()+idx);
             it_patch_x = grad_patches_x.erase(grad_patches_x.begin()+idx);
             it_patch_y = grad_patches_y.erase(grad_patches_y.begin()+idx);
@@ -535,7 +1028,7 @@ std::vector<cv::Point2d> Tracker::trackPointsAlongEpiline(const cv::Mat &event_f
 
         if (std::fabs(cv::norm(p_ssd)-cv::norm(p_ncc)) > 5.0)
         {
-            this->kf->erasePoint(idx);
+            this->erasePoint(idx);
             num_removed_points++;
             it_p = model_patches.erase(model_patches.begin()+idx);
             //it_tr = tracker_coord.erase(tracker_coord.begin()+idx);
@@ -652,3 +1145,21 @@ bool Tracker::needNewKeyframe(const double &weight_factor)
     double image_weight = (this->kf->img.cols + this->kf->img.rows) * weight_factor;
     return (image_weight * sqrtf(this->squared_norm_flow) / (this->kf->img.cols + this->kf->img.rows)) > 1;
 }
+
+/** Event frames in double and in single precision (config scalar) **/
+template void Tracker::optimize<double>(const int &id, const std::vector<double> *event_frame, ::base::Transform3d &T_kf_ef,
+                        const Eigen::Vector3d &px, const Eigen::Quaterniond &qx, const eds::tracking::LOSS_PARAM_METHOD loss_param_method);
+template void Tracker::optimize<float>(const int &id, const std::vector<float> *event_frame, ::base::Transform3d &T_kf_ef,
+                        const Eigen::Vector3d &px, const Eigen::Quaterniond &qx, const eds::tracking::LOSS_PARAM_METHOD loss_param_method);
+template void Tracker::optimize<double>(const int &id, const std::vector<double> *event_frame, ::base::Transform3d &T_kf_ef,
+                        const Eigen::Matrix<double, 6, 1> &vx, const eds::tracking::LOSS_PARAM_METHOD loss_param_method);
+template void Tracker::optimize<float>(const int &id, const std::vector<float> *event_frame, ::base::Transform3d &T_kf_ef,
+                        const Eigen::Matrix<double, 6, 1> &vx, const eds::tracking::LOSS_PARAM_METHOD loss_param_method);
+template bool Tracker::optimize<double>(const int &id, const std::vector<double> *event_frame, ::base::Transform3d &T_kf_ef,
+                        const eds::tracking::LOSS_PARAM_METHOD loss_param_method);
+template bool Tracker::optimize<float>(const int &id, const std::vector<float> *event_frame, ::base::Transform3d &T_kf_ef,
+                        const eds::tracking::LOSS_PARAM_METHOD loss_param_method);
+template bool Tracker::optimize<double>(const int &id, const std::vector<double> *event_frame, const cv::Size &frame_size,
+                        const double &scale, ::base::Transform3d &T_kf_ef, const eds::tracking::LOSS_PARAM_METHOD loss_param_method);
+template bool Tracker::optimize<float>(const int &id, const std::vector<float> *event_frame, const cv::Size &frame_size,
+                        const double &scale, ::base::Transform3d &T_kf_ef, const eds::tracking::LOSS_PARAM_METHOD loss_param_method);
@@ -25,6 +25,9 @@
 #include <eds/tracking/Config.hpp>
 #include <eds/tracking/KeyFrame.hpp>
 #include <eds/tracking/EventFrame.hpp>
+#include <eds/tracking/TrackingCache.hpp>
+#include <eds/utils/NumType.h>
+#include <eds/utils/IndexThreadReduce.h>
 #include <memory>
 #include <vector>
 #include <chrono>
@@ -57,6 +60,63 @@ class Tracker
         /** Squared Norm Mean Flow **/
         double squared_norm_flow;
 
+        /** Keyframe data of the residuals (built once per keyframe) **/
+        eds::tracking::TrackingCache cache;
+
+        /** Residuals and Jacobians of optimizeGaussNewton (1 + 3 + 4 + 6 doubles
+         * per point), kept between the solves **/
+        std::vector<double> gn_residuals, gn_jac_p, gn_jac_q, gn_jac_v;
+
+        /** Thread pool of the global residual block (global_norm) **/
+        std::shared_ptr< ::dso::IndexThreadReduce<double> > thread_reduce;
+
+        /** Motion model: pose and time of the last solved event frame and
+         * the motion between the last two event frames **/
+        eds::SE3 last_pose, motion;
+        base::Time last_time, frame_time;
+        double motion_dt;
+
+        /** IMU rotation prior of the event frame (sqrt information weighted with prior_weight) **/
+        bool has_imu_prior;
+        Eigen::Quaterniond q_prior;
+        Eigen::Matrix3d prior_sqrt_information;
+
+        /** Pose update, iterations (-1: no solution) and convergence of the last solved level **/
+        double level_update;
+        int level_iterations;
+        bool level_converged;
+
+        /** @brief Motion model anchor at the keyframe (reset) **/
+        void resetMotion();
+
+        /** @brief Maximum iterations of the level (adaptive_iterations) **/
+        int levelIterations(const int &id);
+
+        /** @brief Level statistics after a solve **/
+        void endLevel(const int &id, const eds::SE3 &level_start, const int &num_iterations, const bool &converged);
+
+        /** Points re-ranked with the first solve of the keyframe **/
+        bool reranked;
+
+        /** @brief Information based selection of the keyframe points (point_selection) **/
+        void initialSelection();
+
+        /** @brief Selection with the robust weights of the first solve **/
+        void rerankPoints();
+
+        /** @brief Keep the budget points (spatial buckets) in the keyframe and in the cache **/
+        void selectPoints(const std::vector<double> &scores, const size_t &budget);
+
+        /** @brief Delete the point in the keyframe and in the cache **/
+        eds::tracking::KFPointIterators erasePoint(const int &idx);
+
+        /** @brief Levenberg-Marquardt on the 12 local parameters with fixed
+         * size normal equations (tracker type gauss_newton) **/
+        template <typename Scalar>
+        bool optimizeGaussNewton(const int &id, const std::vector<Scalar> *event_frame, const cv::Size &frame_size,
+                    const double &scale, ::base::Transform3d &T_kf_ef,
+                    const eds::tracking::LOSS_PARAM_METHOD loss_param_method);
+
     public:
         /** @brief Default constructor */
         Tracker(std::shared_ptr<eds::tracking::KeyFrame> kf, const eds::tracking::Config &config);
@@ -70,14 +130,45 @@ class Tracker
 
         void set(const base::Transform3d &T_kf_ef);
 
-        void optimize(const int &id, const std::vector<double> *event_frame, ::base::Transform3d &T_kf_ef,
+        /** @brief Start the pyramid of the event frame at time: constant
+         * velocity prediction of the pose (warm_start) and level statistics **/
+        void predict(const ::base::Time &time);
+
+        /** @brief Initial guess with the IMU after predict: rotation of the
+         * camera at this event frame in the camera at the last solved one
+         * (R_ci_cj), mean angular velocity [rad/s] (camera frame) and the
+         * rotation covariance. The rotation prior residual is added with
+         * imu.prior_weight > 0 **/
+        void imuPrior(const Eigen::Quaterniond &delta_q, const Eigen::Vector3d &angular_velocity,
+                    const Eigen::Matrix3d &covariance);
+
+        /** @brief True when the level id converged with an update below
+         * the skip_threshold, the finer levels count as skipped **/
+        bool skipFinerLevels(const int &id);
+
+        /** @brief Rebuild the tracking cache. Call it when the keyframe
+         * depths change (reset and point deletion already do it) **/
+        void updateCache();
+
+        template <typename Scalar>
+        void optimize(const int &id, const std::vector<Scalar> *event_frame, ::base::Transform3d &T_kf_ef,
                     const Eigen::Vector3d &px, const Eigen::Quaterniond &qx, 
                     const eds::tracking::LOSS_PARAM_METHOD loss_param_method);
 
-        void optimize(const int &id, const std::vector<double> *event_frame, ::base::Transform3d &T_kf_ef,
+        template <typename Scalar>
+        void optimize(const int &id, const std::vector<Scalar> *event_frame, ::base::Transform3d &T_kf_ef,
                     const Eigen::Matrix<double, 6, 1> &vx, const eds::tracking::LOSS_PARAM_METHOD loss_param_method);
 
-        bool optimize(const int &id, const std::vector<double> *event_frame, ::base::Transform3d &T_kf_ef,
+        template <typename Scalar>
+        bool optimize(const int &id, const std::vector<Scalar> *event_frame, ::base::Transform3d &T_kf_ef,
+                    const eds::tracking::LOSS_PARAM_METHOD loss_param_method = eds::tracking::LOSS_PARAM_METHOD::MAD);
+
+        /** @brief Optimize with a pyramid level of frame_size pixels. The
+         * keyframe intrinsics are scaled by scale (cv::pyrDown levels).
+         * The event frame is double or float (config scalar) **/
+        template <typename Scalar>
+        bool optimize(const int &id, const std::vector<Scalar> *event_frame, const cv::Size &frame_size,
+                    const double &scale, ::base::Transform3d &T_kf_ef,
                     const eds::tracking::LOSS_PARAM_METHOD loss_param_method = eds::tracking::LOSS_PARAM_METHOD::MAD);
 
         ::base::Transform3d getTransform();
@@ -0,0 +1,125 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EDS_TRACKING_CACHE_HPP_
+#define _EDS_TRACKING_CACHE_HPP_
+
+#include <opencv2/core/core.hpp>
+
+#include <array>
+#include <vector>
+#include <limits>
+#include <cassert>
+#include <algorithm>
+
+namespace eds { namespace tracking {
+
+    /** Keyframe data of the tracking residuals that does not change between
+     * event frames. One array per component (SoA), single precision storage
+     * and double precision arithmetic in the cost functions.
+     *
+     * model_i = -grad_i^T * flow_i(v) = sum_k coeff[k][i] * v[k] **/
+    struct TrackingCache
+    {
+        static constexpr double eps = 1e-05;
+
+        /** 3D points in the keyframe **/
+        std::vector<float> x, y, z;
+        /** Image gradient times the flow basis (per velocity component) **/
+        std::array<std::vector<float>, 6> coeff;
+        /** Point weights **/
+        std::vector<float> weights;
+
+        /** @brief Build from the keyframe points [start, start + num) **/
+        void build(const std::vector<cv::Point2d> &grad, const std::vector<cv::Point2d> &norm_coord,
+                const std::vector<double> &idp, const std::vector<double> &point_weights,
+                const size_t &start = 0, size_t num = std::numeric_limits<size_t>::max())
+        {
+            assert(grad.size() == norm_coord.size());
+            assert(norm_coord.size() == idp.size());
+            assert(idp.size() == point_weights.size());
+            num = std::min(num, norm_coord.size() - start);
+
+            this->resize(num);
+            for (size_t i=0; i<num; ++i)
+            {
+                const size_t idx = start + i;
+                const double px = norm_coord[idx].x, py = norm_coord[idx].y;
+                const double id = idp[idx];
+                const double gx = grad[idx].x, gy = grad[idx].y;
+
+                const double pz = 1.0/(id+eps);
+                this->x[i] = px*pz; this->y[i] = py*pz; this->z[i] = pz;
+
+                this->coeff[0][i] = gx*id;
+                this->coeff[1][i] = gy*id;
+                this->coeff[2][i] = -(gx*px*id + gy*py*id);
+                this->coeff[3][i] = -(gx*px*py + gy*(1.0+py*py));
+                this->coeff[4][i] = gx*(1.0+px*px) + gy*px*py;
+                this->coeff[5][i] = -(gx*py - gy*px);
+                this->weights[i] = point_weights[idx];
+            }
+        }
+
+        /** @brief Delete the point idx (as KeyFrame::erasePoint) **/
+        void erase(const size_t &idx)
+        {
+            this->x.erase(this->x.begin()+idx);
+            this->y.erase(this->y.begin()+idx);
+            this->z.erase(this->z.begin()+idx);
+            for (auto &c : this->coeff)
+                c.erase(c.begin()+idx);
+            this->weights.erase(this->weights.begin()+idx);
+        }
+
+        /** @brief Keep the points of the indices (ascending) **/
+        void select(const std::vector<int> &indices)
+        {
+            auto keep = [&indices](std::vector<float> &v)
+            {
+                for (size_t k=0; k<indices.size(); ++k)
+                    v[k] = v[indices[k]];
+                v.resize(indices.size());
+            };
+            keep(this->x); keep(this->y); keep(this->z);
+            for (auto &c : this->coeff)
+                keep(c);
+            keep(this->weights);
+        }
+
+        void resize(const size_t &num)
+        {
+            this->x.resize(num); this->y.resize(num); this->z.resize(num);
+            for (auto &c : this->coeff)
+                c.resize(num);
+            this->weights.resize(num);
+        }
+
+        void clear() { this->resize(0); }
+
+        size_t size() const { return this->x.size(); }
+
+        bool empty() const { return this->x.empty(); }
+    };
+
+} // tracking namespace
+} // end namespace
+
+#endif // _EDS_TRACKING_CACHE_HPP_
@@ -0,0 +1,295 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EDS_UTILS_ACCUMULATE_HPP_
+#define _EDS_UTILS_ACCUMULATE_HPP_
+
+#include <eds/utils/NumType.h>
+#include <eds/utils/IndexThreadReduce.h>
+#include <opencv2/core/core.hpp>
+#include <boost/thread.hpp>
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+namespace eds { namespace utils {
+
+    /** Vote of a point in the image
+     * NEAREST: all the value in the closest pixel (clipped to the image border)
+     * BILINEAR: value split in the four neighbour pixels (pixels out of the image get no vote) **/
+    enum ACCUMULATE_METHOD{NEAREST, BILINEAR};
+
+    inline ::eds::utils::ACCUMULATE_METHOD selectAccumulateMethod(const std::string &method_name)
+    {
+        if (method_name.compare("bilinear") == 0)
+            return eds::utils::BILINEAR;
+        else
+            return eds::utils::NEAREST;
+    };
+
+    /** Images bigger than this are accumulated by bands of rows [bytes].
+     * The band sort is an extra pass over the points, it only pays off
+     * when the image does not fit in the last level cache **/
+    static constexpr size_t ACCUMULATE_BLOCK_BYTES = 16 * 1024 * 1024;
+    /** Size of one band of rows (fits in L1/L2) [bytes] **/
+    static constexpr size_t ACCUMULATE_BAND_BYTES = 32 * 1024;
+    /** Minimum number of points per thread in the multi-threaded path **/
+    static constexpr size_t ACCUMULATE_MIN_POINTS_THREAD = 4096;
+
+    /** Scratch memory of the accumulation kept between calls **/
+    template <typename T>
+    struct AccumulateBuffers
+    {
+        /** Point indices sorted by band of rows **/
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> band_start;
+        /** Per thread images (thread 0 writes in the output image) **/
+        std::vector< std::vector<T> > tiles;
+        /** Persistent workers of the multi-threaded path (created once) **/
+        std::shared_ptr< ::dso::IndexThreadReduce<double> > pool;
+        int pool_threads = 0;
+    };
+
+    inline double pointCoordX(const cv::Point2d &p){return p.x;}
+    inline double pointCoordY(const cv::Point2d &p){return p.y;}
+    /** Points with operator[] (eds::mapping::Point2d, Eigen vectors) **/
+    template <typename P> inline double pointCoordX(const P &p){return p[0];}
+    template <typename P> inline double pointCoordY(const P &p){return p[1];}
+
+    /** Gaussian weight of the idx point in the window (same as expWeight(idx/window_size, 1.0)) **/
+    template <bool EXP_WEIGHTS>
+    inline double accumulateWeight(const size_t &idx, const size_t &window_size)
+    {
+        if (!EXP_WEIGHTS)
+            return 1.0;
+        const double value = (static_cast<double>(idx)/window_size - 0.5) * 6.0;
+        return std::exp(-0.5*value*value);
+    };
+
+    template <ACCUMULATE_METHOD METHOD, typename T>
+    inline void accumulatePoint(T *img, const size_t &step, const int &height, const int &width,
+                            const double &x, const double &y, const double &weight, const double &value)
+    {
+        if (METHOD == NEAREST)
+        {
+            const int xi = std::max(0, std::min(cvRound(x), width - 1));
+            const int yi = std::max(0, std::min(cvRound(y), height - 1));
+            img[yi * step + xi] += weight * value;
+        }
+        else
+        {
+            const int x0 = cvFloor(x), y0 = cvFloor(y);
+            const int x1 = x0 + 1, y1 = y0 + 1;
+            const double wa = (x1 - x) * (y1 - y), wb = (x1 - x) * (y - y0);
+            const double wc = (x - x0) * (y1 - y), wd = (x - x0) * (y - y0);
+
+            /** Interior points: one bound check for the four pixels **/
+            if (x0 >= 0 && y0 >= 0 && x1 < width && y1 < height)
+            {
+                T *row0 = img + y0 * step + x0, *row1 = row0 + step;
+                row0[0] += weight * wa * value;
+                row1[0] += weight * wb * value;
+                row0[1] += weight * wc * value;
+                row1[1] += weight * wd * value;
+            }
+            else
+            {
+                const bool in_x0 = (x0 >= 0) && (x0 < width), in_x1 = (x1 >= 0) && (x1 < width);
+                const bool in_y0 = (y0 >= 0) && (y0 < height), in_y1 = (y1 >= 0) && (y1 < height);
+                if (in_x0 && in_y0) img[y0 * step + x0] += weight * wa * value;
+                if (in_x0 && in_y1) img[y1 * step + x0] += weight * wb * value;
+                if (in_x1 && in_y0) img[y0 * step + x1] += weight * wc * value;
+                if (in_x1 && in_y1) img[y1 * step + x1] += weight * wd * value;
+            }
+        }
+    };
+
+    /** Accumulate the points [begin, end) in the order of the input **/
+    template <ACCUMULATE_METHOD METHOD, bool EXP_WEIGHTS, typename T, typename P, typename V>
+    inline void accumulateRange(const P *points, const V *values, const size_t &begin, const size_t &end,
+                            const size_t &window_size, T *img, const size_t &step, const int &height, const int &width)
+    {
+        for (size_t i=begin; i<end; ++i)
+        {
+            accumulatePoint<METHOD>(img, step, height, width, pointCoordX(points[i]), pointCoordY(points[i]),
+                                accumulateWeight<EXP_WEIGHTS>(i, window_size), values[i]);
+        }
+    };
+
+    /** Accumulate band by band of rows. The points are sorted by band with
+     * a counting sort so the writes of one band stay in cache **/
+    template <ACCUMULATE_METHOD METHOD, bool EXP_WEIGHTS, typename T, typename P, typename V>
+    inline void accumulateBlocked(const P *points, const V *values, const size_t &n,
+                            T *img, const size_t &step, const int &height, const int &width,
+                            AccumulateBuffers<T> &buffers)
+    {
+        const int band_rows = std::max(1, static_cast<int>(ACCUMULATE_BAND_BYTES / (step * sizeof(T))));
+        const int num_bands = (height + band_rows - 1) / band_rows;
+        auto band = [&](const size_t &i)
+        {
+            const double y = pointCoordY(points[i]);
+            const int row = (y > 0.0)? std::min(cvFloor(y), height - 1) : 0;
+            return row / band_rows;
+        };
+
+        std::vector<uint32_t> &start = buffers.band_start;
+        start.assign(num_bands + 1, 0);
+        for (size_t i=0; i<n; ++i)
+            start[band(i) + 1]++;
+        for (int b=0; b<num_bands; ++b)
+            start[b + 1] += start[b];
+
+        buffers.order.resize(n);
+        uint32_t *order = buffers.order.data();
+        for (size_t i=0; i<n; ++i)
+            order[start[band(i)]++] = i;
+
+        for (size_t k=0; k<n; ++k)
+        {
+            const size_t i = order[k];
+            accumulatePoint<METHOD>(img, step, height, width, pointCoordX(points[i]), pointCoordY(points[i]),
+                                accumulateWeight<EXP_WEIGHTS>(i, n), values[i]);
+        }
+    };
+
+    /** Every thread accumulates a chunk of points in its own tile. The
+     * tiles are reduced in the output image afterwards (also by threads).
+     * Both phases run on the persistent workers of the buffers **/
+    template <ACCUMULATE_METHOD METHOD, bool EXP_WEIGHTS, typename T, typename P, typename V>
+    inline void accumulateParallel(const P *points, const V *values, const size_t &n,
+                            T *img, const size_t &step, const int &height, const int &width,
+                            AccumulateBuffers<T> &buffers, const int &num_threads)
+    {
+        if (!buffers.pool || buffers.pool_threads != num_threads)
+        {
+            buffers.pool = std::make_shared< ::dso::IndexThreadReduce<double> >(num_threads);
+            buffers.pool_threads = num_threads;
+        }
+
+        const size_t chunk = (n + num_threads - 1) / num_threads;
+        const size_t tile_size = static_cast<size_t>(height) * width;
+        buffers.tiles.resize(num_threads - 1);
+        buffers.pool->reduce([&](int first, int last, double*, int)
+        {
+            for (int t=first; t<last; ++t)
+            {
+                const size_t begin = std::min(n, t * chunk), end = std::min(n, (t + 1) * chunk);
+                if (t == 0)
+                {
+                    accumulateRange<METHOD, EXP_WEIGHTS>(points, values, begin, end, n, img, step, height, width);
+                    continue;
+                }
+                std::vector<T> &tile = buffers.tiles[t-1];
+                tile.assign(tile_size, T(0));
+                accumulateRange<METHOD, EXP_WEIGHTS>(points, values, begin, end, n, tile.data(), width, height, width);
+            }
+        }, 0, num_threads, 1);
+
+        /** Reduce the tiles by bands of rows **/
+        const int rows = (height + num_threads - 1) / num_threads;
+        buffers.pool->reduce([&](int first, int last, double*, int)
+        {
+            for (int t=first; t<last; ++t)
+            {
+                const int row_begin = std::min(height, t * rows), row_end = std::min(height, (t + 1) * rows);
+                for (const std::vector<T> &tile : buffers.tiles)
+                {
+                    for (int row=row_begin; row<row_end; ++row)
+                    {
+                        T *dst = img + row * step;
+                        const T *src = tile.data() + row * width;
+                        for (int col=0; col<width; ++col)
+                            dst[col] += src[col];
+                    }
+                }
+            }
+        }, 0, num_threads, 1);
+    };
+
+    template <ACCUMULATE_METHOD METHOD, bool EXP_WEIGHTS, typename T, typename P, typename V>
+    inline void accumulateKernel(const P *points, const V *values, const size_t &n,
+                            T *img, const size_t &step, const int &height, const int &width,
+                            AccumulateBuffers<T> *buffers, const int &num_threads)
+    {
+        if (buffers && num_threads > 1 && n >= num_threads * ACCUMULATE_MIN_POINTS_THREAD)
+            accumulateParallel<METHOD, EXP_WEIGHTS>(points, values, n, img, step, height, width, *buffers, num_threads);
+        else if (buffers && height * step * sizeof(T) > ACCUMULATE_BLOCK_BYTES)
+            accumulateBlocked<METHOD, EXP_WEIGHTS>(points, values, n, img, step, height, width, *buffers);
+        else
+            accumulateRange<METHOD, EXP_WEIGHTS>(points, values, 0, n, n, img, step, height, width);
+    };
+
+    /** @brief Accumulate n values at the points coordinates in img (height x width
+     * with step elements per row). The image is set to zero first. The method
+     * and the weights are resolved once, outside of the loop. With buffers the
+     * big images are accumulated by bands of rows and with num_threads > 1 in
+     * per thread tiles (the summation order, and thus the rounding, changes) **/
+    template <typename T, typename P, typename V>
+    void accumulatePoints(const P *points, const V *values, const size_t &n,
+                        const int &height, const int &width, const ACCUMULATE_METHOD &method,
+                        const bool &use_exp_weights, T *img, const size_t &step,
+                        AccumulateBuffers<T> *buffers = nullptr, const int &num_threads = 1)
+    {
+        for (int row=0; row<height; ++row)
+            std::fill(img + row * step, img + row * step + width, T(0));
+
+        if (method == BILINEAR)
+        {
+            if (use_exp_weights)
+                accumulateKernel<BILINEAR, true>(points, values, n, img, step, height, width, buffers, num_threads);
+            else
+                accumulateKernel<BILINEAR, false>(points, values, n, img, step, height, width, buffers, num_threads);
+        }
+        else
+        {
+            if (use_exp_weights)
+                accumulateKernel<NEAREST, true>(points, values, n, img, step, height, width, buffers, num_threads);
+            else
+                accumulateKernel<NEAREST, false>(points, values, n, img, step, height, width, buffers, num_threads);
+        }
+    };
+
+    /** @brief Add (scale = 1) or remove (scale = -1) the contribution of n
+     * points to an already accumulated image (no exp weights, img is not cleared) **/
+    template <typename T, typename P, typename V>
+    void addPoints(const P *points, const V *values, const size_t &n,
+                const int &height, const int &width, const ACCUMULATE_METHOD &method,
+                T *img, const size_t &step, const double &scale = 1.0)
+    {
+        if (method == BILINEAR)
+        {
+            for (size_t i=0; i<n; ++i)
+                accumulatePoint<BILINEAR>(img, step, height, width, pointCoordX(points[i]), pointCoordY(points[i]), scale, values[i]);
+        }
+        else
+        {
+            for (size_t i=0; i<n; ++i)
+                accumulatePoint<NEAREST>(img, step, height, width, pointCoordX(points[i]), pointCoordY(points[i]), scale, values[i]);
+        }
+    };
+
+} // utils namespace
+} // end namespace
+
+#endif // _EDS_UTILS_ACCUMULATE_HPP_
@@ -0,0 +1,173 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EDS_UTILS_BOUNDED_QUEUE_HPP_
+#define _EDS_UTILS_BOUNDED_QUEUE_HPP_
+
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace eds { namespace utils {
+
+    /** What to do when pushing in a full queue
+     * BLOCK: wait until the consumer makes room
+     * DROP_OLDEST: discard the oldest element
+     * MERGE: merge the element into the newest one (DROP_OLDEST without merge function) **/
+    enum QUEUE_POLICY{BLOCK, DROP_OLDEST, MERGE};
+
+    inline ::eds::utils::QUEUE_POLICY selectQueuePolicy(const std::string &policy_name)
+    {
+        if (policy_name.compare("DROP_OLDEST") == 0)
+            return eds::utils::DROP_OLDEST;
+        else if (policy_name.compare("MERGE") == 0)
+            return eds::utils::MERGE;
+        else
+            return eds::utils::BLOCK;
+    };
+
+    struct QueueStats
+    {
+        size_t depth; // current number of elements
+        size_t max_depth;
+        size_t pushed;
+        size_t popped;
+        size_t dropped;
+        size_t merged;
+    };
+
+    /** Fixed capacity FIFO between one producer and one consumer.
+     * The slots are allocated once, push and pop only move elements in
+     * and out of them under a short lock **/
+    template <typename T>
+    class BoundedQueue
+    {
+        private:
+            std::vector<T> buffer;
+            size_t head, count;
+            QUEUE_POLICY policy;
+            boost::function<void(T&, T&)> merge;
+            bool closed;
+            QueueStats stats;
+            mutable boost::mutex mutex;
+            boost::condition_variable not_full;
+
+        public:
+            /** @brief Constructor. merge(newest, element) merges element into the newest one **/
+            BoundedQueue(const size_t &capacity, const QUEUE_POLICY &policy = BLOCK,
+                    boost::function<void(T&, T&)> merge = boost::function<void(T&, T&)>())
+            :buffer(std::max(capacity, (size_t)1)), head(0), count(0), policy(policy), merge(merge), closed(false)
+            {
+                this->stats = QueueStats{0, 0, 0, 0, 0, 0};
+            }
+
+            /** @brief Insert at the tail. Returns false when the queue is closed **/
+            bool push(T &&item)
+            {
+                boost::unique_lock<boost::mutex> lock(this->mutex);
+                const size_t capacity = this->buffer.size();
+                if (this->count == capacity && !this->closed)
+                {
+                    if (this->policy == MERGE && this->merge)
+                    {
+                        this->merge(this->buffer[(this->head + this->count - 1) % capacity], item);
+                        this->stats.merged++; this->stats.pushed++;
+                        return true;
+                    }
+                    else if (this->policy == BLOCK)
+                    {
+                        while (this->count == capacity && !this->closed)
+                            this->not_full.wait(lock);
+                    }
+                    else
+                    {
+                        this->head = (this->head + 1) % capacity;
+                        this->count--;
+                        this->stats.dropped++;
+                    }
+                }
+                if (this->closed)
+                    return false;
+
+                this->buffer[(this->head + this->count) % capacity] = std::move(item);
+                this->count++;
+                this->stats.pushed++;
+                this->stats.max_depth = std::max(this->stats.max_depth, this->count);
+                return true;
+            }
+
+            /** @brief Take the oldest element. Returns false when empty (it does not wait) **/
+            bool pop(T &item)
+            {
+                {
+                    boost::lock_guard<boost::mutex> lock(this->mutex);
+                    if (this->count == 0)
+                        return false;
+                    item = std::move(this->buffer[this->head]);
+                    this->head = (this->head + 1) % this->buffer.size();
+                    this->count--;
+                    this->stats.popped++;
+                }
+                this->not_full.notify_one();
+                return true;
+            }
+
+            /** @brief Call f(oldest element) when not empty **/
+            template<typename F> bool front(F f) const
+            {
+                boost::lock_guard<boost::mutex> lock(this->mutex);
+                if (this->count == 0)
+                    return false;
+                f(this->buffer[this->head]);
+                return true;
+            }
+
+            /** @brief Wake up a blocked producer and refuse new elements **/
+            void close()
+            {
+                {
+                    boost::lock_guard<boost::mutex> lock(this->mutex);
+                    this->closed = true;
+                }
+                this->not_full.notify_all();
+            }
+
+            bool empty() const
+            {
+                boost::lock_guard<boost::mutex> lock(this->mutex);
+                return this->count == 0;
+            }
+
+            QueueStats getStats() const
+            {
+                boost::lock_guard<boost::mutex> lock(this->mutex);
+                QueueStats s = this->stats;
+                s.depth = this->count;
+                return s;
+            }
+    };
+
+} // utils namespace
+} // end namespace
+
+#endif // _EDS_UTILS_BOUNDED_QUEUE_HPP_
@@ -31,6 +31,7 @@
 #include "boost/thread.hpp"
 #include <stdio.h>
 #include <iostream>
+#include <algorithm>
 
 
 
@@ -44,15 +45,17 @@ class IndexThreadReduce
 public:
         EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
 
-	inline IndexThreadReduce()
+	// nThreads workers (at most NUM_THREADS, the size of the per-thread storage)
+	inline IndexThreadReduce(int nThreads = NUM_THREADS)
 	{
+		numThreads = std::max(1, std::min(nThreads, NUM_THREADS));
 		nextIndex = 0;
 		maxIndex = 0;
 		stepSize = 1;
 		callPerIndex = boost::bind(&IndexThreadReduce::callPerIndexDefault, this, _1, _2, _3, _4);
 
 		running = true;
-		for(int i=0;i<NUM_THREADS;i++)
+		for(int i=0;i<numThreads;i++)
 		{
 			isDone[i] = false;
 			gotOne[i] = true;
@@ -68,7 +71,7 @@ public:
 		todo_signal.notify_all();
 		exMutex.unlock();
 
-		for(int i=0;i<NUM_THREADS;i++)
+		for(int i=0;i<numThreads;i++)
 			workerThreads[i].join();
 
 
@@ -84,7 +87,7 @@ public:
 
 
 		if(stepSize == 0)
-			stepSize = ((end-first)+NUM_THREADS-1)/NUM_THREADS;
+			stepSize = ((end-first)+numThreads-1)/numThreads;
 
 
 
@@ -97,7 +100,7 @@ public:
 		this->stepSize = stepSize;
 
 		// go worker threads!
-		for(int i=0;i<NUM_THREADS;i++)
+		for(int i=0;i<numThreads;i++)
 		{
 			isDone[i] = false;
 			gotOne[i] = false;
@@ -117,7 +120,7 @@ public:
 
 			// check if actually all are finished.
 			bool allDone = true;
-			for(int i=0;i<NUM_THREADS;i++)
+			for(int i=0;i<numThreads;i++)
 				allDone = allDone && isDone[i];
 
 			// all are finished! exit.
@@ -148,6 +151,7 @@ private:
 	int stepSize;
 
 	bool running;
+	int numThreads;
 
 	boost::function<void(int,int,Running*,int)> callPerIndex;
 
@@ -0,0 +1,131 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EDS_UTILS_INTERPOLATE_HPP_
+#define _EDS_UTILS_INTERPOLATE_HPP_
+
+#include <string>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+namespace eds { namespace utils {
+
+    /** Interpolation of the event frame in the tracker
+     * CERES_BICUBIC: ceres::BiCubicInterpolator (reference)
+     * FAST_BICUBIC: BicubicSampler, same Catmull-Rom spline **/
+    enum INTERPOLATOR_TYPE{CERES_BICUBIC, FAST_BICUBIC};
+
+    inline ::eds::utils::INTERPOLATOR_TYPE selectInterpolator(const std::string &interpolator_name)
+    {
+        if (interpolator_name.compare("fast_bicubic") == 0)
+            return eds::utils::FAST_BICUBIC;
+        else
+            return eds::utils::CERES_BICUBIC;
+    };
+
+    /** Catmull-Rom weights of the four samples p[-1], p[0], p[1], p[2] and
+     * their derivatives at x in [0, 1) (the ceres CubicHermiteSpline) **/
+    inline void catmullRomWeights(const double &x, double *w, double *dw)
+    {
+        const double x2 = x*x, x3 = x2*x;
+        w[0] = 0.5*(-x + 2.0*x2 - x3);
+        w[1] = 0.5*(2.0 - 5.0*x2 + 3.0*x3);
+        w[2] = 0.5*(x + 4.0*x2 - 3.0*x3);
+        w[3] = 0.5*(-x2 + x3);
+        dw[0] = 0.5*(-1.0 + 4.0*x - 3.0*x2);
+        dw[1] = 0.5*(-10.0*x + 9.0*x2);
+        dw[2] = 0.5*(1.0 + 8.0*x - 9.0*x2);
+        dw[3] = 0.5*(-2.0*x + 3.0*x2);
+    };
+
+    /** Bicubic interpolation of a row-major single channel image with the
+     * same spline and border clamping as ceres::BiCubicInterpolator on a
+     * ceres::Grid2D. The 4x4 patch is weighted separately by columns and by
+     * rows (the weights are computed once per point), interior points read
+     * the rows directly without clamping **/
+    template <typename T>
+    class BicubicSampler
+    {
+        private:
+            const T *data;
+            int rows, cols;
+
+        public:
+            BicubicSampler(const T *data, const int &rows, const int &cols)
+            :data(data), rows(rows), cols(cols) {}
+
+            /** @brief Value and derivatives at (r, c) **/
+            inline void evaluate(const double &r, const double &c, double *f, double *dfdr, double *dfdc) const
+            {
+                const double r_floor = std::floor(r), c_floor = std::floor(c);
+                const int row = static_cast<int>(r_floor), col = static_cast<int>(c_floor);
+
+                double wr[4], dwr[4], wc[4], dwc[4];
+                catmullRomWeights(r - r_floor, wr, dwr);
+                catmullRomWeights(c - c_floor, wc, dwc);
+
+                double value = 0.0, d_row = 0.0, d_col = 0.0;
+                if (row >= 1 && row + 2 < this->rows && col >= 1 && col + 2 < this->cols)
+                {
+                    const T *p = this->data + (row - 1) * this->cols + (col - 1);
+                    for (int k=0; k<4; ++k, p += this->cols)
+                    {
+                        const double v = wc[0]*p[0] + wc[1]*p[1] + wc[2]*p[2] + wc[3]*p[3];
+                        const double dv = dwc[0]*p[0] + dwc[1]*p[1] + dwc[2]*p[2] + dwc[3]*p[3];
+                        value += wr[k] * v; d_row += dwr[k] * v; d_col += wr[k] * dv;
+                    }
+                }
+                else
+                {
+                    int c_idx[4];
+                    for (int j=0; j<4; ++j)
+                        c_idx[j] = std::min(std::max(col - 1 + j, 0), this->cols - 1);
+                    for (int k=0; k<4; ++k)
+                    {
+                        const T *p = this->data + std::min(std::max(row - 1 + k, 0), this->rows - 1) * this->cols;
+                        const double v = wc[0]*p[c_idx[0]] + wc[1]*p[c_idx[1]] + wc[2]*p[c_idx[2]] + wc[3]*p[c_idx[3]];
+                        const double dv = dwc[0]*p[c_idx[0]] + dwc[1]*p[c_idx[1]] + dwc[2]*p[c_idx[2]] + dwc[3]*p[c_idx[3]];
+                        value += wr[k] * v; d_row += dwr[k] * v; d_col += wr[k] * dv;
+                    }
+                }
+
+                *f = value;
+                if (dfdr != nullptr) *dfdr = d_row;
+                if (dfdc != nullptr) *dfdc = d_col;
+            }
+
+            /** @brief Batch of n points. dfdr and dfdc can be nullptr **/
+            void evaluate(const size_t &n, const double *r, const double *c, double *f, double *dfdr, double *dfdc) const
+            {
+                double d_row, d_col;
+                for (size_t i=0; i<n; ++i)
+                {
+                    this->evaluate(r[i], c[i], &(f[i]), &d_row, &d_col);
+                    if (dfdr != nullptr) dfdr[i] = d_row;
+                    if (dfdc != nullptr) dfdc[i] = d_col;
+                }
+            }
+    };
+
+} // utils namespace
+} // end namespace
+
+#endif // _EDS_UTILS_INTERPOLATE_HPP_
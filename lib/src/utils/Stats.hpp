@@ -0,0 +1,236 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrió, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EDS_UTILS_STATS_HPP_
+#define _EDS_UTILS_STATS_HPP_
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <limits>
+#include <fstream>
+#include <ostream>
+#include <stdint.h>
+#include <algorithm>
+
+namespace eds { namespace utils {
+
+    /** Durations [us] of a stage over the last samples (window). The
+     * histogram has log2 bins: [0, 1), [1, 2), [2, 4) ... the last bin
+     * is open **/
+    struct StageStats
+    {
+        std::string name;
+        uint64_t count; // all the samples since the start
+        size_t window; // samples in the statistics
+        double total; // sum of all the samples
+        double last, mean, min, max;
+        double p50, p90, p99;
+        std::vector<uint32_t> histogram;
+    };
+
+    /** Last capacity samples in a ring buffer **/
+    class RollingHistogram
+    {
+        public:
+            static constexpr int NUM_BINS = 24;
+
+        private:
+            std::vector<double> samples;
+            size_t head;
+            uint64_t count;
+            double total, last;
+
+        public:
+            RollingHistogram(const size_t &capacity = 1024)
+            :samples(std::max(capacity, (size_t)1)), head(0), count(0), total(0.0), last(0.0) {}
+
+            void add(const double &value)
+            {
+                this->samples[this->head] = value;
+                this->head = (this->head + 1) % this->samples.size();
+                this->count++; this->total += value; this->last = value;
+            }
+
+            static int bin(const double &value)
+            {
+                if (!(value >= 1.0))
+                    return 0;
+                int exponent; std::frexp(value, &exponent);
+                return std::min(exponent, NUM_BINS - 1);
+            }
+
+            StageStats summary(const std::string &name) const
+            {
+                StageStats s;
+                s.name = name; s.count = this->count; s.total = this->total; s.last = this->last;
+                s.window = std::min(this->count, (uint64_t)this->samples.size());
+                s.histogram.assign(NUM_BINS, 0);
+                s.mean = s.min = s.max = s.p50 = s.p90 = s.p99 = 0.0;
+                if (s.window == 0)
+                    return s;
+
+                /** The window starts at the head once the buffer is full (order does not matter) **/
+                std::vector<double> values(this->samples.begin(), this->samples.begin() + s.window);
+                std::sort(values.begin(), values.end());
+                double sum = 0.0;
+                for (const double &v : values)
+                {
+                    sum += v;
+                    s.histogram[bin(v)]++;
+                }
+                s.mean = sum / s.window;
+                s.min = values.front(); s.max = values.back();
+                auto percentile = [&values](const double &p)
+                {
+                    return values[std::min(static_cast<size_t>(p * values.size()), values.size() - 1)];
+                };
+                s.p50 = percentile(0.50); s.p90 = percentile(0.90); s.p99 = percentile(0.99);
+                return s;
+            }
+    };
+
+    /** Rolling histograms per named stage (in order of the first sample).
+     * Safe to use from the input and the processing threads **/
+    class StageTimers
+    {
+        private:
+            size_t capacity;
+            std::vector<std::string> names;
+            std::vector<RollingHistogram> histograms;
+            mutable boost::mutex mutex;
+
+        public:
+            StageTimers(const size_t &capacity = 1024):capacity(capacity) {}
+
+            /** @brief Add a duration [us] to the stage **/
+            void add(const std::string &stage, const double &time_us)
+            {
+                boost::lock_guard<boost::mutex> lock(this->mutex);
+                auto it = std::find(this->names.begin(), this->names.end(), stage);
+                if (it == this->names.end())
+                {
+                    this->names.push_back(stage);
+                    this->histograms.push_back(RollingHistogram(this->capacity));
+                    this->histograms.back().add(time_us);
+                }
+                else
+                    this->histograms[it - this->names.begin()].add(time_us);
+            }
+
+            std::vector<StageStats> summary() const
+            {
+                boost::lock_guard<boost::mutex> lock(this->mutex);
+                std::vector<StageStats> stats;
+                for (size_t i=0; i<this->names.size(); ++i)
+                    stats.push_back(this->histograms[i].summary(this->names[i]));
+                return stats;
+            }
+
+            void clear()
+            {
+                boost::lock_guard<boost::mutex> lock(this->mutex);
+                this->names.clear(); this->histograms.clear();
+            }
+
+            /** @brief One row per stage, times in microseconds **/
+            static void writeCSV(std::ostream &out, const std::vector<StageStats> &stats)
+            {
+                out<<"stage,count,window,total_us,last_us,mean_us,min_us,max_us,p50_us,p90_us,p99_us";
+                for (int k=0; k<RollingHistogram::NUM_BINS; ++k)
+                    out<<",bin"<<k;
+                out<<"\n";
+                for (const StageStats &s : stats)
+                {
+                    out<<s.name<<","<<s.count<<","<<s.window<<","<<s.total<<","<<s.last<<","<<s.mean<<","
+                        <<s.min<<","<<s.max<<","<<s.p50<<","<<s.p90<<","<<s.p99;
+                    for (const uint32_t &h : s.histogram)
+                        out<<","<<h;
+                    out<<"\n";
+                }
+            }
+
+            static void writeJSON(std::ostream &out, const std::vector<StageStats> &stats)
+            {
+                out<<"{\n  \"unit\": \"us\",\n  \"stages\": [";
+                for (size_t i=0; i<stats.size(); ++i)
+                {
+                    const StageStats &s = stats[i];
+                    out<<((i>0)? ",\n" : "\n")<<"    {\"name\": \""<<s.name<<"\", \"count\": "<<s.count<<", \"window\": "<<s.window
+                        <<", \"total\": "<<s.total<<", \"last\": "<<s.last<<", \"mean\": "<<s.mean
+                        <<", \"min\": "<<s.min<<", \"max\": "<<s.max
+                        <<", \"p50\": "<<s.p50<<", \"p90\": "<<s.p90<<", \"p99\": "<<s.p99<<", \"histogram\": [";
+                    for (size_t k=0; k<s.histogram.size(); ++k)
+                        out<<((k>0)? ", " : "")<<s.histogram[k];
+                    out<<"]}";
+                }
+                out<<"\n  ]\n}\n";
+            }
+
+            /** @brief Write the summary: JSON for a .json file, CSV otherwise **/
+            bool write(const std::string &filename) const
+            {
+                std::ofstream out(filename);
+                if (!out.is_open())
+                    return false;
+                const std::vector<StageStats> stats = this->summary();
+                const std::string ext = ".json";
+                if (filename.size() >= ext.size() && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0)
+                    writeJSON(out, stats);
+                else
+                    writeCSV(out, stats);
+                return out.good();
+            }
+    };
+
+    /** Adds the time from the construction to stop() (or the destruction)
+     * to the stage. stage is not copied (string literals) **/
+    class ScopedTimer
+    {
+        private:
+            StageTimers *timers;
+            const char *stage;
+            std::chrono::high_resolution_clock::time_point start;
+
+        public:
+            ScopedTimer(StageTimers &timers, const char *stage)
+            :timers(&timers), stage(stage), start(std::chrono::high_resolution_clock::now()) {}
+
+            ~ScopedTimer() { this->stop(); }
+
+            /** @brief Record once and return the duration [us] **/
+            double stop()
+            {
+                const double time_us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - this->start).count();
+                if (this->timers != nullptr)
+                    this->timers->add(this->stage, time_us);
+                this->timers = nullptr;
+                return time_us;
+            }
+    };
+
+} // utils namespace
+} // end namespace
+
+#endif // _EDS_UTILS_STATS_HPP_
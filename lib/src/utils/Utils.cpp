@@ -47,81 +47,30 @@ std::string type2str(int type)
     return r;
 }
 
-cv::Mat drawValuesPoints(const std::vector<cv::Point2d> &points, const std::vector<int8_t> &values, const int height, const int width, const std::string &method, const float s, const bool &use_exp_weights)
+void blurValuesPoints(const cv::Mat &src, cv::Mat &dst, const float s)
 {
-    /** Asertion only in debug mode **/
-    assert(height > 0);
-    assert(width > 0);
-    assert(values.size() == points.size());
-    assert((method.compare("nn") == 0) || (method.compare("bilinear") == 0));
-
-    /** Mat image **/
-    cv::Mat img = cv::Mat(height, width, CV_64FC1, cv::Scalar(0));
-    cv::Size size = img.size();
-
-    auto clip = [](const int n, const int lower, const int upper)
-    {
-        return std::max(lower, std::min(n, upper));
-    };
-
-    double idx = 0; uint32_t window_size = values.size();
-    auto it_x = points.begin();
-    auto it_p = values.begin();
-    while(it_x != points.end() && it_p != values.end())
-    {
-        double weight = (use_exp_weights)? eds::utils::expWeight(static_cast<double>(idx/window_size), 1.0) : 1.0;
-        if (method.compare("nn") == 0)
-        {
-            cv::Point2i x_int = *it_x;
-            //std::cout<<*it_x<<std::endl;
-            x_int.x = clip(x_int.x, 0, size.width - 1);
-            x_int.y = clip(x_int.y, 0, size.height - 1);
-
-            img.at<double>(x_int) += weight * (*it_p);
-
-        }
-        else if (method.compare("bilinear") == 0)
-        {   
-            int x0 = floor(it_x->x);
-            int y0 = floor(it_x->y);
-            int x1 = x0 + 1;
-            int y1 = y0 + 1;
-            //std::cout<<"x0: "<< x0<<" y0: "<<y0<<" x1: "<< x1<<" y1: "<<y1 <<" pol: "<<std::to_string(*it_p)<<std::endl;
-            /** compute the voting weights. Note: assign weight 0 if the point is out of the image **/
-            double wa, wb, wc, wd;
-            wa = ((x0 < size.width) && (y0 < size.height) && (x0 >= 0) && (y0 >= 0))? (x1 - it_x->x) * (y1 - it_x->y) : 0.0;
-            wb = ((x0 < size.width) && (y1 < size.height) && (x0 >= 0) && (y1 >= 0))? (x1 - it_x->x) * (it_x->y - y0) : 0.0;
-            wc = ((x1 < size.width) && (y0 < size.height) && (x1 >= 0) && (y0 >= 0))? (it_x->x - x0) * (y1 - it_x->y) : 0.0;
-            wd = ((x1 < size.width) && (y1 < size.height) && (x1 >= 0) && (y1 >= 0))? (it_x->x - x0) * (it_x->y - y0) : 0.0;
-
-            x0 = clip(x0, 0, size.width - 1);
-            x1 = clip(x1, 0, size.width - 1);
-            y0 = clip(y0, 0, size.height - 1);
-            y1 = clip(y1, 0, size.height - 1);
-            //std::cout<<"wa: "<<wa<<" wb: "<<wb<<" wc: "<<wc<<" wd: "<<wd<<std::endl;
-
-            img.at<double>(y0, x0) += weight * wa * (*it_p);
-            img.at<double>(y1, x0) += weight * wb * (*it_p);
-            img.at<double>(y0, x1) += weight * wc * (*it_p);
-            img.at<double>(y1, x1) += weight * wd * (*it_p);
-        }
-        ++it_x;
-        ++it_p;
-        ++idx;
-    }
-
     if(s > 0)
     {
         /** Kernal size depending on image size **/
         int k_h = int((1.7 * 180)/100);
         int k_w = int((1.25 * 240)/100);
-        cv::GaussianBlur(img, img, cv::Size(k_w, k_h), s, s);
+        cv::GaussianBlur(src, dst, cv::Size(k_w, k_h), s, s);
     }
+    else if (dst.data != src.data)
+    {
+        src.copyTo(dst);
+    }
+}
 
+cv::Mat drawValuesPoints(const std::vector<cv::Point2d> &points, const std::vector<int8_t> &values, const int height, const int width, const std::string &method, const float s, const bool &use_exp_weights)
+{
+    cv::Mat img;
+    drawValuesPoints(points, values, height, width, method, s, use_exp_weights, img);
     return img;
 }
 
-cv::Mat drawValuesPoints(const std::vector<cv::Point2d> &points, const std::vector<double> &values, const int height, const int width, const std::string &method, const float s)
+void drawValuesPoints(const std::vector<cv::Point2d> &points, const std::vector<int8_t> &values, const int height, const int width, const std::string &method, const float s, const bool &use_exp_weights, cv::Mat &img,
+                    ::eds::utils::AccumulateBuffers<double> *buffers, const int &num_threads)
 {
     /** Asertion only in debug mode **/
     assert(height > 0);
@@ -129,65 +78,29 @@ cv::Mat drawValuesPoints(const std::vector<cv::Point2d> &points, const std::vect
     assert(values.size() == points.size());
     assert((method.compare("nn") == 0) || (method.compare("bilinear") == 0));
 
-    /** Mat image **/
-    cv::Mat img = cv::Mat(height, width, CV_64FC1, cv::Scalar(0));
-    cv::Size size = img.size();
-
-    auto clip = [](const int n, const int lower, const int upper)
-    {
-        return std::max(lower, std::min(n, upper));
-    };
-
-    auto it_x = points.begin();
-    auto it_p = values.begin();
-    while(it_x != points.end() && it_p != values.end())
-    {
-        if (method.compare("nn") == 0)
-        {
-            cv::Point2i x_int = *it_x;
-            //std::cout<<*it_x<<std::endl;
-            x_int.x = clip(x_int.x, 0, size.width - 1);
-            x_int.y = clip(x_int.y, 0, size.height - 1);
+    /** Mat image (reuse the memory) **/
+    img.create(height, width, CV_64FC1);
+    eds::utils::accumulatePoints(points.data(), values.data(), std::min(points.size(), values.size()), height, width,
+                        eds::utils::selectAccumulateMethod(method), use_exp_weights, img.ptr<double>(), img.step1(),
+                        buffers, num_threads);
 
-            img.at<double>(x_int) += (*it_p);
- 
-        }
-        else if (method.compare("bilinear") == 0)
-        {   
-            int x0 = floor(it_x->x);
-            int y0 = floor(it_x->y);
-            int x1 = x0 + 1;
-            int y1 = y0 + 1;
-            //std::cout<<"x0: "<< x0<<" y0: "<<y0<<" x1: "<< x1<<" y1: "<<y1 <<" pol: "<<std::to_string(*it_p)<<std::endl;
-            /** compute the voting weights. Note: assign weight 0 if the point is out of the image **/
-            double wa, wb, wc, wd;
-            wa = ((x0 < size.width) && (y0 < size.height) && (x0 >= 0) && (y0 >= 0))? (x1 - it_x->x) * (y1 - it_x->y) : 0.0;
-            wb = ((x0 < size.width) && (y1 < size.height) && (x0 >= 0) && (y1 >= 0))? (x1 - it_x->x) * (it_x->y - y0) : 0.0;
-            wc = ((x1 < size.width) && (y0 < size.height) && (x1 >= 0) && (y0 >= 0))? (it_x->x - x0) * (y1 - it_x->y) : 0.0;
-            wd = ((x1 < size.width) && (y1 < size.height) && (x1 >= 0) && (y1 >= 0))? (it_x->x - x0) * (it_x->y - y0) : 0.0;
+    blurValuesPoints(img, img, s);
+}
 
-            x0 = clip(x0, 0, size.width - 1);
-            x1 = clip(x1, 0, size.width - 1);
-            y0 = clip(y0, 0, size.height - 1);
-            y1 = clip(y1, 0, size.height - 1);
-            //std::cout<<"wa: "<<wa<<" wb: "<<wb<<" wc: "<<wc<<" wd: "<<wd<<std::endl;
+cv::Mat drawValuesPoints(const std::vector<cv::Point2d> &points, const std::vector<double> &values, const int height, const int width, const std::string &method, const float s)
+{
+    /** Asertion only in debug mode **/
+    assert(height > 0);
+    assert(width > 0);
+    assert(values.size() == points.size());
+    assert((method.compare("nn") == 0) || (method.compare("bilinear") == 0));
 
-            img.at<double>(y0, x0) += wa * (*it_p);
-            img.at<double>(y1, x0) += wb * (*it_p);
-            img.at<double>(y0, x1) += wc * (*it_p);
-            img.at<double>(y1, x1) += wd * (*it_p);
-        }
-        ++it_x;
-        ++it_p;
-    }
+    /** Mat image **/
+    cv::Mat img = cv::Mat(height, width, CV_64FC1);
+    eds::utils::accumulatePoints(points.data(), values.data(), std::min(points.size(), values.size()), height, width,
+                        eds::utils::selectAccumulateMethod(method), false, img.ptr<double>(), img.step1());
 
-    if(s > 0)
-    {
-        /** Kernal size depending on image size **/
-        int k_h = int((1.7 * 180)/100);
-        int k_w = int((1.25 * 240)/100);
-        cv::GaussianBlur(img, img, cv::Size(k_w, k_h), s, s);
-    }
+    blurValuesPoints(img, img, s);
 
     return img;
 }
@@ -201,67 +114,16 @@ cv::Mat drawValuesPoints(const std::vector<::eds::mapping::Point2d> &points, con
     assert((method.compare("nn") == 0) || (method.compare("bilinear") == 0));
 
     /** Mat image **/
-    cv::Mat img = cv::Mat(height, width, CV_64FC1, cv::Scalar(0));
-    cv::Size size = img.size();
+    cv::Mat img = cv::Mat(height, width, CV_64FC1);
+    eds::utils::accumulatePoints(points.data(), values.data(), std::min(points.size(), values.size()), height, width,
+                        eds::utils::selectAccumulateMethod(method), false, img.ptr<double>(), img.step1());
 
-    auto clip = [](const int n, const int lower, const int upper)
-    {
-        return std::max(lower, std::min(n, upper));
-    };
-
-    auto it_x = points.begin();
-    auto it_p = values.begin();
-    while(it_x != points.end() && it_p != values.end())
-    {
-        if (method.compare("nn") == 0)
-        {
-            cv::Point2i x_int = cv::Point2d(*it_x);
-            //std::cout<<*it_x<<std::endl;
-            x_int.x = clip(x_int.x, 0, size.width - 1);
-            x_int.y = clip(x_int.y, 0, size.height - 1);
-
-            img.at<double>(x_int) += (*it_p);
-        }
-        else if (method.compare("bilinear") == 0)
-        {
-            int x0 = floor((*it_x)[0]);
-            int y0 = floor((*it_x)[1]);
-            int x1 = x0 + 1;
-            int y1 = y0 + 1;
-            //std::cout<<"x0: "<< x0<<" y0: "<<y0<<" x1: "<< x1<<" y1: "<<y1 <<" pol: "<<std::to_string(*it_p)<<std::endl;
-            /** compute the voting weights. Note: assign weight 0 if the point is out of the image **/
-            double wa, wb, wc, wd;
-            wa = ((x0 < size.width) && (y0 < size.height) && (x0 >= 0) && (y0 >= 0))? (x1 - (*it_x)[0]) * (y1 - (*it_x)[1]) : 0.0;
-            wb = ((x0 < size.width) && (y1 < size.height) && (x0 >= 0) && (y1 >= 0))? (x1 - (*it_x)[0]) * ((*it_x)[1] - y0) : 0.0;
-            wc = ((x1 < size.width) && (y0 < size.height) && (x1 >= 0) && (y0 >= 0))? ((*it_x)[0] - x0) * (y1 - (*it_x)[1]) : 0.0;
-            wd = ((x1 < size.width) && (y1 < size.height) && (x1 >= 0) && (y1 >= 0))? ((*it_x)[0] - x0) * ((*it_x)[1] - y0) : 0.0;
-
-            x0 = clip(x0, 0, size.width - 1);
-            x1 = clip(x1, 0, size.width - 1);
-            y0 = clip(y0, 0, size.height - 1);
-            y1 = clip(y1, 0, size.height - 1);
-            //std::cout<<"wa: "<<wa<<" wb: "<<wb<<" wc: "<<wc<<" wd: "<<wd<<std::endl;
-
-            img.at<double>(y0, x0) += wa * (*it_p);
-            img.at<double>(y1, x0) += wb * (*it_p);
-            img.at<double>(y0, x1) += wc * (*it_p);
-            img.at<double>(y1, x1) += wd * (*it_p);
-        }
-        ++it_x;
-        ++it_p;
-    }
-
-    if(s > 0)
-    {
-        /** Kernal size depending on image size **/
-        int k_h = int((1.7 * 180)/100);
-        int k_w = int((1.25 * 240)/100);
-        cv::GaussianBlur(img, img, cv::Size(k_w, k_h), s, s);
-    }
+    blurValuesPoints(img, img, s);
 
     return img;
 }
 
+
 cv::Mat drawValuesPointInfo(const std::vector<::eds::mapping::PointInfo> &points_info,
                         const int height, const int width, const std::string &method, const float s)
 {
@@ -344,62 +206,18 @@ cv::Mat drawValuesPoints(std::vector<cv::Point2d>::const_iterator &points_begin,
     assert((method.compare("nn") == 0) || (method.compare("bilinear") == 0));
 
     /** Mat image **/
-    cv::Mat img = cv::Mat(height, width, CV_64FC1, cv::Scalar(0));
-    cv::Size size = img.size();
-
-    auto clip = [](const int n, const int lower, const int upper)
-    {
-        return std::max(lower, std::min(n, upper));
-    };
-
-    while(points_begin != points_end && values_begin != values_end)
+    cv::Mat img = cv::Mat(height, width, CV_64FC1);
+    const size_t n = std::min(std::distance(points_begin, points_end), std::distance(values_begin, values_end));
+    if (n > 0)
     {
-        if (method.compare("nn") == 0)
-        {
-            cv::Point2i x_int = *points_begin;
-            //std::cout<<*it_x<<std::endl;
-            x_int.x = clip(x_int.x, 0, size.width - 1);
-            x_int.y = clip(x_int.y, 0, size.height - 1);
-
-            img.at<double>(x_int) += (*values_begin);
-
-        }
-        else if (method.compare("bilinear") == 0)
-        {
-            int x0 = floor(points_begin->x);
-            int y0 = floor(points_begin->y);
-            int x1 = x0 + 1;
-            int y1 = y0 + 1;
-            //std::cout<<"x0: "<< x0<<" y0: "<<y0<<" x1: "<< x1<<" y1: "<<y1 <<" pol: "<<std::to_string(*it_p)<<std::endl;
-            /** compute the voting weights. Note: assign weight 0 if the point is out of the image **/
-            double wa, wb, wc, wd;
-            wa = ((x0 < size.width) && (y0 < size.height) && (x0 >= 0) && (y0 >= 0))? (x1 - points_begin->x) * (y1 - points_begin->y) : 0.0;
-            wb = ((x0 < size.width) && (y1 < size.height) && (x0 >= 0) && (y1 >= 0))? (x1 - points_begin->x) * (points_begin->y - y0) : 0.0;
-            wc = ((x1 < size.width) && (y0 < size.height) && (x1 >= 0) && (y0 >= 0))? (points_begin->x - x0) * (y1 - points_begin->y) : 0.0;
-            wd = ((x1 < size.width) && (y1 < size.height) && (x1 >= 0) && (y1 >= 0))? (points_begin->x - x0) * (points_begin->y - y0) : 0.0;
-
-            x0 = clip(x0, 0, size.width - 1);
-            x1 = clip(x1, 0, size.width - 1);
-            y0 = clip(y0, 0, size.height - 1);
-            y1 = clip(y1, 0, size.height - 1);
-            //std::cout<<"wa: "<<wa<<" wb: "<<wb<<" wc: "<<wc<<" wd: "<<wd<<std::endl;
-
-            img.at<double>(y0, x0) += wa * (*values_begin);
-            img.at<double>(y1, x0) += wb * (*values_begin);
-            img.at<double>(y0, x1) += wc * (*values_begin);
-            img.at<double>(y1, x1) += wd * (*values_begin);
-        }
-        ++points_begin;
-        ++values_begin;
+        eds::utils::accumulatePoints(&(*points_begin), &(*values_begin), n, height, width,
+                        eds::utils::selectAccumulateMethod(method), false, img.ptr<double>(), img.step1());
+        points_begin += n; values_begin += n;
     }
+    else
+        img.setTo(cv::Scalar(0));
 
-    if(s > 0)
-    {
-        /** Kernal size depending on image size **/
-        int k_h = int((1.7 * 180)/100);
-        int k_w = int((1.25 * 240)/100);
-        cv::GaussianBlur(img, img, cv::Size(k_w, k_h), s, s);
-    }
+    blurValuesPoints(img, img, s);
 
     return img;
 }
@@ -42,6 +42,7 @@
 
 /** EDS Types **/
 #include <eds/utils/Calib.hpp>
+#include <eds/utils/Accumulate.hpp>
 #include <eds/mapping/Types.hpp>
 
 namespace eds { namespace utils {
@@ -92,7 +93,15 @@ namespace eds { namespace utils {
 
     cv::Mat drawValuesPoints(const std::vector<cv::Point2d> &points, const std::vector<int8_t> &values, const int height, const int width, const std::string &method = "nn", const float s=0.5, const bool &use_exp_weights=false);
 
+    /** Same as above writing in img (allocated only when the size or type changes).
+     * buffers and num_threads select the blocked and multi-threaded accumulation **/
+    void drawValuesPoints(const std::vector<cv::Point2d> &points, const std::vector<int8_t> &values, const int height, const int width, const std::string &method, const float s, const bool &use_exp_weights, cv::Mat &img,
+                        ::eds::utils::AccumulateBuffers<double> *buffers = nullptr, const int &num_threads = 1);
+
     cv::Mat drawValuesPoints(const std::vector<cv::Point2d> &points, const std::vector<double> &values, const int height, const int width, const std::string &method = "nn", const float s=0.5);
+
+    /** Gaussian blur (sigma s) of an image of accumulated values. Copy when s <= 0 **/
+    void blurValuesPoints(const cv::Mat &src, cv::Mat &dst, const float s);
  
     cv::Mat drawValuesPoints(const std::vector<::eds::mapping::Point2d> &points, const std::vector<double> &values, const int height, const int width, const std::string &method = "nn", const float s=0.5);
 
@@ -0,0 +1,2 @@
+#define BOOST_TEST_MODULE EDS
+#include <boost/test/unit_test.hpp>
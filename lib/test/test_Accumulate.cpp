@@ -0,0 +1,144 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/utils/Accumulate.hpp>
+
+#include <random>
+#include <vector>
+#include <cmath>
+
+using namespace eds::utils;
+
+namespace
+{
+    /** Points inside, on the border and out of the image, with polarities **/
+    void makePoints(const int &height, const int &width, const size_t &n, const unsigned int &seed,
+                    std::vector<cv::Point2d> &points, std::vector<int8_t> &values)
+    {
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<double> x(-2.0, width + 1.0), y(-2.0, height + 1.0);
+        std::uniform_int_distribution<int> p(0, 1);
+        points = {cv::Point2d(0.0, 0.0), cv::Point2d(width - 1.0, height - 1.0), cv::Point2d(width - 0.5, 3.25),
+                cv::Point2d(-0.5, -0.5), cv::Point2d(2.75, height - 0.25), cv::Point2d(-3.0, 1.0)};
+        while (points.size() < n)
+            points.push_back(cv::Point2d(x(gen), y(gen)));
+        values.resize(n);
+        for (int8_t &v : values)
+            v = (p(gen))? 1 : -1;
+    }
+
+    /** Brute-force splat in input order (height x width, double). abs_sum
+     * is the sum of the absolute votes of each pixel **/
+    void splat(const std::vector<cv::Point2d> &points, const std::vector<int8_t> &values, const int &height, const int &width,
+                const ACCUMULATE_METHOD &method, const bool &exp_weights, std::vector<double> &img, std::vector<double> &abs_sum)
+    {
+        img.assign(height * width, 0.0); abs_sum.assign(height * width, 0.0);
+        const size_t n = points.size();
+        auto vote = [&](const int &x, const int &y, const double &v)
+        {
+            if (x < 0 || y < 0 || x >= width || y >= height) return;
+            img[y * width + x] += v; abs_sum[y * width + x] += std::abs(v);
+        };
+        for (size_t i=0; i<n; ++i)
+        {
+            const double t = (static_cast<double>(i)/n - 0.5) * 6.0;
+            const double v = values[i] * ((exp_weights)? std::exp(-0.5*t*t) : 1.0);
+            const double x = points[i].x, y = points[i].y;
+            if (method == NEAREST)
+            {
+                const int xi = std::min(std::max(static_cast<int>(std::lrint(x)), 0), width - 1);
+                const int yi = std::min(std::max(static_cast<int>(std::lrint(y)), 0), height - 1);
+                vote(xi, yi, v);
+            }
+            else
+            {
+                const int x0 = std::floor(x), y0 = std::floor(y);
+                const double dx = x - x0, dy = y - y0;
+                vote(x0, y0, v * (1.0 - dx) * (1.0 - dy));
+                vote(x0, y0 + 1, v * (1.0 - dx) * dy);
+                vote(x0 + 1, y0, v * dx * (1.0 - dy));
+                vote(x0 + 1, y0 + 1, v * dx * dy);
+            }
+        }
+    }
+
+    /** accumulatePoints in an image with padding columns (step > width)
+     * against the brute-force splat, for all the methods and weights **/
+    template <typename T>
+    void checkAccumulate(const int &height, const int &width, const size_t &n,
+                        AccumulateBuffers<T> *buffers, const int &num_threads, const double &tolerance)
+    {
+        std::vector<cv::Point2d> points;
+        std::vector<int8_t> values;
+        makePoints(height, width, n, height + width + num_threads, points, values);
+
+        const size_t step = width + 3;
+        std::vector<T> img(height * step);
+        std::vector<double> expected, magnitude;
+        for (const ACCUMULATE_METHOD method : {NEAREST, BILINEAR})
+        {
+            for (const bool exp_weights : {false, true})
+            {
+                std::fill(img.begin(), img.end(), T(7));
+                accumulatePoints(points.data(), values.data(), n, height, width, method, exp_weights,
+                                img.data(), step, buffers, num_threads);
+                splat(points, values, height, width, method, exp_weights, expected, magnitude);
+
+                /** Relative to the votes of the pixel (the summation order differs) **/
+                double max_error = 0.0; bool padding = true;
+                for (int row=0; row<height; ++row)
+                {
+                    for (int col=0; col<width; ++col)
+                    {
+                        const double error = std::abs(img[row * step + col] - expected[row * width + col]);
+                        max_error = std::max(max_error, error / (1.0 + magnitude[row * width + col]));
+                    }
+                    for (size_t col=width; col<step; ++col)
+                        padding = padding && (img[row * step + col] == T(7));
+                }
+                BOOST_CHECK_SMALL(max_error, tolerance);
+                BOOST_CHECK(padding);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(AccumulateKernel)
+
+BOOST_AUTO_TEST_CASE(sequential_range)
+{
+    checkAccumulate<double>(23, 37, 3000, nullptr, 1, 1e-12);
+    checkAccumulate<float>(23, 37, 3000, nullptr, 1, 1e-05);
+
+    /** Buffers with a small image and one thread: same in-order loop **/
+    AccumulateBuffers<double> buffers;
+    checkAccumulate<double>(23, 37, 3000, &buffers, 1, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(blocked_by_bands)
+{
+    /** Images over ACCUMULATE_BLOCK_BYTES are accumulated by bands of rows **/
+    AccumulateBuffers<double> buffers;
+    BOOST_REQUIRE_GT(1100 * (2000 + 3) * sizeof(double), ACCUMULATE_BLOCK_BYTES);
+    checkAccumulate<double>(1100, 2000, 20000, &buffers, 1, 1e-12);
+
+    AccumulateBuffers<float> buffers_f;
+    BOOST_REQUIRE_GT(2200 * (2000 + 3) * sizeof(float), ACCUMULATE_BLOCK_BYTES);
+    checkAccumulate<float>(2200, 2000, 20000, &buffers_f, 1, 1e-05);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_tiles)
+{
+    /** Enough points per thread for the tiles. The same buffers (and
+     * workers) are used for several calls and thread counts **/
+    AccumulateBuffers<double> buffers;
+    for (const int num_threads : {2, 3, NUM_THREADS + 2})
+    {
+        BOOST_REQUIRE_GE(40000u, num_threads * ACCUMULATE_MIN_POINTS_THREAD);
+        checkAccumulate<double>(23, 37, 40000, &buffers, num_threads, 1e-12);
+        checkAccumulate<double>(23, 37, 40000, &buffers, num_threads, 1e-12);
+    }
+
+    AccumulateBuffers<float> buffers_f;
+    checkAccumulate<float>(23, 37, 40000, &buffers_f, 3, 1e-05);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,114 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/utils/BoundedQueue.hpp>
+
+#include <vector>
+
+using namespace eds::utils;
+
+BOOST_AUTO_TEST_SUITE(BoundedQueueInput)
+
+BOOST_AUTO_TEST_CASE(fifo_and_drop_oldest)
+{
+    BoundedQueue<int> queue(3, DROP_OLDEST);
+    int item = 0;
+    BOOST_CHECK(queue.empty());
+    BOOST_CHECK(!queue.pop(item));
+
+    for (int i=0; i<5; ++i)
+        BOOST_CHECK(queue.push(int(i)));
+
+    /** 0 and 1 are dropped, the order is kept **/
+    QueueStats stats = queue.getStats();
+    BOOST_CHECK_EQUAL(stats.depth, 3u);
+    BOOST_CHECK_EQUAL(stats.max_depth, 3u);
+    BOOST_CHECK_EQUAL(stats.pushed, 5u);
+    BOOST_CHECK_EQUAL(stats.dropped, 2u);
+
+    int oldest = -1;
+    BOOST_CHECK(queue.front([&oldest](const int &i){oldest = i;}));
+    BOOST_CHECK_EQUAL(oldest, 2);
+    for (int i=2; i<5; ++i)
+    {
+        BOOST_CHECK(queue.pop(item));
+        BOOST_CHECK_EQUAL(item, i);
+    }
+    BOOST_CHECK(queue.empty());
+    BOOST_CHECK_EQUAL(queue.getStats().popped, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(merge_into_newest)
+{
+    BoundedQueue< std::vector<int> > queue(2, MERGE,
+        [](std::vector<int> &newest, std::vector<int> &item)
+        {
+            newest.insert(newest.end(), item.begin(), item.end());
+        });
+
+    for (int i=0; i<4; ++i)
+        BOOST_CHECK(queue.push(std::vector<int>(1, i)));
+
+    /** 2 and 3 are merged in the newest element, nothing is lost **/
+    QueueStats stats = queue.getStats();
+    BOOST_CHECK_EQUAL(stats.depth, 2u);
+    BOOST_CHECK_EQUAL(stats.merged, 2u);
+    BOOST_CHECK_EQUAL(stats.dropped, 0u);
+
+    std::vector<int> item;
+    BOOST_CHECK(queue.pop(item));
+    BOOST_CHECK(item == std::vector<int>({0}));
+    BOOST_CHECK(queue.pop(item));
+    BOOST_CHECK(item == std::vector<int>({1, 2, 3}));
+
+    /** Without a merge function MERGE drops the oldest **/
+    BoundedQueue<int> no_merge(1, MERGE);
+    no_merge.push(1); no_merge.push(2);
+    int value = 0;
+    BOOST_CHECK(no_merge.pop(value));
+    BOOST_CHECK_EQUAL(value, 2);
+    BOOST_CHECK_EQUAL(no_merge.getStats().dropped, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(block_until_pop)
+{
+    BoundedQueue<int> queue(2, BLOCK);
+    queue.push(0); queue.push(1);
+
+    /** The producer waits for the consumer **/
+    bool pushed = false;
+    boost::thread producer([&queue, &pushed](){pushed = queue.push(2);});
+    boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+    BOOST_CHECK_EQUAL(queue.getStats().pushed, 2u);
+
+    int item = -1;
+    BOOST_CHECK(queue.pop(item));
+    BOOST_CHECK_EQUAL(item, 0);
+    producer.join();
+    BOOST_CHECK(pushed);
+    BOOST_CHECK_EQUAL(queue.getStats().dropped, 0u);
+    BOOST_CHECK(queue.pop(item)); BOOST_CHECK_EQUAL(item, 1);
+    BOOST_CHECK(queue.pop(item)); BOOST_CHECK_EQUAL(item, 2);
+}
+
+BOOST_AUTO_TEST_CASE(close_wakes_producer)
+{
+    BoundedQueue<int> queue(1, BLOCK);
+    queue.push(0);
+
+    /** A blocked producer returns false on close **/
+    bool pushed = true;
+    boost::thread producer([&queue, &pushed](){pushed = queue.push(1);});
+    boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+    queue.close();
+    producer.join();
+    BOOST_CHECK(!pushed);
+
+    /** Closed: no new elements, the queued ones are still consumed **/
+    BOOST_CHECK(!queue.push(2));
+    int item = -1;
+    BOOST_CHECK(queue.pop(item));
+    BOOST_CHECK_EQUAL(item, 0);
+    BOOST_CHECK(queue.empty());
+    BOOST_CHECK_EQUAL(queue.getStats().pushed, 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,181 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/tracking/EventBuffer.hpp>
+
+#include <vector>
+
+using namespace eds::tracking;
+
+namespace
+{
+    /** Events with time stamps [first, first+n) us and x = time stamp **/
+    std::vector<::base::samples::Event> makeEvents(const int &first, const int &n)
+    {
+        std::vector<::base::samples::Event> events;
+        for (int i=first; i<first+n; ++i)
+            events.push_back(::base::samples::Event(i % 640, i % 480, ::base::Time::fromMicroseconds(i), i % 2));
+        return events;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(EventRingBuffer)
+
+BOOST_AUTO_TEST_CASE(wrap_around_window)
+{
+    /** Capacity 8: after advancing 6 of 6 events the next 5 wrap around **/
+    EventBuffer buffer(8);
+    buffer.push(makeEvents(0, 6));
+    buffer.advance(6);
+    BOOST_CHECK(buffer.empty());
+    buffer.push(makeEvents(6, 5));
+    BOOST_CHECK_EQUAL(buffer.size(), 5u);
+    BOOST_CHECK_EQUAL(buffer.capacity(), 8u);
+
+    EventWindow w = buffer.window(5);
+    BOOST_CHECK_EQUAL(w.first.size, 2u);
+    BOOST_CHECK_EQUAL(w.second.size, 3u);
+    BOOST_CHECK_EQUAL(w.front().ts.toMicroseconds(), 6);
+    BOOST_CHECK_EQUAL(w.back().ts.toMicroseconds(), 10);
+
+    /** Indexing and forEach see the same events in time order across both spans **/
+    std::vector<int64_t> visited;
+    std::vector<bool> polarities;
+    w.forEach([&visited, &polarities](const uint16_t &x, const uint16_t &, const int64_t &ts, const bool &p)
+    {
+        BOOST_CHECK_EQUAL(x, ts % 640);
+        visited.push_back(ts); polarities.push_back(p);
+    });
+    BOOST_REQUIRE_EQUAL(visited.size(), 5u);
+    for (size_t i=0; i<w.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(w[i].ts.toMicroseconds(), 6 + (int64_t)i);
+        BOOST_CHECK_EQUAL(w.ts(i), 6 + (int64_t)i);
+        BOOST_CHECK_EQUAL(w.getPolarity(i), (6 + i) % 2 == 1);
+        BOOST_CHECK_EQUAL(visited[i], 6 + (int64_t)i);
+        BOOST_CHECK_EQUAL(polarities[i], (6 + i) % 2 == 1);
+    }
+
+    /** Sub-range across the wrap **/
+    visited.clear();
+    w.forEach(1, 4, [&visited](const uint16_t &, const uint16_t &, const int64_t &ts, const bool &){visited.push_back(ts);});
+    BOOST_CHECK(visited == std::vector<int64_t>({7, 8, 9}));
+
+    /** Shorter window within the first span **/
+    EventWindow w2 = buffer.window(2);
+    BOOST_CHECK_EQUAL(w2.first.size, 2u);
+    BOOST_CHECK_EQUAL(w2.second.size, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(lower_bound_across_wrap)
+{
+    EventBuffer buffer(8);
+    buffer.push(makeEvents(0, 5));
+    buffer.advance(5);
+    buffer.push(makeEvents(5, 7)); // 3 in the first span, 4 in the second
+    EventWindow w = buffer.window(buffer.size());
+    BOOST_REQUIRE_EQUAL(w.second.size, 4u);
+
+    for (int64_t t=0; t<=14; ++t)
+    {
+        size_t expected = (t <= 5)? 0 : std::min<int64_t>(t - 5, 7);
+        BOOST_CHECK_EQUAL(w.lowerBound(::base::Time::fromMicroseconds(t)), expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(advance_and_grow)
+{
+    EventBuffer buffer(4);
+    buffer.push(makeEvents(0, 3));
+    buffer.advance(2);
+    BOOST_CHECK_EQUAL(buffer.size(), 1u);
+    BOOST_CHECK_EQUAL(buffer.front().ts.toMicroseconds(), 2);
+
+    /** Advancing more than the size empties the buffer **/
+    buffer.advance(10);
+    BOOST_CHECK(buffer.empty());
+
+    /** Wrapped content is linearized when growing **/
+    buffer.push(makeEvents(3, 3));
+    buffer.push(makeEvents(6, 7));
+    BOOST_CHECK_EQUAL(buffer.size(), 10u);
+    BOOST_CHECK_GE(buffer.capacity(), 10u);
+    EventWindow w = buffer.window(buffer.size());
+    BOOST_CHECK_EQUAL(w.second.size, 0u);
+    for (size_t i=0; i<w.size(); ++i)
+        BOOST_CHECK_EQUAL(w[i].ts.toMicroseconds(), 3 + (int64_t)i);
+
+    /** Columnar batches are copied column by column, also across the wrap **/
+    ::base::samples::EventBatch batch;
+    for (const ::base::samples::Event &ev : makeEvents(13, 4))
+        batch.push_back(ev);
+    buffer.advance(8);
+    buffer.push(batch);
+    w = buffer.window(buffer.size());
+    BOOST_REQUIRE_EQUAL(w.size(), 6u);
+    for (size_t i=0; i<w.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(w[i].ts.toMicroseconds(), 11 + (int64_t)i);
+        BOOST_CHECK_EQUAL(w[i].x, (11 + i) % 640);
+        BOOST_CHECK_EQUAL(w[i].polarity, (11 + i) % 2);
+    }
+
+    buffer.clear();
+    BOOST_CHECK(buffer.empty());
+    BOOST_CHECK(buffer.window(0).empty());
+}
+
+BOOST_AUTO_TEST_CASE(columnar_batch_across_wrap)
+{
+    /** Polarity pattern that is not periodic in 64 **/
+    auto polarity = [](const int &i){return ((i * 7) % 11) < 5;};
+    ::base::samples::EventBatch batch;
+    for (int i=0; i<100; ++i)
+        batch.push_back(i % 640, (3 * i) % 480, 10 * i, polarity(i));
+
+    /** 2 events before the end of the storage and 4 after the wrap **/
+    EventBuffer ring(8);
+    ring.push(makeEvents(0, 6));
+    ring.advance(6);
+    ::base::samples::EventBatch part;
+    for (int i=0; i<6; ++i)
+        part.push_back(batch.getEvent(i));
+    ring.push(part);
+    EventWindow w = ring.window(ring.size());
+    BOOST_REQUIRE_EQUAL(w.first.size, 2u);
+    BOOST_REQUIRE_EQUAL(w.second.size, 4u);
+    for (size_t i=0; i<w.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(w.x(i), i % 640);
+        BOOST_CHECK_EQUAL(w.y(i), (3 * i) % 480);
+        BOOST_CHECK_EQUAL(w.ts(i), 10 * (int64_t)i);
+        BOOST_CHECK_EQUAL(w.getPolarity(i), polarity(i));
+    }
+    BOOST_CHECK_EQUAL(w.lowerBound(::base::Time::fromMicroseconds(15)), 2u);
+    BOOST_CHECK_EQUAL(w.lowerBound(::base::Time::fromMicroseconds(20)), 2u);
+    BOOST_CHECK_EQUAL(w.lowerBound(::base::Time::fromMicroseconds(21)), 3u);
+
+    /** Growing with wrapped content keeps the polarity bits **/
+    ::base::samples::EventBatch rest;
+    for (int i=6; i<100; ++i)
+        rest.push_back(batch.getEvent(i));
+    ring.push(rest);
+    w = ring.window(ring.size());
+    BOOST_REQUIRE_EQUAL(w.size(), 100u);
+    BOOST_CHECK_EQUAL(w.second.size, 0u);
+    for (size_t i=0; i<w.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(w.ts(i), 10 * (int64_t)i);
+        BOOST_CHECK_EQUAL(w.getPolarity(i), polarity(i));
+    }
+
+    /** View of a part of a batch: the polarity bits start at the offset **/
+    EventWindow view(batch, 70, 20);
+    BOOST_REQUIRE_EQUAL(view.size(), 20u);
+    for (size_t i=0; i<view.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(view.ts(i), 10 * (70 + (int64_t)i));
+        BOOST_CHECK_EQUAL(view.getPolarity(i), polarity(70 + i));
+    }
+    BOOST_CHECK_EQUAL(EventWindow(batch, 90).size(), 10u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/tracking/EventFilter.hpp>
+
+#include <vector>
+
+using namespace eds::tracking;
+
+namespace
+{
+    /** Filter with all the rules disabled **/
+    EventFilterConfig filterConfig()
+    {
+        EventFilterConfig config;
+        config.enabled = true;
+        config.refractory_period = base::Time();
+        config.hot_pixel_rate = 0.0;
+        config.hot_pixel_period = base::Time::fromMilliseconds(1000);
+        config.background_activity = base::Time();
+        return config;
+    }
+
+    ::base::samples::Event event(const uint16_t &x, const uint16_t &y, const int64_t &ts_us, const bool &p = true)
+    {
+        return ::base::samples::Event(x, y, ::base::Time::fromMicroseconds(ts_us), p);
+    }
+
+    ::base::samples::EventBatch toBatch(const std::vector<::base::samples::Event> &events)
+    {
+        ::base::samples::EventBatch batch;
+        batch.append(events);
+        return batch;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(EventPreFilter)
+
+BOOST_AUTO_TEST_CASE(refractory_period)
+{
+    EventFilterConfig config = filterConfig();
+    config.refractory_period = base::Time::fromMicroseconds(100);
+
+    /** Same pixel at 0, 50 (removed) and 150 (100 us after the removed one).
+     * Border pixels are kept and the event out of the image is removed **/
+    std::vector<::base::samples::Event> events = {event(3, 3, 0), event(0, 0, 10), event(3, 3, 50),
+                                                event(9, 7, 60), event(10, 0, 70), event(3, 3, 150)};
+    ::base::samples::EventBatch batch = toBatch(events);
+
+    EventFilter filter(config, 8, 10), filter_batch(config, 8, 10);
+    BOOST_CHECK_EQUAL(filter.filter(events), 4u);
+    BOOST_CHECK_EQUAL(filter_batch.filter(batch), 4u);
+
+    const std::vector<int64_t> expected = {0, 10, 60, 150};
+    for (size_t i=0; i<expected.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(events[i].ts.toMicroseconds(), expected[i]);
+        BOOST_CHECK_EQUAL(batch.ts[i], expected[i]);
+    }
+    BOOST_CHECK_EQUAL(filter.getInfo().num_events, 6u);
+    BOOST_CHECK_EQUAL(filter.getInfo().num_refractory, 1u);
+    BOOST_CHECK_EQUAL(filter_batch.getInfo().num_refractory, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(background_activity)
+{
+    EventFilterConfig config = filterConfig();
+    config.background_activity = base::Time::fromMicroseconds(1000);
+
+    /** (0, 0) corner without neighbours: removed. (1, 0) 500 us after its
+     * neighbour: kept. (9, 7) corner alone and (8, 7) 1400 us after it: removed **/
+    std::vector<::base::samples::Event> events = {event(0, 0, 0), event(1, 0, 500),
+                                                event(9, 7, 600), event(8, 7, 2000), event(8, 6, 2500)};
+    ::base::samples::EventBatch batch = toBatch(events);
+
+    EventFilter filter(config, 8, 10), filter_batch(config, 8, 10);
+    BOOST_CHECK_EQUAL(filter.filter(events), 2u);
+    BOOST_CHECK_EQUAL(filter_batch.filter(batch), 2u);
+    BOOST_CHECK_EQUAL(events[0].x, 1); BOOST_CHECK_EQUAL(events[0].y, 0);
+    BOOST_CHECK_EQUAL(events[1].x, 8); BOOST_CHECK_EQUAL(events[1].y, 6);
+    BOOST_CHECK_EQUAL(batch.x[0], 1); BOOST_CHECK_EQUAL(batch.y[0], 0);
+    BOOST_CHECK_EQUAL(batch.x[1], 8); BOOST_CHECK_EQUAL(batch.y[1], 6);
+    BOOST_CHECK_EQUAL(filter.getInfo().num_background, 3u);
+    BOOST_CHECK_EQUAL(filter_batch.getInfo().num_background, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(hot_pixels)
+{
+    EventFilterConfig config = filterConfig();
+    config.hot_pixel_rate = 1000.0;
+    config.hot_pixel_period = base::Time::fromMilliseconds(10);
+
+    /** First period: (2, 2) fires 50 events in 10 ms (5 kHz), (5, 5) two events **/
+    std::vector<::base::samples::Event> events;
+    for (int k=0; k<50; ++k)
+        events.push_back(event(2, 2, k * 200));
+    events.push_back(event(5, 5, 1000)); events.push_back(event(5, 5, 9000));
+
+    EventFilter filter(config, 8, 10), filter_batch(config, 8, 10);
+    ::base::samples::EventBatch batch = toBatch(events);
+    BOOST_CHECK_EQUAL(filter.filter(events), 52u);
+    BOOST_CHECK_EQUAL(filter_batch.filter(batch), 52u);
+
+    /** Next period: (2, 2) is masked **/
+    std::vector<::base::samples::Event> next = {event(2, 2, 10000), event(5, 5, 10100), event(2, 2, 10200)};
+    batch = toBatch(next);
+    BOOST_CHECK_EQUAL(filter.filter(next), 1u);
+    BOOST_CHECK_EQUAL(filter_batch.filter(batch), 1u);
+    BOOST_CHECK_EQUAL(next[0].x, 5);
+    BOOST_CHECK_EQUAL(batch.x[0], 5);
+    BOOST_CHECK_EQUAL(filter.getInfo().num_hot_pixels, 1u);
+    BOOST_CHECK_EQUAL(filter.getInfo().num_hot_pixel, 2u);
+    BOOST_CHECK_EQUAL(filter_batch.getInfo().num_hot_pixel, 2u);
+
+    /** Reset clears the mask **/
+    filter.reset();
+    next = {event(2, 2, 20000)};
+    BOOST_CHECK_EQUAL(filter.filter(next), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(batch_polarity_compaction)
+{
+    /** Every third event is out of the image: the kept polarities move
+     * across the 64-bit words **/
+    std::vector<::base::samples::Event> events;
+    for (int i=0; i<200; ++i)
+        events.push_back(event((i % 3 == 0)? 10 : i % 10, (i / 10) % 8, i, ((i * 5) % 7) < 3));
+    ::base::samples::EventBatch batch = toBatch(events);
+
+    EventFilter filter(filterConfig(), 8, 10), filter_batch(filterConfig(), 8, 10);
+    const size_t n = filter.filter(events);
+    BOOST_REQUIRE_EQUAL(filter_batch.filter(batch), n);
+    BOOST_CHECK_EQUAL(n, 133u);
+    BOOST_CHECK_EQUAL(batch.polarity.size(), (n + 63) / 64);
+
+    size_t j = 0;
+    for (int i=0; i<200; ++i)
+    {
+        if (i % 3 == 0) continue;
+        BOOST_CHECK_EQUAL(batch.ts[j], i);
+        BOOST_CHECK_EQUAL(batch.getPolarity(j), ((i * 5) % 7) < 3);
+        BOOST_CHECK_EQUAL((bool)events[j].polarity, ((i * 5) % 7) < 3);
+        ++j;
+    }
+
+    /** Bits after the last event are cleared **/
+    BOOST_CHECK_EQUAL(batch.polarity.back() >> (n & 63), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,83 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/tracking/EventFrame.hpp>
+
+#include <random>
+#include <vector>
+
+using namespace eds::tracking;
+
+namespace
+{
+    /** 40 x 30 pinhole camera without distortion **/
+    ::eds::calib::Camera camera()
+    {
+        ::eds::calib::Camera cam;
+        cam.size = cv::Size(40, 30); cam.out_size = cam.size;
+        cam.K = (cv::Mat_<double>(3, 3) << 30.0, 0.0, 20.0, 0.0, 30.0, 15.0, 0.0, 0.0, 1.0);
+        cam.D = cv::Mat_<double>::zeros(4, 1);
+        cam.R = cv::Mat_<double>::eye(3, 3);
+        return cam;
+    }
+
+    /** Same level 0 as a frame created from scratch with the same window **/
+    void checkAgainstCreate(EventFrame &ef, const EventWindow &window, const uint16_t &decimation = 1)
+    {
+        ::eds::calib::Camera cam = camera();
+        EventFrame reference(cam, cam, "radtan");
+        reference.setIncremental(true);
+        reference.setDecimation(decimation);
+        reference.create(0, window, cam.size.height, cam.size.width, 1);
+
+        const std::vector<double> &expected = reference.level<double>(0);
+        const std::vector<double> &actual = ef.level<double>(0);
+        BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+        for (size_t i=0; i<expected.size(); ++i)
+            BOOST_CHECK_SMALL(actual[i] - expected[i], 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(EventFrameSlide)
+
+BOOST_AUTO_TEST_CASE(slide_equals_create)
+{
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> x(0, 39), y(0, 29), p(0, 1);
+    ::base::samples::EventBatch events;
+    for (int i=0; i<1400; ++i)
+        events.push_back(x(gen), y(gen), i * 10, p(gen));
+
+    ::eds::calib::Camera cam = camera();
+    EventFrame ef(cam, cam, "radtan");
+    ef.setIncremental(true);
+    ef.reserve(400);
+
+    /** Windows of 400 events advancing 100 (the kept events are compacted on the fourth slide) **/
+    size_t begin = 0;
+    ef.create(0, EventWindow(events, 0, 400), cam.size.height, cam.size.width, 1);
+    checkAgainstCreate(ef, EventWindow(events, 0, 400));
+    for (int k=1; k<=5; ++k)
+    {
+        begin += 100;
+        EventWindow window(events, begin, 400);
+        ef.slide(k, window, 100, cam.size.height, cam.size.width, 1);
+        checkAgainstCreate(ef, window);
+    }
+
+    /** A decimated frame is not updated: the next slides rebuild it **/
+    begin += 100;
+    ef.setDecimation(2);
+    ef.slide(6, EventWindow(events, begin, 400), 100, cam.size.height, cam.size.width, 1);
+    checkAgainstCreate(ef, EventWindow(events, begin, 400), 2);
+
+    begin += 100;
+    ef.setDecimation(1);
+    ef.slide(7, EventWindow(events, begin, 400), 100, cam.size.height, cam.size.width, 1);
+    checkAgainstCreate(ef, EventWindow(events, begin, 400));
+
+    /** Incremental again after the rebuild **/
+    begin += 100;
+    ef.slide(8, EventWindow(events, begin, 400), 100, cam.size.height, cam.size.width, 1);
+    checkAgainstCreate(ef, EventWindow(events, begin, 400));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/io/EventLog.h>
+
+#include <cstdio>
+#include <fstream>
+
+using namespace eds::io;
+
+namespace
+{
+    /** Event i of the synthetic log: polarity pattern that is not periodic in 64 **/
+    bool polarity(const size_t &i) {return ((i * 7) % 11) < 5;}
+    int64_t timestamp(const size_t &i) {return 1000 + 3 * i + (i / 100) * 50;}
+}
+
+BOOST_AUTO_TEST_SUITE(EventLogFile)
+
+BOOST_AUTO_TEST_CASE(write_read_round_trip)
+{
+    const std::string filename = "test_event_log.evlog";
+    const size_t num_events = 1000, block_size = 100; // 64-bit word boundaries inside the blocks
+
+    {
+        EventLogWriter writer(filename, 480, 640, block_size);
+        ::base::samples::EventBatch batch;
+        for (size_t i=0; i<num_events/2; ++i)
+            batch.push_back(i % 640, i % 480, timestamp(i), polarity(i));
+        writer.write(batch);
+        for (size_t i=num_events/2; i<num_events; ++i)
+            writer.write(i % 640, i % 480, timestamp(i), polarity(i));
+
+        /** Out of order at a block boundary (the block was just flushed) **/
+        BOOST_CHECK_THROW(writer.write(0, 0, timestamp(num_events - 1) - 1, true), std::runtime_error);
+        writer.close();
+    }
+
+    EventLogReader reader(filename);
+    BOOST_CHECK_EQUAL(reader.height(), 480);
+    BOOST_CHECK_EQUAL(reader.width(), 640);
+    BOOST_CHECK_EQUAL(reader.numEvents(), num_events);
+    BOOST_REQUIRE_EQUAL(reader.numBlocks(), num_events / block_size);
+
+    size_t i = 0;
+    ::base::samples::EventBatch batch;
+    ::base::samples::EventArray array;
+    for (size_t id=0; id<reader.numBlocks(); ++id)
+    {
+        BOOST_CHECK_EQUAL(reader.firstTime(id).toMicroseconds(), timestamp(id * block_size));
+        BOOST_CHECK_EQUAL(reader.lastTime(id).toMicroseconds(), timestamp((id + 1) * block_size - 1));
+
+        reader.read(id, batch);
+        reader.read(id, array);
+        BOOST_REQUIRE_EQUAL(batch.size(), block_size);
+        BOOST_REQUIRE_EQUAL(array.events.size(), block_size);
+        for (size_t k=0; k<block_size; ++k, ++i)
+        {
+            BOOST_CHECK_EQUAL(batch.x[k], i % 640);
+            BOOST_CHECK_EQUAL(batch.y[k], i % 480);
+            BOOST_CHECK_EQUAL(batch.ts[k], timestamp(i));
+            BOOST_CHECK_EQUAL(batch.getPolarity(k), polarity(i));
+            BOOST_CHECK_EQUAL(array.events[k].ts.toMicroseconds(), timestamp(i));
+            BOOST_CHECK_EQUAL((bool)array.events[k].polarity, polarity(i));
+        }
+    }
+
+    /** seek: first block with events at time t or later **/
+    BOOST_CHECK_EQUAL(reader.seek(::base::Time::fromMicroseconds(0)), 0u);
+    BOOST_CHECK_EQUAL(reader.seek(::base::Time::fromMicroseconds(timestamp(99))), 0u);
+    BOOST_CHECK_EQUAL(reader.seek(::base::Time::fromMicroseconds(timestamp(99) + 1)), 1u);
+    BOOST_CHECK_EQUAL(reader.seek(::base::Time::fromMicroseconds(timestamp(550))), 5u);
+    BOOST_CHECK_EQUAL(reader.seek(::base::Time::fromMicroseconds(timestamp(num_events))), reader.numBlocks());
+    BOOST_CHECK_THROW(reader.block(reader.numBlocks()), std::out_of_range);
+
+    std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(corrupted_log)
+{
+    const std::string filename = "test_event_log_corrupted.evlog";
+    {
+        EventLogWriter writer(filename, 480, 640, 64);
+        for (size_t i=0; i<200; ++i)
+            writer.write(i, i, timestamp(i), polarity(i));
+    }
+
+    /** The block offsets of the index point past the truncated blocks **/
+    std::ifstream in(filename, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    const EventLogFileHeader *header = reinterpret_cast<const EventLogFileHeader*>(content.data());
+    const size_t index_offset = header->index_offset, index_size = content.size() - index_offset;
+    std::string truncated = content.substr(0, sizeof(EventLogFileHeader) + 64)
+                            + std::string(8 - (sizeof(EventLogFileHeader) + 64) % 8, '\0')
+                            + content.substr(index_offset, index_size);
+    EventLogFileHeader *truncated_header = reinterpret_cast<EventLogFileHeader*>(&truncated[0]);
+    truncated_header->index_offset = truncated.size() - index_size;
+    std::ofstream(filename, std::ios::binary)<<truncated;
+    BOOST_CHECK_THROW(EventLogReader reader(filename), std::runtime_error);
+
+    /** Block with more events than the index **/
+    std::string inconsistent = content;
+    const EventLogBlockIndex *index = reinterpret_cast<const EventLogBlockIndex*>(inconsistent.data() + index_offset);
+    reinterpret_cast<EventLogBlockHeader*>(&inconsistent[index[1].offset])->num_events += 1;
+    std::ofstream(filename, std::ios::binary)<<inconsistent;
+    BOOST_CHECK_THROW(EventLogReader reader(filename), std::runtime_error);
+
+    std::ofstream(filename, std::ios::binary)<<content;
+    BOOST_CHECK_NO_THROW(EventLogReader reader(filename));
+
+    std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
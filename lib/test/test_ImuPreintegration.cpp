@@ -0,0 +1,75 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/tracking/ImuPreintegration.hpp>
+
+#include <cmath>
+
+using namespace eds::tracking;
+
+BOOST_AUTO_TEST_SUITE(ImuPreintegrationPrior)
+
+BOOST_AUTO_TEST_CASE(constant_rate_rotation)
+{
+    /** Camera rotated 90 degrees about the IMU z-axis **/
+    Eigen::Matrix3d R_cam_imu = Eigen::AngleAxisd(M_PI/2.0, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+    ImuPreintegration imu(R_cam_imu);
+    imu.gyro_bias = Eigen::Vector3d(0.01, -0.02, 0.005);
+
+    const Eigen::Vector3d rate(0.3, -0.2, 0.5);
+    const base::Time start = base::Time::fromSeconds(10.0);
+    imu.reset(start);
+
+    /** 200 Hz samples, the integration ends between two samples **/
+    for (int k=0; k<=20; ++k)
+    {
+        base::samples::IMUSensors sample;
+        sample.time = start + base::Time::fromSeconds(k * 0.005);
+        sample.gyro = rate + imu.gyro_bias;
+        sample.acc = Eigen::Vector3d(0.0, 0.0, 9.81);
+        sample.mag.setZero();
+        imu.integrate(sample);
+    }
+    imu.integrateUntil(start + base::Time::fromSeconds(0.1025));
+    BOOST_CHECK_SMALL(imu.dt() - 0.1025, 1e-06);
+
+    /** Constant rate: delta_R = Exp(w * t) **/
+    const Eigen::Matrix3d R_expected = ImuPreintegration::expSO3(rate * imu.dt());
+    BOOST_CHECK_SMALL((imu.delta_R - R_expected).norm(), 1e-09);
+
+    const Eigen::Quaterniond q_cam(R_cam_imu * R_expected * R_cam_imu.transpose());
+    BOOST_CHECK_SMALL(imu.deltaRotationCam().angularDistance(q_cam), 1e-09);
+    BOOST_CHECK_SMALL((imu.angularVelocityCam() - R_cam_imu * rate).norm(), 1e-09);
+
+    /** Gravity only: delta_v = delta_R integral of a **/
+    BOOST_CHECK(imu.delta_v.norm() > 0.9);
+    BOOST_CHECK(imu.covarianceCam().trace() > 0.0);
+
+    /** Reset keeps the last sample for the next integration **/
+    imu.reset(imu.end_time);
+    BOOST_CHECK_EQUAL(imu.dt(), 0.0);
+    BOOST_CHECK_SMALL((imu.delta_R - Eigen::Matrix3d::Identity()).norm(), 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(rotation_prior_residual)
+{
+    const Eigen::Quaterniond q_prior(Eigen::AngleAxisd(0.2, Eigen::Vector3d(0.1, 0.7, -0.3).normalized()));
+    const Eigen::Matrix3d sqrt_info = 10.0 * Eigen::Matrix3d::Identity();
+    std::unique_ptr<ceres::CostFunction> prior(RotationPrior::Create(q_prior, sqrt_info));
+
+    /** Zero at the prior, also with the opposite sign of the quaternion **/
+    Eigen::Quaterniond q = q_prior;
+    const double *params[1] = {q.coeffs().data()};
+    double r[3];
+    BOOST_REQUIRE(prior->Evaluate(params, r, nullptr));
+    BOOST_CHECK_SMALL(Eigen::Map<Eigen::Vector3d>(r).norm(), 1e-12);
+    q.coeffs() = -q.coeffs();
+    BOOST_REQUIRE(prior->Evaluate(params, r, nullptr));
+    BOOST_CHECK_SMALL(Eigen::Map<Eigen::Vector3d>(r).norm(), 1e-12);
+
+    /** Small rotation error: residual ~ sqrt_info * angle * axis **/
+    const Eigen::Vector3d delta(0.001, -0.002, 0.0015);
+    q = Eigen::Quaterniond(ImuPreintegration::expSO3(delta)) * q_prior;
+    BOOST_REQUIRE(prior->Evaluate(params, r, nullptr));
+    BOOST_CHECK_SMALL((Eigen::Map<Eigen::Vector3d>(r) - 10.0 * delta).norm(), 1e-08);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
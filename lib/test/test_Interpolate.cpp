@@ -0,0 +1,53 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/utils/Interpolate.hpp>
+#include <ceres/cubic_interpolation.h>
+
+#include <random>
+#include <vector>
+#include <cmath>
+
+using namespace eds::utils;
+
+BOOST_AUTO_TEST_SUITE(Interpolate)
+
+BOOST_AUTO_TEST_CASE(bicubic_sampler_equals_ceres)
+{
+    const int rows = 37, cols = 53;
+    std::vector<double> img(rows * cols);
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    for (auto &v : img)
+        v = value(gen);
+
+    ceres::Grid2D<double, 1> grid(img.data(), 0, rows, 0, cols);
+    ceres::BiCubicInterpolator< ceres::Grid2D<double, 1> > interp(grid);
+    BicubicSampler<double> sampler(img.data(), rows, cols);
+
+    /** Interior, border and out of the image points **/
+    const size_t n = 2000;
+    std::uniform_real_distribution<double> r_dist(-3.0, rows + 2.0), c_dist(-3.0, cols + 2.0);
+    std::vector<double> r(n), c(n), f(n), dfdr(n), dfdc(n);
+    for (size_t i=0; i<n; ++i)
+    {
+        r[i] = r_dist(gen); c[i] = c_dist(gen);
+    }
+    r[0] = 0.0; c[0] = 0.0; r[1] = rows - 1; c[1] = cols - 1; r[2] = 10.0; c[2] = 20.0;
+
+    sampler.evaluate(n, r.data(), c.data(), f.data(), dfdr.data(), dfdc.data());
+    for (size_t i=0; i<n; ++i)
+    {
+        double f_ref, dfdr_ref, dfdc_ref;
+        interp.Evaluate(r[i], c[i], &f_ref, &dfdr_ref, &dfdc_ref);
+        BOOST_CHECK_SMALL(f[i] - f_ref, 1e-12);
+        BOOST_CHECK_SMALL(dfdr[i] - dfdr_ref, 1e-12);
+        BOOST_CHECK_SMALL(dfdc[i] - dfdc_ref, 1e-12);
+    }
+
+    /** Values only **/
+    std::vector<double> f_only(n);
+    sampler.evaluate(n, r.data(), c.data(), f_only.data(), nullptr, nullptr);
+    for (size_t i=0; i<n; ++i)
+        BOOST_CHECK_EQUAL(f[i], f_only[i]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,253 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/tracking/PhotometricError.hpp>
+#include <eds/tracking/PhotometricErrorAnalytic.hpp>
+
+#include <random>
+#include <cmath>
+#include <set>
+
+using namespace eds::tracking;
+
+namespace
+{
+    /** Smooth event frame and n random keyframe points **/
+    struct TrackingFixture
+    {
+        std::vector<double> event_frame;
+        std::vector<cv::Point2d> grad, norm_coord;
+        std::vector<double> idp, weights;
+
+        TrackingFixture(const int &height, const int &width, const int &n, const unsigned int &seed)
+        :event_frame(height * width), grad(n), norm_coord(n), idp(n), weights(n)
+        {
+            for (int y=0; y<height; ++y)
+                for (int x=0; x<width; ++x)
+                    event_frame[y*width + x] = std::sin(0.2*x) * std::cos(0.15*y) + 0.01*x;
+
+            std::mt19937 gen(seed);
+            std::uniform_real_distribution<double> coord(-0.3, 0.3), inv_depth(0.2, 1.0), gradient(-1.0, 1.0), weight(0.5, 1.0);
+            for (int i=0; i<n; ++i)
+            {
+                grad[i] = cv::Point2d(gradient(gen), gradient(gen));
+                norm_coord[i] = cv::Point2d(coord(gen), coord(gen));
+                idp[i] = inv_depth(gen);
+                weights[i] = weight(gen);
+            }
+        }
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(PhotometricErrorJacobians)
+
+BOOST_AUTO_TEST_CASE(analytic_equals_autodiff)
+{
+    const int height = 60, width = 80, n = 200;
+    const double fx = 100.0, fy = 110.0, cx = 40.0, cy = 30.0;
+    TrackingFixture fixture(height, width, n, 42);
+    const std::vector<double> &event_frame = fixture.event_frame;
+    const std::vector<cv::Point2d> &grad = fixture.grad, &norm_coord = fixture.norm_coord;
+    const std::vector<double> &idp = fixture.idp, &weights = fixture.weights;
+
+    /** Parameters: px, qx (x, y, z, w) and unit norm vx **/
+    Eigen::Vector3d px(0.02, -0.01, 0.03);
+    Eigen::Quaterniond qx(Eigen::AngleAxisd(0.05, Eigen::Vector3d(0.3, -0.5, 0.8).normalized()));
+    Eigen::Matrix<double, 6, 1> vx; vx << 0.3, -0.2, 0.5, 0.1, -0.4, 0.2;
+    vx.normalize();
+    const double *params[3] = {px.data(), qx.coeffs().data(), vx.data()};
+
+    /** Both cost functions on a block starting in the middle of the points **/
+    const int start = 50, num = 120;
+    std::unique_ptr<ceres::CostFunction> autodiff(PhotometricError::Create(&grad, &norm_coord, &idp, &weights,
+                                    &event_frame, height, width, fx, fy, cx, cy, start, num));
+    std::unique_ptr<ceres::CostFunction> analytic(PhotometricErrorAnalytic::Create(&grad, &norm_coord, &idp, &weights,
+                                    &event_frame, height, width, fx, fy, cx, cy, start, num));
+    BOOST_REQUIRE_EQUAL(autodiff->num_residuals(), analytic->num_residuals());
+    BOOST_REQUIRE(autodiff->parameter_block_sizes() == analytic->parameter_block_sizes());
+
+    const int sizes[3] = {3, 4, 6};
+    std::vector<double> res_a(num), res_b(num);
+    std::vector<double> jac_a[3], jac_b[3];
+    double *ptr_a[3], *ptr_b[3];
+    for (int k=0; k<3; ++k)
+    {
+        jac_a[k].resize(num * sizes[k]); ptr_a[k] = jac_a[k].data();
+        jac_b[k].resize(num * sizes[k]); ptr_b[k] = jac_b[k].data();
+    }
+
+    BOOST_REQUIRE(autodiff->Evaluate(params, res_a.data(), ptr_a));
+    BOOST_REQUIRE(analytic->Evaluate(params, res_b.data(), ptr_b));
+
+    for (int i=0; i<num; ++i)
+        BOOST_CHECK_SMALL(res_a[i] - res_b[i], 1e-12);
+
+    for (int k=0; k<3; ++k)
+    {
+        double max_value = 0.0, max_diff = 0.0;
+        for (size_t i=0; i<jac_a[k].size(); ++i)
+        {
+            max_value = std::max(max_value, std::abs(jac_a[k][i]));
+            max_diff = std::max(max_diff, std::abs(jac_a[k][i] - jac_b[k][i]));
+        }
+        BOOST_CHECK(max_value > 0.0);
+        BOOST_CHECK_SMALL(max_diff / max_value, 1e-10);
+    }
+
+    /** Residuals only (no Jacobians) **/
+    std::vector<double> res_c(num);
+    BOOST_REQUIRE(analytic->Evaluate(params, res_c.data(), nullptr));
+    for (int i=0; i<num; ++i)
+        BOOST_CHECK_SMALL(res_a[i] - res_c[i], 1e-12);
+
+    /** Keyframe cache shared by the blocks gives the same residuals **/
+    TrackingCache cache;
+    cache.build(grad, norm_coord, idp, weights);
+    BOOST_REQUIRE_EQUAL(cache.size(), (size_t)n);
+    std::unique_ptr<ceres::CostFunction> cached(PhotometricErrorAnalytic::Create(&cache,
+                                    &event_frame, height, width, fx, fy, cx, cy, start, num));
+    std::vector<double> res_d(num);
+    BOOST_REQUIRE(cached->Evaluate(params, res_d.data(), nullptr));
+    for (int i=0; i<num; ++i)
+        BOOST_CHECK_EQUAL(res_c[i], res_d[i]);
+
+    /** Fast bicubic sampler instead of the ceres interpolator **/
+    std::unique_ptr<ceres::CostFunction> fast(PhotometricErrorAnalytic::Create(&cache,
+                                    &event_frame, height, width, fx, fy, cx, cy, start, num, eds::utils::FAST_BICUBIC));
+    std::vector<double> res_e(num), jac_e[3];
+    double *ptr_e[3];
+    for (int k=0; k<3; ++k)
+    {
+        jac_e[k].resize(num * sizes[k]); ptr_e[k] = jac_e[k].data();
+    }
+    BOOST_REQUIRE(fast->Evaluate(params, res_e.data(), ptr_e));
+    for (int i=0; i<num; ++i)
+        BOOST_CHECK_SMALL(res_b[i] - res_e[i], 1e-12);
+    for (int k=0; k<3; ++k)
+        for (size_t i=0; i<jac_e[k].size(); ++i)
+            BOOST_CHECK_SMALL(jac_b[k][i] - jac_e[k][i], 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(global_norm_is_deterministic)
+{
+    const int height = 60, width = 80, n = 3000;
+    const double fx = 100.0, fy = 110.0, cx = 40.0, cy = 30.0;
+    TrackingFixture fixture(height, width, n, 7);
+    const std::vector<double> &event_frame = fixture.event_frame;
+    TrackingCache cache;
+    cache.build(fixture.grad, fixture.norm_coord, fixture.idp, fixture.weights);
+
+    Eigen::Vector3d px(0.01, 0.02, -0.02);
+    Eigen::Quaterniond qx(Eigen::AngleAxisd(0.03, Eigen::Vector3d(-0.2, 0.6, 0.4).normalized()));
+    Eigen::Matrix<double, 6, 1> vx; vx << -0.1, 0.4, 0.3, 0.2, 0.1, -0.5;
+    vx.normalize();
+    const double *params[3] = {px.data(), qx.coeffs().data(), vx.data()};
+
+    /** One block with all the points (several chunks) in this thread and in the pool **/
+    BOOST_REQUIRE(n > PhotometricErrorAnalytic::CHUNK_SIZE);
+    std::unique_ptr<ceres::CostFunction> sequential(PhotometricErrorAnalytic::Create(&cache,
+                                    &event_frame, height, width, fx, fy, cx, cy, 0, n));
+    std::unique_ptr<ceres::CostFunction> autodiff(PhotometricError::Create(&cache,
+                                    &event_frame, height, width, fx, fy, cx, cy, 0, n));
+
+    const int sizes[3] = {3, 4, 6};
+    std::vector<double> res_a(n), res_b(n), res_c(n), jac_a[3], jac_b[3];
+    double *ptr_a[3], *ptr_b[3];
+    for (int k=0; k<3; ++k)
+    {
+        jac_a[k].resize(n * sizes[k]); ptr_a[k] = jac_a[k].data();
+        jac_b[k].resize(n * sizes[k]); ptr_b[k] = jac_b[k].data();
+    }
+
+    BOOST_REQUIRE(sequential->Evaluate(params, res_a.data(), ptr_a));
+
+    /** Same bits with any number of threads (options.num_threads of the pool) **/
+    for (const int num_threads : {1, 2, 3, NUM_THREADS, 2 * NUM_THREADS})
+    {
+        ::dso::IndexThreadReduce<double> thread_reduce(num_threads);
+
+        /** The pool only runs num_threads workers (at most NUM_THREADS) **/
+        boost::mutex mutex;
+        std::set<int> workers;
+        thread_reduce.reduce([&mutex, &workers](int, int, double*, int tid)
+        {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            workers.insert(tid);
+        }, 0, 100, 1);
+        BOOST_CHECK_LT(*workers.rbegin(), std::min(num_threads, NUM_THREADS));
+
+        std::unique_ptr<ceres::CostFunction> parallel(PhotometricErrorAnalytic::Create(&cache,
+                                        &event_frame, height, width, fx, fy, cx, cy, 0, n, eds::utils::CERES_BICUBIC, &thread_reduce));
+        for (int trial=0; trial<3; ++trial)
+        {
+            BOOST_REQUIRE(parallel->Evaluate(params, res_b.data(), ptr_b));
+            for (int i=0; i<n; ++i)
+                BOOST_REQUIRE_EQUAL(res_a[i], res_b[i]);
+            for (int k=0; k<3; ++k)
+                for (size_t i=0; i<jac_a[k].size(); ++i)
+                    BOOST_REQUIRE_EQUAL(jac_a[k][i], jac_b[k][i]);
+        }
+    }
+
+    /** Same model as the autodiff single block **/
+    BOOST_REQUIRE(autodiff->Evaluate(params, res_c.data(), nullptr));
+    for (int i=0; i<n; ++i)
+        BOOST_CHECK_SMALL(res_a[i] - res_c[i], 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(float_event_frame)
+{
+    const int height = 60, width = 80, n = 500;
+    const double fx = 100.0, fy = 110.0, cx = 40.0, cy = 30.0;
+    TrackingFixture fixture(height, width, n, 3);
+    TrackingCache cache;
+    cache.build(fixture.grad, fixture.norm_coord, fixture.idp, fixture.weights);
+
+    /** Same event frame in double and in single precision **/
+    const std::vector<double> &event_frame = fixture.event_frame;
+    std::vector<float> event_frame_f(event_frame.begin(), event_frame.end());
+
+    Eigen::Vector3d px(-0.01, 0.02, 0.01);
+    Eigen::Quaterniond qx(Eigen::AngleAxisd(0.04, Eigen::Vector3d(0.5, 0.2, -0.6).normalized()));
+    Eigen::Matrix<double, 6, 1> vx; vx << 0.2, 0.1, -0.3, 0.4, 0.2, 0.1;
+    vx.normalize();
+    const double *params[3] = {px.data(), qx.coeffs().data(), vx.data()};
+
+    const int sizes[3] = {3, 4, 6};
+    for (int interp=0; interp<2; ++interp)
+    {
+        const eds::utils::INTERPOLATOR_TYPE type = (interp == 0)? eds::utils::CERES_BICUBIC : eds::utils::FAST_BICUBIC;
+        std::unique_ptr<ceres::CostFunction> cost_d(PhotometricErrorAnalytic::Create(&cache,
+                                        &event_frame, height, width, fx, fy, cx, cy, 0, n, type));
+        std::unique_ptr<ceres::CostFunction> cost_f(PhotometricErrorAnalyticf::Create(&cache,
+                                        &event_frame_f, height, width, fx, fy, cx, cy, 0, n, type));
+
+        std::vector<double> res_d(n), res_f(n), jac_d[3], jac_f[3];
+        double *ptr_d[3], *ptr_f[3];
+        for (int k=0; k<3; ++k)
+        {
+            jac_d[k].resize(n * sizes[k]); ptr_d[k] = jac_d[k].data();
+            jac_f[k].resize(n * sizes[k]); ptr_f[k] = jac_f[k].data();
+        }
+        BOOST_REQUIRE(cost_d->Evaluate(params, res_d.data(), ptr_d));
+        BOOST_REQUIRE(cost_f->Evaluate(params, res_f.data(), ptr_f));
+
+        /** Only the event frame samples are rounded (float epsilon) **/
+        for (int i=0; i<n; ++i)
+            BOOST_CHECK_SMALL(res_d[i] - res_f[i], 1e-06);
+        for (int k=0; k<3; ++k)
+            for (size_t i=0; i<jac_d[k].size(); ++i)
+                BOOST_CHECK_SMALL(jac_d[k][i] - jac_f[k][i], 1e-04);
+    }
+
+    /** Autodiff in single precision **/
+    std::unique_ptr<ceres::CostFunction> autodiff_f(PhotometricErrorf::Create(&cache,
+                                    &event_frame_f, height, width, fx, fy, cx, cy, 0, n));
+    std::unique_ptr<ceres::CostFunction> autodiff_d(PhotometricError::Create(&cache,
+                                    &event_frame, height, width, fx, fy, cx, cy, 0, n));
+    std::vector<double> res_a(n), res_b(n);
+    BOOST_REQUIRE(autodiff_d->Evaluate(params, res_a.data(), nullptr));
+    BOOST_REQUIRE(autodiff_f->Evaluate(params, res_b.data(), nullptr));
+    for (int i=0; i<n; ++i)
+        BOOST_CHECK_SMALL(res_a[i] - res_b[i], 1e-06);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
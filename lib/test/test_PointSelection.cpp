@@ -0,0 +1,81 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/tracking/PointSelection.hpp>
+
+#include <Eigen/Eigenvalues>
+#include <random>
+#include <numeric>
+
+using namespace eds::tracking;
+
+/** Minimum eigenvalue of the information of the points (velocity Jacobians) **/
+static double minInformation(const TrackingCache &cache, const std::vector<int> &indices)
+{
+    Eigen::Matrix<double, 6, 6> H = Eigen::Matrix<double, 6, 6>::Zero();
+    for (auto i : indices)
+    {
+        Eigen::Matrix<double, 6, 1> j;
+        for (int k=0; k<6; ++k) j[k] = cache.weights[i] * cache.coeff[k][i];
+        H += j * j.transpose();
+    }
+    return Eigen::SelfAdjointEigenSolver< Eigen::Matrix<double, 6, 6> >(H).eigenvalues()[0];
+}
+
+BOOST_AUTO_TEST_SUITE(PointSelection)
+
+BOOST_AUTO_TEST_CASE(information_budget_with_buckets)
+{
+    const int width = 640, height = 480, n = 6000;
+    const double fx = 500.0, fy = 500.0, cx = 320.0, cy = 240.0;
+
+    /** Most of the points in the top left corner with vertical gradients,
+     * the rest of the image has few points with random gradients **/
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> unit(0.0, 1.0), inv_depth(0.2, 1.0), gradient(-1.0, 1.0);
+    std::vector<cv::Point2d> coord(n), grad(n), norm_coord(n);
+    std::vector<double> idp(n), weights(n, 1.0);
+    for (int i=0; i<n; ++i)
+    {
+        const bool corner = (i % 10) != 0;
+        coord[i] = (corner)? cv::Point2d(unit(gen) * width/4, unit(gen) * height/4) : cv::Point2d(unit(gen) * width, unit(gen) * height);
+        grad[i] = (corner)? cv::Point2d(0.05 * gradient(gen), 1.0) : cv::Point2d(gradient(gen), gradient(gen));
+        norm_coord[i] = cv::Point2d((coord[i].x - cx)/fx, (coord[i].y - cy)/fy);
+        idp[i] = inv_depth(gen);
+    }
+    TrackingCache cache;
+    cache.build(grad, norm_coord, idp, weights);
+
+    /** Leverages add up to the number of parameters **/
+    std::vector<double> scores = informationScores(cache);
+    BOOST_CHECK_CLOSE(std::accumulate(scores.begin(), scores.end(), 0.0), 6.0, 1e-03);
+
+    const size_t budget = n/3;
+    std::vector<int> selected = selectPoints(scores, coord, cv::Size(width, height), budget, 8, 6);
+    BOOST_REQUIRE_EQUAL(selected.size(), budget);
+    BOOST_CHECK(std::is_sorted(selected.begin(), selected.end()));
+    BOOST_CHECK(std::adjacent_find(selected.begin(), selected.end()) == selected.end());
+
+    /** Every bucket with points gives points **/
+    std::vector<int> all_buckets(48, 0), selected_buckets(48, 0);
+    auto bucket = [&](const cv::Point2d &p) { return std::min((int)(p.y * 6 / height), 5) * 8 + std::min((int)(p.x * 8 / width), 7); };
+    for (int i=0; i<n; ++i) all_buckets[bucket(coord[i])]++;
+    for (auto i : selected) selected_buckets[bucket(coord[i])]++;
+    for (int b=0; b<48; ++b)
+        BOOST_CHECK(all_buckets[b] == 0 || selected_buckets[b] > 0);
+
+    /** Better conditioned than the same number of the first points **/
+    std::vector<int> first(budget);
+    std::iota(first.begin(), first.end(), 0);
+    BOOST_CHECK(minInformation(cache, selected) > minInformation(cache, first));
+
+    /** Small sets are kept **/
+    BOOST_CHECK_EQUAL(selectPoints(scores, coord, cv::Size(width, height), n).size(), (size_t)n);
+
+    /** The cache keeps the selected points in order **/
+    TrackingCache reduced = cache;
+    reduced.select(selected);
+    BOOST_REQUIRE_EQUAL(reduced.size(), budget);
+    for (size_t k=0; k<budget; ++k)
+        BOOST_CHECK_EQUAL(reduced.coeff[3][k], cache.coeff[3][selected[k]]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
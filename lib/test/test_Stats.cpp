@@ -0,0 +1,82 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/utils/Stats.hpp>
+
+#include <sstream>
+
+using namespace eds::utils;
+
+BOOST_AUTO_TEST_SUITE(StageStatistics)
+
+BOOST_AUTO_TEST_CASE(log2_bins)
+{
+    BOOST_CHECK_EQUAL(RollingHistogram::bin(0.0), 0);
+    BOOST_CHECK_EQUAL(RollingHistogram::bin(0.5), 0);
+    BOOST_CHECK_EQUAL(RollingHistogram::bin(1.0), 1);
+    BOOST_CHECK_EQUAL(RollingHistogram::bin(3.9), 2);
+    BOOST_CHECK_EQUAL(RollingHistogram::bin(4.0), 3);
+    BOOST_CHECK_EQUAL(RollingHistogram::bin(1e12), RollingHistogram::NUM_BINS - 1);
+}
+
+BOOST_AUTO_TEST_CASE(rolling_window_percentiles)
+{
+    /** 1..100 in a window of 50: the first 50 samples are out **/
+    RollingHistogram hist(50);
+    for (int k=1; k<=100; ++k)
+        hist.add(static_cast<double>(k));
+
+    StageStats s = hist.summary("stage");
+    BOOST_CHECK_EQUAL(s.count, 100u);
+    BOOST_CHECK_EQUAL(s.window, 50u);
+    BOOST_CHECK_EQUAL(s.total, 5050.0);
+    BOOST_CHECK_EQUAL(s.last, 100.0);
+    BOOST_CHECK_EQUAL(s.min, 51.0);
+    BOOST_CHECK_EQUAL(s.max, 100.0);
+    BOOST_CHECK_CLOSE(s.mean, 75.5, 1e-09);
+    BOOST_CHECK_EQUAL(s.p50, 76.0);
+    BOOST_CHECK_EQUAL(s.p90, 96.0);
+    BOOST_CHECK_EQUAL(s.p99, 100.0);
+
+    /** [32, 64) and [64, 128) **/
+    BOOST_CHECK_EQUAL(s.histogram[6], 13u);
+    BOOST_CHECK_EQUAL(s.histogram[7], 37u);
+}
+
+BOOST_AUTO_TEST_CASE(stage_timers_output)
+{
+    StageTimers timers(8);
+    timers.add("tracking", 100.0);
+    timers.add("event_frame", 10.0);
+    timers.add("tracking", 300.0);
+    {
+        ScopedTimer timer(timers, "scoped");
+        BOOST_CHECK_GE(timer.stop(), 0.0);
+    }
+
+    /** Stages in order of the first sample, scoped recorded once **/
+    std::vector<StageStats> stats = timers.summary();
+    BOOST_REQUIRE_EQUAL(stats.size(), 3u);
+    BOOST_CHECK_EQUAL(stats[0].name, "tracking");
+    BOOST_CHECK_EQUAL(stats[0].count, 2u);
+    BOOST_CHECK_EQUAL(stats[0].mean, 200.0);
+    BOOST_CHECK_EQUAL(stats[1].name, "event_frame");
+    BOOST_CHECK_EQUAL(stats[2].count, 1u);
+
+    std::ostringstream csv;
+    StageTimers::writeCSV(csv, stats);
+    std::string line;
+    std::istringstream lines(csv.str());
+    std::getline(lines, line);
+    BOOST_CHECK_EQUAL(line.compare(0, 20, "stage,count,window,t"), 0);
+    std::getline(lines, line);
+    BOOST_CHECK_EQUAL(line.compare(0, 19, "tracking,2,2,400,30"), 0);
+
+    std::ostringstream json;
+    StageTimers::writeJSON(json, stats);
+    BOOST_CHECK(json.str().find("\"name\": \"event_frame\", \"count\": 1") != std::string::npos);
+    BOOST_CHECK(json.str().find("\"unit\": \"us\"") != std::string::npos);
+
+    timers.clear();
+    BOOST_CHECK(timers.summary().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,105 @@
+#include <boost/test/unit_test.hpp>
+#include <eds/tracking/TimeSurface.hpp>
+
+#include <random>
+#include <vector>
+
+using namespace eds::tracking;
+
+namespace
+{
+    struct SurfaceEvent
+    {
+        double x, y;
+        int8_t value;
+        int64_t ts;
+    };
+
+    /** Brute-force decayed sum at time ts: every event is decayed from its own
+     * time stamp and voted bilinearly. abs_sum is the sum of the absolute votes **/
+    void decayedSum(const std::vector<SurfaceEvent> &events, const int &height, const int &width,
+                    const double &decay, const int64_t &ts, std::vector<double> &sum, std::vector<double> &abs_sum)
+    {
+        sum.assign(height * width, 0.0); abs_sum.assign(height * width, 0.0);
+        for (const SurfaceEvent &ev : events)
+        {
+            const double w = ev.value * std::exp(-(ts - ev.ts) / decay);
+            const int x0 = std::floor(ev.x), y0 = std::floor(ev.y);
+            const double dx = ev.x - x0, dy = ev.y - y0;
+            const int idx[4] = {y0 * width + x0, (y0 + 1) * width + x0, y0 * width + x0 + 1, (y0 + 1) * width + x0 + 1};
+            const double b[4] = {(1.0 - dx) * (1.0 - dy), (1.0 - dx) * dy, dx * (1.0 - dy), dx * dy};
+            for (int k=0; k<4; ++k)
+            {
+                sum[idx[k]] += w * b[k];
+                abs_sum[idx[k]] += std::abs(w * b[k]);
+            }
+        }
+    }
+
+    void checkSurface(const TimeSurface &surface, const std::vector<SurfaceEvent> &events,
+                    const int &height, const int &width, const double &decay, const int64_t &ts)
+    {
+        std::vector<double> expected, magnitude;
+        decayedSum(events, height, width, decay, ts, expected, magnitude);
+
+        cv::Mat img;
+        surface.query(ts, img);
+        BOOST_REQUIRE_EQUAL(img.rows, height);
+        BOOST_REQUIRE_EQUAL(img.cols, width);
+        for (int row=0; row<height; ++row)
+        {
+            const double *values = img.ptr<double>(row);
+            for (int col=0; col<width; ++col)
+                BOOST_CHECK_SMALL(values[col] - expected[row * width + col], 1e-12 + 1e-9 * magnitude[row * width + col]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(TimeSurfaceDecay)
+
+BOOST_AUTO_TEST_CASE(equals_decayed_sum)
+{
+    const int height = 12, width = 16;
+    const double decay = 200.0; // [us]
+    TimeSurface surface(height, width, decay);
+    BOOST_CHECK(surface.empty());
+
+    /** Empty surface is zero **/
+    cv::Mat img;
+    surface.query(1000, img);
+    for (int row=0; row<height; ++row)
+        for (int col=0; col<width; ++col)
+            BOOST_CHECK_EQUAL(img.ptr<double>(row)[col], 0.0);
+
+    /** 30 ms of events: the exponent reaches 150, the reference time
+     * moves forward several times (max_exponent is 30) **/
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> x(0.0, width - 1.001), y(0.0, height - 1.001);
+    std::uniform_int_distribution<int> p(0, 1), dt(0, 60);
+    std::vector<SurfaceEvent> events;
+    int64_t ts = 500;
+    for (int i=0; i<1000; ++i)
+    {
+        ts += dt(gen);
+        SurfaceEvent ev = {x(gen), y(gen), static_cast<int8_t>((p(gen))? 1 : -1), ts};
+        surface.add(ev.x, ev.y, ev.value, ev.ts);
+        events.push_back(ev);
+
+        /** Queries before and after the rebases **/
+        if (i % 97 == 0)
+            checkSurface(surface, events, height, width, decay, ts);
+    }
+    BOOST_REQUIRE_GT((ts - 500) / decay, 4.0 * TimeSurface::max_exponent);
+    checkSurface(surface, events, height, width, decay, ts);
+    checkSurface(surface, events, height, width, decay, ts + 150);
+
+    /** Reset: empty again and the next event is the new reference **/
+    surface.reset();
+    BOOST_CHECK(surface.empty());
+    events.clear();
+    events.push_back({3.5, 4.25, 1, ts + 10000});
+    surface.add(3.5, 4.25, 1, ts + 10000);
+    checkSurface(surface, events, height, width, decay, ts + 10100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
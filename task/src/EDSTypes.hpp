@@ -26,6 +26,7 @@
 #include <eds/mapping/Config.hpp>
 #include <eds/bundles/Config.hpp>
 #include <eds/utils/Config.hpp>
+#include <eds/utils/BoundedQueue.hpp>
 
 #include <base/Time.hpp>
 #include <base/samples/RigidBodyState.hpp>
@@ -39,10 +40,42 @@
 
 namespace eds {
 
+    /** Event windowing: how many events go in an event frame
+     * COUNT: fixed number of events (num_events)
+     * DURATION: events in a fixed time span (duration), at most max_events
+     * HYBRID: at least the duration with [min_events, max_events] events
+     * ADAPTIVE: number of events from the event rate to track at target_rate
+     * (or slower when the tracker solve time does not allow it) **/
+    enum WINDOW_MODE{COUNT, DURATION, HYBRID, ADAPTIVE};
+
     struct DataLoaderConfig
     {
+        WINDOW_MODE mode;
         size_t num_events;
         double overlap;
+        ::base::Time duration;
+        size_t min_events;
+        size_t max_events;
+        double target_rate; // [Hz]
+        /** Event rate budget: decimate the events above it [events/s] **/
+        double max_event_rate;
+        /** Threads accumulating the events in the event frame **/
+        uint16_t accumulate_threads;
+        /** Threads building the event frame pyramid levels **/
+        uint16_t level_threads;
+        /** Incremental event frame for overlapping windows (uniform time weights) **/
+        bool incremental;
+        /** Event frame pyramid levels **/
+        ::eds::tracking::PYRAMID_MODE pyramid;
+        /** Time surface decay (zero: windows of events) and event frame rate [Hz] **/
+        ::base::Time surface_decay;
+        double surface_rate;
+        /** Event pre-filter **/
+        ::eds::tracking::EventFilterConfig filter;
+        /** Asynchronous input: queue size (per input) and policy when full **/
+        bool async;
+        size_t queue_size;
+        ::eds::utils::QUEUE_POLICY queue_policy;
     };
 
     struct EDSConfiguration
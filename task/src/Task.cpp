@@ -32,100 +32,322 @@ using namespace eds;
 #define DEBUG_PRINTS 1
 
 Task::Task(std::string const& name)
+:input_running(false)
 {
+    this->event_queue_stats = this->frame_queue_stats = ::eds::utils::QueueStats{0, 0, 0, 0, 0, 0};
+    this->filter_info = ::eds::tracking::EventFilterInfo{0, 0, 0, 0, 0};
 }
 
 Task::~Task()
 {
+    /** The processing thread uses this task **/
+    this->stopInput();
 }
 
 void Task::eventsCallback(const base::Time &ts, const ::base::samples::EventArray &events_sample)
 {
-    /** Insert Events into the buffer **/
-    this->events.insert(this->events.end(), events_sample.events.begin(), events_sample.events.end());
+    /** Asynchronous: queue the events (columnar, the only conversion) for the processing thread **/
+    if (this->event_queue)
+    {
+        ::base::samples::EventBatch item = ::base::samples::EventBatch::fromEventArray(events_sample);
+        if (this->event_queue->push(std::move(item)))
+            this->notifyInput();
+        return;
+    }
+
+    /** Filter and insert Events into the buffer **/
+    if (this->event_filter)
+    {
+        this->filter_events = events_sample.events;
+        this->event_filter->filter(this->filter_events);
+        this->events.push(this->filter_events);
+    }
+    else
+        this->events.push(events_sample.events);
+
+    return this->processEvents();
+}
+
+void Task::imuCallback(const base::Time &ts, const ::base::samples::IMUSensors &imu_sample)
+{
+    if (!this->eds_config.tracker.imu.enabled)
+        return;
+
+    /** Integrated with the next event frame (processing thread) **/
+    boost::unique_lock<boost::mutex> lock(this->imu_mutex);
+    this->imu_samples.push_back(imu_sample);
+    this->imu_samples.back().time = ts;
+}
+
+void Task::eventsCallback(const base::Time &ts, const ::base::samples::EventBatch &events_sample)
+{
+    /** Asynchronous: the batch is queued as it is (the ring buffer is columnar) **/
+    if (this->event_queue)
+    {
+        ::base::samples::EventBatch item = events_sample;
+        if (this->event_queue->push(std::move(item)))
+            this->notifyInput();
+        return;
+    }
 
-    /** Create an event frame **/
-    if (this->events.size() >= this->eds_config.data_loader.num_events)
+    /** Filter and insert Events into the buffer **/
+    if (this->event_filter)
     {
+        this->filter_batch = events_sample;
+        this->event_filter->filter(this->filter_batch);
+        this->events.push(this->filter_batch);
+    }
+    else
+        this->events.push(events_sample);
+
+    return this->processEvents();
+}
+
+void Task::processEvents()
+{
+    ::eds::utils::ScopedTimer timer(this->stage_timers, "process_events");
+
+    /** Time surface: event frames at a fixed rate, independent of the windows **/
+    if (this->eds_config.data_loader.surface_decay.toMicroseconds() > 0)
+        return this->processTimeSurface();
+
+    /** Create an event frame for each complete window **/
+    size_t num_events = 0;
+    while ((num_events = this->windowSize()) > 0)
+    {
+        /** Window of events (no copy) **/
+        ::eds::tracking::EventWindow ef_events = this->events.window(num_events);
+
+        /** Event rate estimate (for the adaptive window) **/
+        double ef_span = (ef_events.back().ts - ef_events.front().ts).toSeconds();
+        if (ef_span > 0.0)
+            this->event_rate = (this->event_rate > 0.0)? 0.8*this->event_rate + 0.2*(num_events/ef_span) : num_events/ef_span;
         #ifdef DEBUG_PRINTS
-        ::base::Time first_ts = this->events[0].ts;
-        ::base::Time last_ts = this->events[this->eds_config.data_loader.num_events-1].ts;
-        std::cout<<"** [EDS_TASK EVENTS] Processing events from["<<first_ts.toSeconds()<<"] to["<<last_ts.toSeconds()<<"] size:"<<this->events.size()<<std::endl;
+        std::cout<<"** [EDS_TASK EVENTS] Processing events from["<<ef_events.front().ts.toSeconds()<<"] to["<<ef_events.back().ts.toSeconds()<<"] size:"<<this->events.size()<<std::endl;
         #endif
 
-        /** Move data (no copy) **/
-        std::vector<::base::samples::Event> ef_events;
-        std::move(this->events.begin(), this->events.begin()+this->eds_config.data_loader.num_events, std::back_inserter(ef_events)); 
+        /** Rate control: decimate the events when the event rate is over the budget **/
+        uint16_t decimation = 1;
+        if (this->eds_config.data_loader.max_event_rate > 0.0 && this->event_rate > this->eds_config.data_loader.max_event_rate)
+            decimation = static_cast<uint16_t>(std::min(std::ceil(this->event_rate / this->eds_config.data_loader.max_event_rate), 127.0)); // int8 weights
+        this->event_frame->setDecimation(decimation);
 
-        /** Clean events in the original buffer depending in the overlap percentage.
-         * std move only moves (it does not delete) **/
-        int next_element = (1.0 - this->eds_config.data_loader.overlap)*this->eds_config.data_loader.num_events;
-        this->events.erase(this->events.begin(), this->events.begin()+next_element);
+        /** Create the Event Frame (updating the previous one when incremental) **/
+        {
+            ::eds::utils::ScopedTimer ef_timer(this->stage_timers, "event_frame");
+            if (this->eds_config.data_loader.incremental)
+                this->event_frame->slide(this->ef_idx, ef_events, this->ef_advance, this->cam_calib.cam1,
+                            this->eds_config.tracker.options.max_num_iterations.size(),
+                            base::Affine3d::Identity(), this->newcam->out_size);
+            else
+                this->event_frame->create(this->ef_idx, ef_events, this->cam_calib.cam1,
+                            this->eds_config.tracker.options.max_num_iterations.size(),
+                            base::Affine3d::Identity(), this->newcam->out_size);
+        }
+
+        /** Track the event frame **/
+        this->trackEventFrame(ef_events);
+
+        /** Release events in the buffer depending in the overlap percentage.
+         * It only moves the read cursor, the window is not valid afterwards **/
+        int next_element = (1.0 - this->eds_config.data_loader.overlap)*num_events;
+        this->ef_advance = std::max(next_element, 1);
+        this->events.advance(this->ef_advance);
         #ifdef DEBUG_PRINTS
-        std::cout<<"** [EDS_TASK EVENTS] ef_events at["<<ef_events[0].ts.toMicroseconds()<<"] size:"<<ef_events.size()<<std::endl;
-        std::cout<<"** [EDS_TASK EVENTS] overlap ["<< this->eds_config.data_loader.overlap*100.0 <<"] this->events at["<<this->events[0].ts.toMicroseconds()<<"] size:"<<this->events.size()<<std::endl;
+        std::cout<<"** [EDS_TASK EVENTS] overlap ["<< this->eds_config.data_loader.overlap*100.0 <<"] this->events size:"<<this->events.size()<<std::endl;
         #endif
+    }
+
+}
+
+void Task::processTimeSurface()
+{
+    if (this->events.size() == 0)
+        return;
 
-        /** Create the Event Frame **/
-        this->event_frame->create(this->ef_idx, ef_events, this->cam_calib.cam1,
-                        this->eds_config.tracker.options.max_num_iterations.size(),
-                        base::Affine3d::Identity(), this->newcam->out_size);
+    /** All the buffered events go in the surface (in time order) **/
+    ::eds::tracking::EventWindow ef_events = this->events.window(this->events.size());
+    const ::base::Time period = ::base::Time::fromSeconds(1.0/this->eds_config.data_loader.surface_rate);
+    if (this->surface_time.isNull())
+        this->surface_time = ef_events.front().ts + period;
 
-        /** Increment EF INDEX **/
-        this->ef_idx++;
+    size_t inserted = 0;
+    while (this->surface_time <= ef_events.back().ts)
+    {
+        /** Events up to the query time, then the frame at that time **/
+        size_t end = ef_events.lowerBound(this->surface_time);
+        this->event_frame->insert(ef_events, inserted, end);
+        inserted = end;
 
-        /** EDS TRACKER OPTIMIZATION **/
-        if (this->initialized)
         {
-            /** Event to Image alignment T_kf_ef delta pose **/
-            ::base::Transform3d T_kf_ef = this->pose_kf_ef.getTransform(); // initialize to current estimate
-            this->eventsToImageAlignment(ef_events, T_kf_ef); // EDS tracker estimate
+            ::eds::utils::ScopedTimer ef_timer(this->stage_timers, "event_frame");
+            this->event_frame->createAt(this->ef_idx, this->surface_time, this->cam_calib.cam1,
+                            this->eds_config.tracker.options.max_num_iterations.size(),
+                            base::Affine3d::Identity(), this->newcam->out_size);
+        }
+
+        /** Track the event frame **/
+        this->trackEventFrame(ef_events);
+        this->surface_time = this->surface_time + period;
+    }
+    this->event_frame->insert(ef_events, inserted, ef_events.size());
+
+    /** The surface keeps the history: release all the events **/
+    this->events.advance(ef_events.size());
+}
+
+void Task::trackEventFrame(const ::eds::tracking::EventWindow &ef_events)
+{
+    /** Increment EF INDEX **/
+    this->ef_idx++;
+
+    /** EDS TRACKER OPTIMIZATION **/
+    if (this->initialized)
+    {
+        /** Event to Image alignment T_kf_ef delta pose **/
+        ::base::Transform3d T_kf_ef = this->pose_kf_ef.getTransform(); // initialize to current estimate
+        ::eds::utils::ScopedTimer tracking_timer(this->stage_timers, "tracking");
+        this->eventsToImageAlignment(ef_events, T_kf_ef); // EDS tracker estimate
+        double solve_time = 1e-06 * tracking_timer.stop();
+        this->solve_time = (this->solve_time > 0.0)? 0.8*this->solve_time + 0.2*solve_time : solve_time;
+
+        /** Tracker stages (summed over the pyramid levels) **/
+        ::eds::tracking::TrackerInfo tracker_info = this->event_tracker->getInfo();
+        this->stage_timers.add("tracker_setup", tracker_info.setup_time_us);
+        this->stage_timers.add("tracker_solve", tracker_info.solve_time_us);
+        this->stage_timers.add("tracker_residuals", tracker_info.residuals_time_us);
+
+        /** Set the EventFrame pose: T_w_ef with the result from alignment**/
+        this->event_frame->setPose(this->pose_w_kf.getTransform()*T_kf_ef); // T_w_ef = T_w_kf * T_kf_ef
+
+        /** Update the output port: T_kf_ef **/
+        this->pose_kf_ef.time = this->event_frame->time;
+        this->pose_kf_ef.setTransform(T_kf_ef);
+        #ifdef DEBUG_PRINTS
+        std::cout<<"** [EDS_TASK EVENTS] Wrote pose_kf_ef:\n"<<this->pose_kf_ef.getTransform().matrix()<<std::endl;
+        #endif
+
+        /** Write output port: T_w_ef **/
+        this->pose_w_ef.time = this->event_frame->time;
+        this->pose_w_ef.setTransform(this->event_frame->getPose());
+        this->pose_w_ef.velocity = this->pose_w_ef.getTransform() * this->event_tracker->linearVelocity();
+        this->pose_w_ef.angular_velocity = this->pose_w_ef.getTransform() * this->event_tracker->angularVelocity();
+
+        /* TO-DO get the pose_w_ef which is T_w_ef: event frame expressed wrt world frame (start pose) **/
+        /** the information is in this->pose_ef */
+        #ifdef DEBUG_PRINTS
+        std::cout<<"** [EDS_TASK EVENTS] Wrote pose_w_ef:\n"<<this->pose_w_ef.getTransform().matrix()<<std::endl;
+        #endif
 
-            /** Set the EventFrame pose: T_w_ef with the result from alignment**/
-            this->event_frame->setPose(this->pose_w_kf.getTransform()*T_kf_ef); // T_w_ef = T_w_kf * T_kf_ef
+        /** TO-DO need to get the information inside each of this functions **/
 
-            /** Update the output port: T_kf_ef **/
-            this->pose_kf_ef.time = this->event_frame->time;
-            this->pose_kf_ef.setTransform(T_kf_ef);
-            #ifdef DEBUG_PRINTS
-            std::cout<<"** [EDS_TASK EVENTS] Wrote pose_kf_ef:\n"<<this->pose_kf_ef.getTransform().matrix()<<std::endl;
-            #endif
+        /** Write the event frame **/
+        ::eds::utils::ScopedTimer outputs_timer(this->stage_timers, "outputs");
+        this->outputEventFrameViz(this->event_frame);
 
-            /** Write output port: T_w_ef **/
-            this->pose_w_ef.time = this->event_frame->time;
-            this->pose_w_ef.setTransform(this->event_frame->getPose());
-            this->pose_w_ef.velocity = this->pose_w_ef.getTransform() * this->event_tracker->linearVelocity();
-            this->pose_w_ef.angular_velocity = this->pose_w_ef.getTransform() * this->event_tracker->angularVelocity();
+        /** Output Generative Model **/
+        this->outputGenerativeModelFrameViz(this->key_frame, this->event_frame->time);
 
-            /* TO-DO get the pose_w_ef which is T_w_ef: event frame expressed wrt world frame (start pose) **/
-            /** the information is in this->pose_ef */
-            #ifdef DEBUG_PRINTS
-            std::cout<<"** [EDS_TASK EVENTS] Wrote pose_w_ef:\n"<<this->pose_w_ef.getTransform().matrix()<<std::endl;
-            #endif
+        /** Output Optical Flow **/
+        this->outputOpticalFlowFrameViz(this->key_frame, this->event_frame->time);
 
-            /** TO-DO need to get the information inside each of this functions **/
+        /** Output Inverse depth and the KF Map **/
+        this->outputInvDepthAndLocalMap(this->key_frame, this->event_frame->time);
 
-            /** Write the event frame **/
-            this->outputEventFrameViz(this->event_frame);
+        /** Tracker infos **/
+        this->outputTrackerInfo(this->event_frame->time);
+    }
+}
 
-            /** Output Generative Model **/
-            this->outputGenerativeModelFrameViz(this->key_frame, this->event_frame->time);
+void Task::frameCallback(const base::Time &ts, const ::base::samples::frame::Frame &frame_sample, const bool frame_interrupt)
+{
+    /** Asynchronous: queue the frame for the processing thread **/
+    if (this->frame_queue)
+    {
+        std::pair<::base::samples::frame::Frame, bool> item(frame_sample, frame_interrupt);
+        if (this->frame_queue->push(std::move(item)))
+            this->notifyInput();
+        return;
+    }
 
-            /** Output Optical Flow **/
-            this->outputOpticalFlowFrameViz(this->key_frame, this->event_frame->time);
+    return this->processFrame(frame_sample, frame_interrupt);
+}
 
-            /** Output Inverse depth and the KF Map **/
-            this->outputInvDepthAndLocalMap(this->key_frame, this->event_frame->time);
+void Task::notifyInput()
+{
+    boost::lock_guard<boost::mutex> lock(this->input_mutex);
+    this->input_signal.notify_one();
+}
 
-            /** Tracker infos **/
-            this->outputTrackerInfo(this->event_frame->time);
+void Task::inputLoop()
+{
+    ::base::samples::EventBatch events_sample;
+    std::pair<::base::samples::frame::Frame, bool> frame_item;
+    while (true)
+    {
+        /** Wait for input (or stop) **/
+        {
+            boost::unique_lock<boost::mutex> lock(this->input_mutex);
+            while (this->input_running && this->event_queue->empty() && this->frame_queue->empty())
+                this->input_signal.wait(lock);
+            if (!this->input_running && this->event_queue->empty() && this->frame_queue->empty())
+                return;
+        }
+
+        /** Take the oldest sample of both queues (timestamp order) **/
+        ::base::Time events_time, frame_time;
+        bool has_events = this->event_queue->front([&events_time](const ::base::samples::EventBatch &e){events_time = e.time;});
+        bool has_frame = this->frame_queue->front([&frame_time](const std::pair<::base::samples::frame::Frame, bool> &f){frame_time = f.first.time;});
+
+        if (has_events && (!has_frame || events_time <= frame_time))
+        {
+            this->event_queue->pop(events_sample);
+            if (this->event_filter) this->event_filter->filter(events_sample);
+            this->events.push(events_sample);
+            this->processEvents();
+        }
+        else if (has_frame)
+        {
+            this->frame_queue->pop(frame_item);
+            this->processFrame(frame_item.first, frame_item.second);
         }
     }
+}
 
+::eds::tracking::EventFilterInfo Task::getEventFilterInfo() const
+{
+    if (this->event_filter) return this->event_filter->getInfo();
+    return this->filter_info;
 }
 
-void Task::frameCallback(const base::Time &ts, const ::base::samples::frame::Frame &frame_sample, const bool frame_interrupt)
+::eds::utils::QueueStats Task::getEventQueueStats() const
+{
+    if (this->event_queue) return this->event_queue->getStats();
+    return this->event_queue_stats;
+}
+
+::eds::utils::QueueStats Task::getFrameQueueStats() const
 {
+    if (this->frame_queue) return this->frame_queue->getStats();
+    return this->frame_queue_stats;
+}
+
+std::vector<::eds::utils::StageStats> Task::getStats() const
+{
+    return this->stage_timers.summary();
+}
+
+bool Task::writeStats(const std::string &filename) const
+{
+    bool success = this->stage_timers.write(filename);
+    if (!success)
+        std::cout<<"[EDS_TASK] Cannot write stats to: "<<filename<<std::endl;
+    return success;
+}
+
+void Task::processFrame(const ::base::samples::frame::Frame &frame_sample, const bool frame_interrupt)
+{
+    ::eds::utils::ScopedTimer timer(this->stage_timers, "process_frame");
     #ifdef DEBUG_PRINTS
     std::cout<<"** [EDS_TASK] FRAME IDX:"<< this->frame_idx<<" Received Frame at ["<<frame_sample.time.toSeconds()<<"]**\n";
     #endif
@@ -317,12 +539,43 @@ bool Task::start()
     /* Event-based Tracker (EDS) **/
     this->event_tracker = std::make_shared<::eds::tracking::Tracker>(this->eds_config.tracker);
 
+    /** IMU preintegration in the keyframe camera frame (cam0) **/
+    Eigen::Matrix3d R_cam_imu = Eigen::Matrix3d::Identity();
+    if (this->cam_calib.cam0.T_cam_imu.size() == 16)
+        R_cam_imu = Eigen::Map<const Eigen::Matrix<double, 4, 4, Eigen::RowMajor>>(this->cam_calib.cam0.T_cam_imu.data()).block<3, 3>(0, 0);
+    this->imu_preintegration = ::eds::tracking::ImuPreintegration(R_cam_imu, this->eds_config.tracker.imu.gyro_noise);
+    if (this->eds_config.tracker.imu.gyro_bias.size() == 3)
+        this->imu_preintegration.gyro_bias = Eigen::Map<const Eigen::Vector3d>(this->eds_config.tracker.imu.gyro_bias.data());
+
     /** KeyFrame (EDS) **/
     this->key_frame = std::make_shared<eds::tracking::KeyFrame>(*(this->cam0), *(this->newcam), this->cam_calib.cam0.distortion_model);
 
     /** EventFrame (EDS) **/
     this->event_frame = std::make_shared<eds::tracking::EventFrame>(*(this->cam1), *(this->newcam), this->cam_calib.cam1.distortion_model);
 
+    /** Event filter in the raw event camera coordinates **/
+    if (this->eds_config.data_loader.filter.enabled)
+        this->event_filter = std::make_shared<::eds::tracking::EventFilter>(this->eds_config.data_loader.filter,
+                                    this->cam_calib.cam1.height, this->cam_calib.cam1.width);
+
+    /** Ring buffer of events: room for a few event frames to avoid growing **/
+    this->events.reserve(4 * std::max(this->eds_config.data_loader.num_events, this->eds_config.data_loader.max_events));
+
+    /** Event frame storage for the largest window **/
+    this->event_frame->reserve(std::max(this->eds_config.data_loader.num_events, this->eds_config.data_loader.max_events));
+    this->event_frame->setNumThreads(this->eds_config.data_loader.accumulate_threads);
+    this->event_frame->setLevelThreads(this->eds_config.data_loader.level_threads);
+    this->event_frame->setIncremental(this->eds_config.data_loader.incremental);
+    this->event_frame->setPyramidMode(this->eds_config.data_loader.pyramid);
+    this->event_frame->setScalar(this->eds_config.tracker.scalar);
+    this->event_frame->setTimeSurface(this->eds_config.data_loader.surface_decay);
+    this->surface_time = ::base::Time();
+    this->ef_advance = 0;
+    this->event_rate = 0.0; this->solve_time = 0.0;
+    this->stage_timers.clear();
+    this->event_queue_stats = this->frame_queue_stats = ::eds::utils::QueueStats{0, 0, 0, 0, 0, 0};
+    this->filter_info = ::eds::tracking::EventFilterInfo{0, 0, 0, 0, 0};
+
     /** Image-based Tracker constructor (DSO) **/
     this->image_tracker = std::make_shared<dso::CoarseTracker>(dso::wG[0], dso::hG[0]);
     this->last_coarse_RMSE.setConstant(100);
@@ -337,11 +590,55 @@ bool Task::start()
     this->bundles = std::make_shared<dso::EnergyFunctional>();
     this->bundles->red = &(this->thread_reduce); //asign the threads
 
+    /** Asynchronous input: bounded queues and processing thread **/
+    if (this->eds_config.data_loader.async)
+    {
+        const ::eds::DataLoaderConfig &config = this->eds_config.data_loader;
+        this->event_queue = std::make_shared< ::eds::utils::BoundedQueue<::base::samples::EventBatch> >(
+            config.queue_size, config.queue_policy,
+            [](::base::samples::EventBatch &newest, ::base::samples::EventBatch &item)
+            {
+                newest.reserve(newest.size() + item.size());
+                for (size_t i=0; i<item.size(); ++i)
+                    newest.push_back(item.x[i], item.y[i], item.ts[i], item.getPolarity(i));
+                newest.time = item.time;
+            });
+        /** Frames cannot be merged: MERGE drops the oldest frame **/
+        this->frame_queue = std::make_shared< ::eds::utils::BoundedQueue< std::pair<::base::samples::frame::Frame, bool> > >(
+            config.queue_size, config.queue_policy);
+        this->input_running = true;
+        this->input_thread = boost::thread(&Task::inputLoop, this);
+    }
+
     return true;
 }
 
+void Task::stopInput()
+{
+    /** Process the queued input and stop the processing thread **/
+    if (this->event_queue)
+    {
+        this->event_queue->close(); this->frame_queue->close();
+        {
+            boost::lock_guard<boost::mutex> lock(this->input_mutex);
+            this->input_running = false;
+            this->input_signal.notify_one();
+        }
+        this->input_thread.join();
+
+        /** Statistics of the whole run (readable after stop) **/
+        this->event_queue_stats = this->event_queue->getStats();
+        this->frame_queue_stats = this->frame_queue->getStats();
+        this->event_queue.reset(); this->frame_queue.reset();
+    }
+}
+
 void Task::stop()
 {
+    this->stopInput();
+    if (this->event_filter)
+        this->filter_info = this->event_filter->getInfo();
+
     this->printResult("stamped_traj_estimate.txt");
 
     this->initializer.reset();
@@ -360,6 +657,7 @@ void Task::stop()
         if (it){delete it; it=nullptr;}
 
     this->events.clear();
+    this->event_filter.reset();
     this->all_frame_history.clear();
     this->all_keyframes_history.clear();
     this->frame_hessians.clear();
@@ -383,6 +681,74 @@ void Task::cleanup()
     if (dt_config.overlap < 0.0) dt_config.overlap = 0.0;
     dt_config.overlap /= 100.0;
 
+    /** Windowing mode (count by default) **/
+    dt_config.mode = ::eds::COUNT;
+    if (config["mode"])
+    {
+        std::string mode = config["mode"].as<std::string>();
+        if (mode.compare("count") == 0)
+            dt_config.mode = ::eds::COUNT;
+        else if (mode.compare("duration") == 0)
+            dt_config.mode = ::eds::DURATION;
+        else if (mode.compare("hybrid") == 0)
+            dt_config.mode = ::eds::HYBRID;
+        else if (mode.compare("adaptive") == 0)
+            dt_config.mode = ::eds::ADAPTIVE;
+        else
+            throw std::runtime_error("[EDS_TASK] unknown data_loader mode: " + mode + " (count, duration, hybrid or adaptive)");
+    }
+    dt_config.duration = ::base::Time::fromSeconds(config["duration_ms"]? config["duration_ms"].as<double>() * 1e-03 : 0.0);
+    if ((dt_config.mode == ::eds::DURATION || dt_config.mode == ::eds::HYBRID) && dt_config.duration.toMicroseconds() <= 0)
+        throw std::runtime_error("[EDS_TASK] data_loader duration_ms should be positive in duration and hybrid modes");
+    dt_config.min_events = config["min_events"]? config["min_events"].as<size_t>() : dt_config.num_events;
+    dt_config.max_events = config["max_events"]? config["max_events"].as<size_t>() : dt_config.num_events;
+    dt_config.max_events = std::max(std::max(dt_config.max_events, dt_config.min_events), (size_t)1);
+    dt_config.target_rate = config["target_rate"]? config["target_rate"].as<double>() : 0.0;
+
+    /** Event rate budget [events/s] (0: no decimation) **/
+    dt_config.max_event_rate = config["max_event_rate"]? config["max_event_rate"].as<double>() : 0.0;
+
+    /** Threads of the event accumulation (single thread by default) **/
+    dt_config.accumulate_threads = config["accumulate_threads"]? config["accumulate_threads"].as<uint16_t>() : 1;
+
+    /** Threads building the event frame pyramid levels (single thread by default) **/
+    dt_config.level_threads = config["level_threads"]? config["level_threads"].as<uint16_t>() : 1;
+
+    /** Incremental event frame for overlapping windows (disabled without
+     * overlap). The events have uniform time weights instead of the
+     * exponential ones, also in the full rebuilds **/
+    dt_config.incremental = (config["incremental"]? config["incremental"].as<bool>() : false) && dt_config.overlap > 0.0;
+
+    /** Event frame pyramid (dilate + erode levels by default) **/
+    dt_config.pyramid = ::eds::tracking::selectPyramidMode(config["pyramid"]? config["pyramid"].as<std::string>() : "morphology");
+
+    /** Time surface instead of windows of events (disabled by default) **/
+    dt_config.surface_decay = ::base::Time(); dt_config.surface_rate = 100.0;
+    if (config["time_surface"])
+    {
+        YAML::Node surface = config["time_surface"];
+        if (surface["decay_ms"])
+            dt_config.surface_decay = ::base::Time::fromSeconds(surface["decay_ms"].as<double>() * 1e-03);
+        if (dt_config.surface_decay.toMicroseconds() <= 0)
+            throw std::runtime_error("[EDS_TASK] data_loader time_surface needs a positive decay_ms");
+        if (surface["rate"]) dt_config.surface_rate = surface["rate"].as<double>();
+        if (dt_config.surface_rate <= 0.0)
+            throw std::runtime_error("[EDS_TASK] data_loader time_surface rate should be positive");
+    }
+
+    /** Event pre-filter (disabled by default) **/
+    dt_config.filter = ::eds::tracking::readEventFilterConfig(config["filter"]);
+
+    /** Asynchronous input (synchronous by default) **/
+    dt_config.async = false; dt_config.queue_size = 8; dt_config.queue_policy = ::eds::utils::BLOCK;
+    if (config["async"])
+    {
+        YAML::Node async = config["async"];
+        dt_config.async = async["enabled"]? async["enabled"].as<bool>() : true;
+        if (async["queue_size"]) dt_config.queue_size = async["queue_size"].as<size_t>();
+        if (async["policy"]) dt_config.queue_policy = ::eds::utils::selectQueuePolicy(async["policy"].as<std::string>());
+    }
+
     return dt_config;
 }
 
@@ -559,20 +925,101 @@ dso::SE3 Task::initialize(dso::ImageAndExposure* image, int id, const int &snapp
     else return dso::SE3();
 }
 
-bool Task::eventsToImageAlignment(const std::vector<::base::samples::Event> &events_array, ::base::Transform3d &T_kf_ef)
+size_t Task::windowSize()
+{
+    const ::eds::DataLoaderConfig &config = this->eds_config.data_loader;
+    const size_t size = this->events.size();
+    if (size == 0) return 0;
+
+    switch(config.mode)
+    {
+    case ::eds::DURATION:
+    {
+        /** Events until the duration (the window is complete with the first
+         * event after it), at most max_events (the event frame storage) **/
+        ::eds::tracking::EventWindow w = this->events.window(size);
+        ::base::Time end_time = w.front().ts + config.duration;
+        if (w.back().ts < end_time) return (size >= config.max_events)? config.max_events : 0;
+        return std::min(std::max(w.lowerBound(end_time), (size_t)1), config.max_events);
+    }
+    case ::eds::HYBRID:
+    {
+        /** At least the duration bounded by the min and max number of events **/
+        ::eds::tracking::EventWindow w = this->events.window(size);
+        ::base::Time end_time = w.front().ts + config.duration;
+        if (size >= config.min_events && w.back().ts >= end_time)
+            return std::min(std::max(w.lowerBound(end_time), config.min_events), config.max_events);
+        return (size >= config.max_events)? config.max_events : 0;
+    }
+    case ::eds::ADAPTIVE:
+    {
+        /** Tracking rate: the target one or the one the tracker can run at **/
+        double rate = config.target_rate;
+        if (this->solve_time > 0.0 && (rate <= 0.0 || 1.0/this->solve_time < rate))
+            rate = 1.0/this->solve_time;
+        size_t n = config.min_events;
+        if (rate > 0.0 && this->event_rate > 0.0)
+            n = static_cast<size_t>(this->event_rate / rate);
+        n = std::min(std::max(n, config.min_events), config.max_events);
+        return (size >= n)? n : 0;
+    }
+    default:
+        return (size >= config.num_events)? config.num_events : 0;
+    }
+}
+
+void Task::preintegrateImu(const ::base::Time &time)
+{
+    boost::unique_lock<boost::mutex> lock(this->imu_mutex);
+    while (!this->imu_samples.empty() && this->imu_samples.front().time <= time)
+    {
+        this->imu_preintegration.integrate(this->imu_samples.front());
+        this->imu_samples.pop_front();
+    }
+    this->imu_preintegration.integrateUntil(time);
+}
+
+bool Task::eventsToImageAlignment(const ::eds::tracking::EventWindow &events_array, ::base::Transform3d &T_kf_ef)
 {
-    /** Keyframe to Eventframe delta pose **/
-    T_kf_ef = ::base::Transform3d::Identity();
+    /** Keyframe to Eventframe delta pose: T_kf_ef keeps the current
+     * estimate when no level is usable. The tracker starts from the
+     * motion model prediction **/
+    this->event_tracker->predict(this->event_frame->time);
+
+    /** Rotation and angular velocity from the gyroscope since the last event frame **/
+    if (this->eds_config.tracker.imu.enabled)
+    {
+        this->preintegrateImu(this->event_frame->time);
+        if (this->imu_preintegration.dt() > 0.0)
+            this->event_tracker->imuPrior(this->imu_preintegration.deltaRotationCam(),
+                                        this->imu_preintegration.angularVelocityCam(),
+                                        this->imu_preintegration.covarianceCam());
+        this->imu_preintegration.reset(this->event_frame->time);
+    }
 
     /** Execute the tracker and get the T_kf_ef **/
     bool success = false;
-    for (int i=this->event_frame->event_frame.size()-1; i>=0; --i)
-    {
-        success = this->event_tracker->optimize(i, &(this->event_frame->event_frame[i]), T_kf_ef, ::eds::tracking::MAD);
+    const bool single = (this->eds_config.tracker.scalar == ::eds::tracking::FLOAT);
+    for (int i=this->event_frame->numLevels()-1; i>=0; --i)
+    {
+        /** Coarse levels are ready first, the finer ones are still built **/
+        this->event_frame->waitLevel(i);
+        if (single)
+            success = this->event_tracker->optimize(i, &(this->event_frame->level<float>(i)), this->event_frame->frame[i].size(),
+                                            this->event_frame->level_scale[i], T_kf_ef, ::eds::tracking::MAD);
+        else
+            success = this->event_tracker->optimize(i, &(this->event_frame->level<double>(i)), this->event_frame->frame[i].size(),
+                                            this->event_frame->level_scale[i], T_kf_ef, ::eds::tracking::MAD);
+
+        /** Converged at this level: the finer levels are not solved **/
+        if (success && i > 0 && this->event_tracker->skipFinerLevels(i))
+            break;
     }
 
     /** Track the points and remove the ones out of the image plane **/
+    ::eds::utils::ScopedTimer coord_timer(this->stage_timers, "get_coord");
     std::vector<cv::Point2d> coord = this->event_tracker->getCoord(true);
+    coord_timer.stop();
 
     #ifdef DEBUG_PRINTS
     std::cout<<"** [EDS_TASK EVENT_TO_IMG ALIGNMENT] "<<(success?"SUCCESS": "NO_USABLE") <<" rescale_factor: "<< this->rescale_factor<<"\nT_kf_ef:\n"<<T_kf_ef.matrix()<<std::endl;
@@ -617,7 +1064,9 @@ void Task::track(dso::ImageAndExposure* image, int id)
     fh->ab_exposure = image->exposure_time;
     fh->makeImages(image->image, this->calib.get());
 
+    ::eds::utils::ScopedTimer image_timer(this->stage_timers, "image_tracking");
     dso::Vec4 tres = this->trackNewFrame(fh, dso::BaseTransformToSE3(this->pose_kf_ef.getTransform()));
+    image_timer.stop();
     if(!std::isfinite((double)tres[0]) || !std::isfinite((double)tres[1]) || !std::isfinite((double)tres[2]) || !std::isfinite((double)tres[3]))
     {
         std::cout<<"Image Tracking failed: LOST!"<<std::endl;
@@ -910,6 +1359,8 @@ void Task::makeNonKeyFrame(dso::FrameHessian* fh)
 
 void Task::makeKeyFrame(dso::FrameHessian* fh)
 {
+    ::eds::utils::ScopedTimer timer(this->stage_timers, "make_keyframe");
+
     /** reference to the KF cannot be null **/
     assert(fh->shell->trackingRef != 0);
     fh->shell->camToWorld = fh->shell->trackingRef->camToWorld * fh->shell->camToTrackingRef; //T_w_cam = T_w_kf * T_kf_cam
@@ -953,7 +1404,9 @@ void Task::makeKeyFrame(dso::FrameHessian* fh)
 
     /** OPTIMIZE ALL KFs IN THE SLIDING WINDOW **/
     fh->frameEnergyTH = this->frame_hessians.back()->frameEnergyTH;
+    ::eds::utils::ScopedTimer optimize_timer(this->stage_timers, "optimize");
     float rmse = this->optimize(dso::setting_maxOptIterations);
+    optimize_timer.stop();
 
     /** IN CASE INITIALIZATION FAILED **/
     if(this->all_keyframes_history.size() <= 4)
@@ -980,6 +1433,7 @@ void Task::makeKeyFrame(dso::FrameHessian* fh)
     this->image_tracker->setCoarseTrackingRef(this->frame_hessians); // here the new info to be a KeyFrame (host ref frame) for the image_tracker
 
     /** (Activate-)Marginalize Points **/
+    ::eds::utils::ScopedTimer points_timer(this->stage_timers, "marginalization_points");
     this->flagPointsForRemoval();
     this->bundles->dropPointsF();
     this->getNullspaces(
@@ -988,9 +1442,12 @@ void Task::makeKeyFrame(dso::FrameHessian* fh)
             this->bundles->lastNullspaces_affA,
             this->bundles->lastNullspaces_affB);
     this->bundles->marginalizePointsF();
+    points_timer.stop();
 
     /** Add new Immature points & new residuals. Initialize Immature points with the GlobalMap **/
+    ::eds::utils::ScopedTimer traces_timer(this->stage_timers, "make_new_traces");
     this->makeNewTraces(fh, this->depthmap.get()); //this creates new points (ImmaturePoints) in the frame with inverse depth = 0 (UNINITIALIZED)
+    traces_timer.stop();
 
     /** Update the pose_w_kf: Time and the transformation of the optimized KF: T_w_kf**/
     this->pose_w_kf.time = ::base::Time::fromSeconds(fh->shell->timestamp);
@@ -1011,7 +1468,15 @@ void Task::makeKeyFrame(dso::FrameHessian* fh)
     /** Reset the tracker with the new keyframe **/
     this->event_tracker->reset(this->key_frame, Eigen::Vector3d::Zero(), Eigen::Quaterniond::Identity());
 
+    /** The IMU integrates from the keyframe (the tracker reference) **/
+    if (this->eds_config.tracker.imu.enabled)
+    {
+        this->preintegrateImu(this->key_frame->time);
+        this->imu_preintegration.reset(this->key_frame->time);
+    }
+
     /**  MARGINALIZE KEYFRAMES **/
+    ::eds::utils::ScopedTimer frames_timer(this->stage_timers, "marginalization_frames");
     for(unsigned int i=0;i<this->frame_hessians.size();i++)
         if(this->frame_hessians[i]->flaggedForMarginalization)
             {this->marginalizeFrame(this->frame_hessians[i]); i=0;}
@@ -2282,6 +2747,7 @@ void Task::outputTrackerInfo(const ::base::Time &timestamp)
 {
     eds::TrackerInfo tracker_info= this->event_tracker->getInfo();
     tracker_info.time = timestamp;
+    tracker_info.decimation = this->event_frame->decimation;
     /** TO-DO: get the Tracker information this is defined in EDSTypes (for Debug)*/
     /** The information is in teh variable tracker_info*/
     //_tracker_info.write(tracker_info);
@@ -2293,8 +2759,8 @@ void Task::outputEventFrameViz(const std::shared_ptr<eds::tracking::EventFrame>
     cv::Mat event_viz = event_frame->getEventFrameViz(0, false);
 
     /** Write min and max values on image **/
-    double min = * std::min_element(std::begin(event_frame->event_frame[0]), std::end(event_frame->event_frame[0]));
-    double max = * std::max_element(std::begin(event_frame->event_frame[0]), std::end(event_frame->event_frame[0]));
+    double min, max;
+    cv::minMaxLoc(event_frame->getEventFrame(0), &min, &max);
     std::string text = "min: " + std::to_string(min) + " max: " + std::to_string(max);
     cv::putText(event_viz, text, cv::Point(5, event_viz.rows-5), 
     cv::FONT_HERSHEY_COMPLEX_SMALL, 0.5, cv::Scalar(0,255,255), 0.1, cv::LINE_AA);
@@ -2305,7 +2771,10 @@ void Task::outputEventFrameViz(const std::shared_ptr<eds::tracking::EventFrame>
     /** Write the Event Frame Vector **/
     ::eds::EventFrameVector event_frame_vector;
     event_frame_vector.time = event_frame->time;
-    event_frame_vector.data = event_frame->event_frame[0];
+    if (event_frame->event_frame_f.empty())
+        event_frame_vector.data = event_frame->event_frame[0];
+    else
+        event_frame_vector.data.assign(event_frame->event_frame_f[0].begin(), event_frame->event_frame_f[0].end());
     /** TO-DO get the event_frame in std vector format  (optional) */
     //_event_frame_vector.write(event_frame_vector);
 
@@ -32,6 +32,7 @@
 
 /** std **/
 #include <memory> //shared_pointer
+#include <deque>
 
 namespace eds{
 
@@ -68,8 +69,40 @@ namespace eds{
         /** Image frame in opencv format splitted in channels **/
         cv::Mat img_rgb[3];
 
-        /** Buffer of events **/
-        std::vector<::base::samples::Event> events;
+        /** Ring buffer of events (columnar) **/
+        ::eds::tracking::EventBuffer events;
+        /** Events released from the buffer since the last event frame **/
+        size_t ef_advance;
+        /** Time of the next time surface event frame **/
+        ::base::Time surface_time;
+
+        /** Event pre-filter and its output buffers **/
+        std::shared_ptr<::eds::tracking::EventFilter> event_filter;
+        std::vector<::base::samples::Event> filter_events;
+        ::base::samples::EventBatch filter_batch;
+
+        /** Event rate [events/s] and tracker solve time [s] (filtered) **/
+        double event_rate, solve_time;
+
+        /** Durations of the processing stages (rolling histograms) **/
+        ::eds::utils::StageTimers stage_timers;
+
+        /** Asynchronous input: queues, processing thread and wake up signal.
+         * The events are queued columnar (EventBatch) **/
+        std::shared_ptr< ::eds::utils::BoundedQueue<::base::samples::EventBatch> > event_queue;
+        std::shared_ptr< ::eds::utils::BoundedQueue< std::pair<::base::samples::frame::Frame, bool> > > frame_queue;
+        boost::thread input_thread;
+        boost::mutex input_mutex;
+        boost::condition_variable input_signal;
+        bool input_running;
+        /** Queue and filter statistics of the last run (after stop) **/
+        ::eds::utils::QueueStats event_queue_stats, frame_queue_stats;
+        ::eds::tracking::EventFilterInfo filter_info;
+
+        /** IMU samples not integrated yet and the preintegration since the last event frame **/
+        std::deque<::base::samples::IMUSensors> imu_samples;
+        boost::mutex imu_mutex;
+        ::eds::tracking::ImuPreintegration imu_preintegration;
 
         /** Local Depth map **/
         std::shared_ptr<::eds::mapping::IDepthMap2d> depthmap;
@@ -160,11 +193,48 @@ namespace eds{
          */
         void eventsCallback(const base::Time &ts, const ::base::samples::EventArray &events_sample);        
 
+        /**
+         * event batch (columnar events) callback function. The batch stays
+         * columnar through the input queue, the event filter, the event
+         * ring buffer and the event frame windows (column copies only)
+         */
+        void eventsCallback(const base::Time &ts, const ::base::samples::EventBatch &events_sample);
+
         /**
         *  image frame callback
         */
         void frameCallback(const base::Time &ts, const ::base::samples::frame::Frame &frame_sample, const bool frame_interrupt = false);
 
+        /**
+         * IMU callback (gyroscope and accelerometer in the IMU frame)
+         */
+        void imuCallback(const base::Time &ts, const ::base::samples::IMUSensors &imu_sample);
+
+        /**
+         * Event filter information (removed events). Complete after stop()
+         */
+        ::eds::tracking::EventFilterInfo getEventFilterInfo() const;
+
+        /**
+         * Asynchronous input queues information (depth, drops, merges).
+         * Complete after stop(), while running they are read concurrently
+         */
+        ::eds::utils::QueueStats getEventQueueStats() const;
+
+        ::eds::utils::QueueStats getFrameQueueStats() const;
+
+        /**
+         * Timing of the processing stages [us]: event frame, tracking
+         * (setup, solve, residuals), image tracking, keyframe, backend
+         * optimize, marginalization and new traces
+         */
+        std::vector<::eds::utils::StageStats> getStats() const;
+
+        /**
+         * Write the stage timings: JSON for a .json file, CSV otherwise
+         */
+        bool writeStats(const std::string &filename) const;
+
     protected:
 
         template<typename T> inline void deleteOut(std::vector<T*> &v, const int i)
@@ -203,8 +273,34 @@ namespace eds{
         /** Initializer **/
         dso::SE3 initialize(dso::ImageAndExposure* image, int id, const int &snapped_threshold);
 
+        /** Create event frames (and track) from the buffered events **/
+        void processEvents();
+
+        /** Insert the buffered events in the time surface and create (and track) the event frames at a fixed rate **/
+        void processTimeSurface();
+
+        /** Track the current event frame and write the outputs **/
+        void trackEventFrame(const ::eds::tracking::EventWindow &ef_events);
+
+        /** Process an image frame (tracking and mapping) **/
+        void processFrame(const ::base::samples::frame::Frame &frame_sample, const bool frame_interrupt);
+
+        /** Processing thread of the asynchronous input **/
+        void inputLoop();
+
+        /** Drain the queues and join the processing thread **/
+        void stopInput();
+
+        void notifyInput();
+
+        /** Number of events of the next event frame (0 when the window is not complete) **/
+        size_t windowSize();
+
         /** Events to Image Tracker. This is the EDS tracker**/
-        bool eventsToImageAlignment(const std::vector<::base::samples::Event> &events_array, ::base::Transform3d &T_kf_ef);
+        bool eventsToImageAlignment(const ::eds::tracking::EventWindow &events_array, ::base::Transform3d &T_kf_ef);
+
+        /** Integrate the IMU samples until time **/
+        void preintegrateImu(const ::base::Time &time);
 
         /** Image to Image Tracker. DSO-based**/
         void setPrecalcValues();
@@ -0,0 +1,410 @@
+/*
+ * This file is part of the EDS: Event-aided Direct Sparse Odometry
+ * (https://rpg.ifi.uzh.ch/eds.html)
+ *
+ * Copyright (c) 2022 Javier Hidalgo-Carrio, Robotics and Perception
+ * Group (RPG) University of Zurich.
+ *
+ * EDS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * EDS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** Offline dataset runner: feeds events and images in time stamp
+ * order to the EDS Task and reports latency and throughput.
+ *
+ * Events: binary event log (.evlog) or text file with one "t x y p"
+ * event per line (t in seconds).
+ * Images: folder with an images.txt file with one "t filename" per
+ * line (filename relative to the folder).
+ * IMU (optional): text file with one "t ax ay az gx gy gz" sample per
+ * line (t in seconds, m/s^2 and rad/s).
+ **/
+
+#include "Task.hpp"
+
+#include <eds/io/EventLog.h>
+#include <frame_helper/FrameHelper.h>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <memory>
+#include <sys/resource.h>
+
+using namespace eds;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    /** Sequential reader of events from a event log or a text file **/
+    class EventSource
+    {
+        private:
+            std::unique_ptr<::eds::io::EventLogReader> log;
+            ::eds::io::EventSlice slice;
+            size_t block_id, idx;
+            std::ifstream txt;
+            ::base::samples::Event next;
+            bool has_next;
+
+            void read()
+            {
+                if (this->log)
+                {
+                    while (this->idx >= this->slice.size)
+                    {
+                        if (this->block_id >= this->log->numBlocks()) {this->has_next = false; return;}
+                        this->slice = this->log->block(this->block_id++);
+                        this->idx = 0;
+                    }
+                    this->next = ::base::samples::Event(this->slice.x[this->idx], this->slice.y[this->idx],
+                                ::base::Time::fromMicroseconds(this->slice.ts[this->idx]), this->slice.getPolarity(this->idx));
+                    this->idx++;
+                    return;
+                }
+
+                std::string line;
+                while (std::getline(this->txt, line))
+                {
+                    if (line.empty() || line[0] == '#') continue;
+                    double t; int x, y, p;
+                    std::istringstream ss(line);
+                    if (!(ss >> t >> x >> y >> p)) continue;
+                    this->next = ::base::samples::Event(x, y, ::base::Time::fromSeconds(t), p > 0);
+                    return;
+                }
+                this->has_next = false;
+            }
+
+        public:
+            uint16_t height, width;
+
+            EventSource(const std::string &filename)
+            :block_id(0), idx(0), has_next(true), height(0), width(0)
+            {
+                this->slice.size = 0;
+                if (filename.size() > 6 && filename.substr(filename.size()-6) == ".evlog")
+                {
+                    this->log.reset(new ::eds::io::EventLogReader(filename));
+                    this->height = this->log->height(); this->width = this->log->width();
+                }
+                else
+                {
+                    this->txt.open(filename);
+                    if (!this->txt.is_open())
+                        throw std::runtime_error("[EDS_RUN] cannot open " + filename);
+                }
+                this->read();
+            }
+
+            bool empty() const {return !this->has_next;}
+
+            const ::base::samples::Event& front() const {return this->next;}
+
+            void pop() {this->read();}
+    };
+
+    struct ImageItem
+    {
+        ::base::Time time;
+        std::string filename;
+    };
+
+    std::vector<ImageItem> readImageList(const std::string &folder)
+    {
+        std::vector<ImageItem> images;
+        std::ifstream file(folder + "/images.txt");
+        if (!file.is_open())
+            throw std::runtime_error("[EDS_RUN] cannot open " + folder + "/images.txt");
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream ss(line);
+            double t; std::string name;
+            if (!(ss >> t >> name)) continue;
+            images.push_back({::base::Time::fromSeconds(t), folder + "/" + name});
+        }
+        return images;
+    }
+
+    std::vector<::base::samples::IMUSensors> readImu(const std::string &filename)
+    {
+        std::vector<::base::samples::IMUSensors> samples;
+        std::ifstream file(filename);
+        if (!file.is_open())
+            throw std::runtime_error("[EDS_RUN] cannot open " + filename);
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream ss(line);
+            double t; ::base::samples::IMUSensors sample;
+            if (!(ss >> t >> sample.acc[0] >> sample.acc[1] >> sample.acc[2]
+                    >> sample.gyro[0] >> sample.gyro[1] >> sample.gyro[2])) continue;
+            sample.time = ::base::Time::fromSeconds(t);
+            sample.mag.setZero();
+            samples.push_back(sample);
+        }
+        return samples;
+    }
+
+    bool loadFrame(const ImageItem &item, ::base::samples::frame::Frame &frame)
+    {
+        cv::Mat img = cv::imread(item.filename, cv::IMREAD_COLOR);
+        if (img.empty()) return false;
+
+        /** The task expects RGB frames **/
+        cv::cvtColor(img, img, cv::COLOR_BGR2RGB);
+        frame.init(img.cols, img.rows, 8, ::base::samples::frame::MODE_RGB);
+        cv::Mat dst = frame_helper::FrameHelper::convertToCvMat(frame);
+        img.copyTo(dst);
+        frame.time = item.time;
+        frame.received_time = item.time;
+        return true;
+    }
+
+    /** Latency statistics of one stage [ms] **/
+    struct Stage
+    {
+        std::string name;
+        std::vector<double> latency;
+
+        double percentile(const double &p)
+        {
+            if (this->latency.empty()) return 0.0;
+            std::sort(this->latency.begin(), this->latency.end());
+            size_t id = std::min(this->latency.size()-1, static_cast<size_t>(p * this->latency.size()));
+            return this->latency[id];
+        }
+
+        void print()
+        {
+            double total = std::accumulate(this->latency.begin(), this->latency.end(), 0.0);
+            std::cout<<std::setw(8)<<this->name<<" calls: "<<std::setw(8)<<this->latency.size()
+                <<std::fixed<<std::setprecision(3)
+                <<" p50: "<<this->percentile(0.5)<<" p90: "<<this->percentile(0.9)
+                <<" p99: "<<this->percentile(0.99)<<" max: "<<this->percentile(1.0)
+                <<" total: "<<total<<" [ms]"<<std::endl;
+        }
+    };
+
+    void usage(const char *name)
+    {
+        std::cout<<"usage: "<<name<<" <config.yaml> <calib.yaml> <events.(evlog|txt)> <image_folder> [options]\n"
+                 <<"  --realtime [speed]  pace the input at speed x real time (default: max speed)\n"
+                 <<"  --batch N           events per eventsCallback (default 1000)\n"
+                 <<"  --record file.evlog record the events in a binary event log\n"
+                 <<"  --imu imu.txt       IMU samples \"t ax ay az gx gy gz\" (tracker imu config)\n"
+                 <<"  --stats file        stage timings [us] as JSON (.json) or CSV (otherwise)\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 5)
+    {
+        usage(argv[0]);
+        return 0;
+    }
+
+    std::string config_file(argv[1]), calib_file(argv[2]), events_file(argv[3]), image_folder(argv[4]);
+    double speed = 0.0; // 0: max speed
+    size_t batch_size = 1000;
+    std::string record_file, imu_file, stats_file;
+    for (int i=5; i<argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--realtime")
+        {
+            speed = 1.0;
+            if (i+1 < argc && argv[i+1][0] != '-') speed = atof(argv[++i]);
+        }
+        else if (arg == "--batch" && i+1 < argc) batch_size = std::max(1, atoi(argv[++i]));
+        else if (arg == "--record" && i+1 < argc) record_file = argv[++i];
+        else if (arg == "--imu" && i+1 < argc) imu_file = argv[++i];
+        else if (arg == "--stats" && i+1 < argc) stats_file = argv[++i];
+        else {usage(argv[0]); return -1;}
+    }
+
+    EventSource events(events_file);
+    std::vector<ImageItem> images = readImageList(image_folder);
+    std::vector<::base::samples::IMUSensors> imu;
+    if (!imu_file.empty()) imu = readImu(imu_file);
+    size_t imu_id = 0;
+    if (events.height == 0 && !images.empty())
+    {
+        /** Text events do not have the sensor size: take it from the images **/
+        cv::Mat img = cv::imread(images[0].filename, cv::IMREAD_UNCHANGED);
+        events.height = img.rows; events.width = img.cols;
+    }
+    std::unique_ptr<::eds::io::EventLogWriter> recorder;
+
+    Task task;
+    if (!task.configure(config_file, calib_file) || !task.start())
+    {
+        std::cerr<<"[EDS_RUN] failed to configure the task"<<std::endl;
+        return -1;
+    }
+
+    Stage stage_events{"events", {}}, stage_frames{"frames", {}}, stage_lag{"lag", {}};
+    size_t num_events = 0, num_frames = 0, num_misses = 0, img_id = 0;
+    ::base::Time data_start;
+    bool started = false;
+    const Clock::time_point wall_start = Clock::now();
+    double cb_seconds = 0.0;
+
+    ::base::samples::EventArray packet;
+    ::base::samples::frame::Frame frame;
+    packet.events.reserve(batch_size);
+
+    /** Real time pacing: wait until the sample time and account the lag **/
+    auto pace = [&](const ::base::Time &t)
+    {
+        if (!started) {data_start = t; started = true;}
+        if (speed <= 0.0) return;
+        Clock::time_point due = wall_start + std::chrono::microseconds(
+                static_cast<int64_t>((t - data_start).toMicroseconds() / speed));
+        Clock::time_point now = Clock::now();
+        if (now < due)
+            std::this_thread::sleep_until(due);
+        else
+        {
+            double lag = std::chrono::duration<double, std::milli>(now - due).count();
+            stage_lag.latency.push_back(lag);
+            ++num_misses;
+        }
+    };
+
+    /** IMU samples up to time t (before the events and images of t) **/
+    auto feedImu = [&](const ::base::Time &t)
+    {
+        while (imu_id < imu.size() && imu[imu_id].time <= t)
+        {
+            task.imuCallback(imu[imu_id].time, imu[imu_id]);
+            ++imu_id;
+        }
+    };
+
+    while (!events.empty() || img_id < images.size())
+    {
+        bool image_first = img_id < images.size() &&
+                (events.empty() || images[img_id].time <= events.front().ts);
+
+        if (image_first)
+        {
+            if (!loadFrame(images[img_id], frame))
+            {
+                std::cerr<<"[EDS_RUN] cannot read "<<images[img_id].filename<<std::endl;
+                ++img_id; continue;
+            }
+            pace(frame.time);
+            feedImu(frame.time);
+            Clock::time_point t0 = Clock::now();
+            task.frameCallback(frame.time, frame);
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+            stage_frames.latency.push_back(ms); cb_seconds += ms * 1e-03;
+            ++num_frames; ++img_id;
+            continue;
+        }
+
+        /** Events packet until the batch size or the next image **/
+        packet.events.clear();
+        while (!events.empty() && packet.events.size() < batch_size &&
+                (img_id >= images.size() || events.front().ts < images[img_id].time))
+        {
+            packet.events.push_back(events.front());
+            events.pop();
+        }
+        packet.time = packet.events.back().ts;
+        packet.height = events.height; packet.width = events.width;
+        if (recorder == nullptr && !record_file.empty())
+            recorder.reset(new ::eds::io::EventLogWriter(record_file, events.height, events.width));
+        if (recorder) recorder->write(packet);
+
+        pace(packet.time);
+        feedImu(packet.time);
+        Clock::time_point t0 = Clock::now();
+        task.eventsCallback(packet.time, packet);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        stage_events.latency.push_back(ms); cb_seconds += ms * 1e-03;
+        num_events += packet.events.size();
+    }
+
+    if (recorder) recorder->close();
+    task.stop();
+    ::eds::utils::QueueStats eq = task.getEventQueueStats(), fq = task.getFrameQueueStats();
+    ::eds::tracking::EventFilterInfo filter_info = task.getEventFilterInfo();
+    std::vector<::eds::utils::StageStats> stage_stats = task.getStats();
+
+    /** Asynchronous input: the callbacks only enqueue. The wall time
+     * includes draining the queues (stop) and the processing time is
+     * the time of the task stages in the processing thread **/
+    const bool async = (eq.pushed > 0 || fq.pushed > 0);
+    const double wall_seconds = std::chrono::duration<double>(Clock::now() - wall_start).count();
+    if (async)
+    {
+        cb_seconds = 0.0;
+        for (const ::eds::utils::StageStats &s : stage_stats)
+            if (s.name == "process_events" || s.name == "process_frame") cb_seconds += s.total * 1e-06;
+        stage_events.name = "enqueue events"; stage_frames.name = "enqueue frames";
+    }
+    cb_seconds = std::max(cb_seconds, 1e-09);
+    if (!stats_file.empty()) task.writeStats(stats_file);
+    task.cleanup();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::cout<<"\n[EDS_RUN] mode: "<<((speed > 0.0)? "real time x" + std::to_string(speed) : std::string("max speed"))
+             <<((async)? " async input (callback latencies are enqueue only)" : "")<<std::endl;
+    stage_events.print();
+    stage_frames.print();
+    if (speed > 0.0)
+    {
+        std::cout<<"[EDS_RUN] real time misses: "<<num_misses<<std::endl;
+        stage_lag.print();
+    }
+    if (filter_info.num_events > 0)
+    {
+        std::cout<<"[EDS_RUN] filter removed hot pixel: "<<filter_info.num_hot_pixel<<" refractory: "<<filter_info.num_refractory
+                 <<" background: "<<filter_info.num_background<<" of "<<filter_info.num_events<<" events ("
+                 <<filter_info.num_hot_pixels<<" hot pixels)"<<std::endl;
+    }
+    if (eq.pushed > 0 || fq.pushed > 0)
+    {
+        std::cout<<"[EDS_RUN] event queue max depth: "<<eq.max_depth<<" dropped: "<<eq.dropped<<" merged: "<<eq.merged<<"\n"
+                 <<"[EDS_RUN] frame queue max depth: "<<fq.max_depth<<" dropped: "<<fq.dropped<<std::endl;
+    }
+    for (const ::eds::utils::StageStats &s : stage_stats)
+    {
+        std::cout<<std::fixed<<std::setprecision(1)<<"[EDS_RUN] stage "<<s.name<<" count: "<<s.count<<" mean: "<<s.mean
+                 <<" p50: "<<s.p50<<" p99: "<<s.p99<<" max: "<<s.max<<" [us]"<<std::endl;
+    }
+    std::cout<<std::fixed<<std::setprecision(1)
+        <<"[EDS_RUN] events: "<<num_events<<" frames: "<<num_frames<<" wall time: "<<wall_seconds<<" [s]\n"
+        <<"[EDS_RUN] events/s: "<<num_events/cb_seconds<<" frames/s: "<<num_frames/cb_seconds<<((async)? " (processing thread time)\n" : " (processing time)\n")
+        <<"[EDS_RUN] events/s: "<<num_events/wall_seconds<<" frames/s: "<<num_frames/wall_seconds<<" (wall time)\n"
+        <<"[EDS_RUN] peak RSS: "<<usage.ru_maxrss / 1024.0<<" [MB]"<<std::endl;
+
+    return 0;
+}
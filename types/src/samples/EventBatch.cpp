@@ -0,0 +1,68 @@
+#include "EventBatch.hpp"
+
+namespace base { namespace samples {
+
+    void EventBatch::clear()
+    {
+        x.clear(); y.clear(); ts.clear(); polarity.clear();
+    }
+
+    void EventBatch::reserve(size_t n)
+    {
+        x.reserve(n); y.reserve(n); ts.reserve(n);
+        polarity.reserve((n + 63) / 64);
+    }
+
+    void EventBatch::push_back(uint16_t x_, uint16_t y_, int64_t ts_us, bool p)
+    {
+        size_t i = x.size();
+        if ((i & 63) == 0)
+            polarity.push_back(0);
+        if (p)
+            polarity.back() |= (uint64_t(1) << (i & 63));
+
+        x.push_back(x_);
+        y.push_back(y_);
+        ts.push_back(ts_us);
+    }
+
+    void EventBatch::push_back(const Event &event)
+    {
+        push_back(event.x, event.y, event.ts.toMicroseconds(), event.polarity != 0);
+    }
+
+    Event EventBatch::getEvent(size_t i) const
+    {
+        return Event(x[i], y[i], getTime(i), getPolarity(i));
+    }
+
+    void EventBatch::append(const std::vector<Event> &events)
+    {
+        reserve(size() + events.size());
+        for (auto it = events.begin(); it != events.end(); ++it)
+            push_back(*it);
+    }
+
+    EventBatch EventBatch::fromEventArray(const EventArray &array)
+    {
+        EventBatch batch;
+        batch.time = array.time;
+        batch.height = array.height;
+        batch.width = array.width;
+        batch.append(array.events);
+        return batch;
+    }
+
+    EventArray EventBatch::toEventArray() const
+    {
+        EventArray array;
+        array.time = time;
+        array.height = height;
+        array.width = width;
+        array.events.reserve(size());
+        for (size_t i = 0; i < size(); ++i)
+            array.events.push_back(getEvent(i));
+        return array;
+    }
+
+} } //end namespace base::samples
@@ -0,0 +1,79 @@
+#ifndef __BASE_SAMPLES_EVENT_BATCH_HH
+#define __BASE_SAMPLES_EVENT_BATCH_HH
+
+#include <base/Time.hpp>
+#include <base/samples/Event.hpp>
+#include <base/samples/EventArray.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace base {
+namespace samples {
+
+    /** Columnar (structure of arrays) packet of events.
+     *
+     * Same information than EventArray but each field is stored in its
+     * own array: x and y coordinates, timestamps in microseconds and the
+     * polarity packed in a bitset (one bit per event). Consumers touching
+     * only one or two fields per pass read 5 bytes per event (x, y and
+     * the polarity bit) instead of a 24 bytes Event record.
+     */
+    struct EventBatch
+    {
+        ::base::Time time;
+        uint16_t height;
+        uint16_t width;
+
+        /** Event coordinates **/
+        std::vector<uint16_t> x;
+        std::vector<uint16_t> y;
+
+        /** Event timestamps in microseconds **/
+        std::vector<int64_t> ts;
+
+        /** Packed polarities: bit (i % 64) of word (i / 64) **/
+        std::vector<uint64_t> polarity;
+
+        EventBatch() : height(0), width(0) {}
+
+        /** Number of events **/
+        size_t size() const { return x.size(); }
+
+        bool empty() const { return x.empty(); }
+
+        void clear();
+
+        void reserve(size_t n);
+
+        /** Append one event at the end of the batch **/
+        void push_back(uint16_t x_, uint16_t y_, int64_t ts_us, bool p);
+
+        void push_back(const Event &event);
+
+        /** Polarity of the i-th event **/
+        bool getPolarity(size_t i) const
+        {
+            return (polarity[i >> 6] >> (i & 63)) & 1u;
+        }
+
+        /** Timestamp of the i-th event **/
+        ::base::Time getTime(size_t i) const
+        {
+            return ::base::Time::fromMicroseconds(ts[i]);
+        }
+
+        /** The i-th event as an Event record **/
+        Event getEvent(size_t i) const;
+
+        /** Append all the events of an array **/
+        void append(const std::vector<Event> &events);
+
+        /** Convert from/to the array of events **/
+        static EventBatch fromEventArray(const EventArray &array);
+
+        EventArray toEventArray() const;
+    };
+}  // end namespace samples
+}  // end namespace base
+
+#endif
@@ -0,0 +1,68 @@
+#include <boost/test/unit_test.hpp>
+#include <base/samples/EventBatch.hpp>
+
+using namespace base;
+using namespace base::samples;
+
+BOOST_AUTO_TEST_SUITE(samples_EventBatch)
+
+BOOST_AUTO_TEST_CASE(push_back_packs_the_polarity_in_bits)
+{
+    EventBatch batch;
+    for (size_t i = 0; i < 130; ++i)
+        batch.push_back(i, i + 1, i * 10, (i % 3) == 0);
+
+    BOOST_REQUIRE_EQUAL(130, batch.size());
+    BOOST_REQUIRE_EQUAL(3, batch.polarity.size());
+    for (size_t i = 0; i < 130; ++i)
+        BOOST_REQUIRE_EQUAL((i % 3) == 0, batch.getPolarity(i));
+}
+
+BOOST_AUTO_TEST_CASE(fromEventArray_keeps_the_header_and_the_events)
+{
+    EventArray array;
+    array.time = Time::fromMicroseconds(1000);
+    array.height = 180; array.width = 240;
+    for (uint16_t i = 0; i < 70; ++i)
+        array.events.push_back(Event(i, 2 * i, Time::fromMicroseconds(1000 + i), i % 2));
+
+    EventBatch batch = EventBatch::fromEventArray(array);
+    BOOST_REQUIRE_EQUAL(array.time, batch.time);
+    BOOST_REQUIRE_EQUAL(180, batch.height);
+    BOOST_REQUIRE_EQUAL(240, batch.width);
+    BOOST_REQUIRE_EQUAL(70, batch.size());
+    BOOST_REQUIRE_EQUAL(1069, batch.ts[69]);
+    BOOST_REQUIRE_EQUAL(138, batch.y[69]);
+    BOOST_REQUIRE(batch.getPolarity(69));
+}
+
+BOOST_AUTO_TEST_CASE(toEventArray_is_the_inverse_of_fromEventArray)
+{
+    EventArray array;
+    array.time = Time::fromMicroseconds(42);
+    array.height = 10; array.width = 20;
+    for (uint16_t i = 0; i < 100; ++i)
+        array.events.push_back(Event(i % 20, i % 10, Time::fromMicroseconds(42 + 3 * i), (i % 5) == 0));
+
+    EventArray result = EventBatch::fromEventArray(array).toEventArray();
+    BOOST_REQUIRE_EQUAL(array.time, result.time);
+    BOOST_REQUIRE_EQUAL(array.events.size(), result.events.size());
+    for (size_t i = 0; i < array.events.size(); ++i)
+    {
+        BOOST_REQUIRE_EQUAL(array.events[i].x, result.events[i].x);
+        BOOST_REQUIRE_EQUAL(array.events[i].y, result.events[i].y);
+        BOOST_REQUIRE_EQUAL(array.events[i].ts, result.events[i].ts);
+        BOOST_REQUIRE_EQUAL(array.events[i].polarity, result.events[i].polarity);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(clear_removes_all_the_events)
+{
+    EventBatch batch;
+    batch.push_back(Event(1, 2, Time::fromMicroseconds(3), 1));
+    batch.clear();
+    BOOST_REQUIRE(batch.empty());
+    BOOST_REQUIRE(batch.polarity.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()